@@ -17,18 +17,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <chrono>
+#include <thread>
+#include <vector>
 #include "glm.h"
+#include "glmint.h"
 
 
-#define T(x) (model->triangles[(x)])
+#define GLM_STREAM_SLICE (64 << 10) /* bytes parsed between budget checks */
+#define GLM_PARALLEL_VERTICES 16384 /* fewer vertices aren't worth threads */
+#define GLM_PARALLEL_TRIANGLES 65536 /* nor fewer triangles */
+#define GLM_PARALLEL_SWEEP (1 << 18) /* vertices for memory bound sweeps */
 
 
-/* _GLMnode: general purpose node */
-typedef struct _GLMnode {
-    GLuint index;
-    GLboolean averaged;
-    struct _GLMnode* next;
-} GLMnode;
+#define T(x) (model->triangles[(x)])
 
 
 /* glmMax: returns the maximum of two floats */
@@ -62,22 +64,6 @@ glmDot(GLfloat* u, GLfloat* v)
     return u[0]*v[0] + u[1]*v[1] + u[2]*v[2];
 }
 
-/* glmCross: compute the cross product of two vectors
- *
- * u - array of 3 GLfloats (GLfloat u[3])
- * v - array of 3 GLfloats (GLfloat v[3])
- * n - array of 3 GLfloats (GLfloat n[3]) to return the cross product in
- */
-static GLvoid
-glmCross(GLfloat* u, GLfloat* v, GLfloat* n)
-{
-    assert(u); assert(v); assert(n);
-
-    n[0] = u[1]*v[2] - u[2]*v[1];
-    n[1] = u[2]*v[0] - u[0]*v[2];
-    n[2] = u[0]*v[1] - u[1]*v[0];
-}
-
 /* glmNormalize: normalize a vector
  *
  * v - array of 3 GLfloats (GLfloat v[3]) to be normalized
@@ -99,62 +85,307 @@ glmNormalize(GLfloat* v)
  * equal (within a certain threshold) or GL_FALSE if not. An epsilon
  * that works fairly well is 0.000001.
  *
- * u - array of 3 GLfloats (GLfloat u[3])
- * v - array of 3 GLfloats (GLfloat v[3])
+ * u    - array of size GLfloats
+ * v    - array of size GLfloats
+ * size - number of components (2 or 3)
  */
 static GLboolean
-glmEqual(GLfloat* u, GLfloat* v, GLfloat epsilon)
+glmEqual(const GLfloat* u, const GLfloat* v, GLuint size, GLfloat epsilon)
 {
     if (glmAbs(u[0] - v[0]) < epsilon &&
         glmAbs(u[1] - v[1]) < epsilon &&
-        glmAbs(u[2] - v[2]) < epsilon)
+        (size < 3 || glmAbs(u[2] - v[2]) < epsilon))
     {
         return GL_TRUE;
     }
     return GL_FALSE;
 }
 
-/* glmWeldVectors: eliminate (weld) vectors that are within an
- * epsilon of each other.
- *
- * vectors     - array of GLfloat[3]'s to be welded
- * numvectors - number of GLfloat[3]'s in vectors
- * epsilon     - maximum difference between vectors
- *
+#define GLM_WELD_NONE  0xffffffffu      /* bucket of vectors never welded */
+#define GLM_WELD_LIMIT 1e12             /* cells are clamped to +-this */
+
+/* GLMweld: uniform grid over the vectors being welded, hashed into
+ * buckets.  The cells are 4 * epsilon wide, so the vectors glmEqual()
+ * can match to a vector are in its own cell or the neighbouring cell
+ * on the side of the nearer face, along each axis (2, 4 or 8 cells in
+ * all) whatever the rounding.  Each bucket lists its vectors in index
+ * order.
  */
-GLfloat*
-glmWeldVectors(GLfloat* vectors, GLuint* numvectors, GLfloat epsilon)
+typedef struct _GLMweld {
+    const GLfloat* vectors;     /* vectors being welded (from index 1) */
+    GLuint  size;               /* components per vector (2 or 3) */
+    GLfloat epsilon;            /* maximum difference between vectors */
+    double  scale;              /* 1 / cell width */
+    GLuint  mask;               /* number of buckets - 1 */
+    GLuint* buckets;            /* bucket of each vector */
+    GLuint* offsets;            /* start of each bucket in entries */
+    GLuint* entries;            /* vector indices, bucket by bucket */
+    GLuint* first;              /* first earlier vector equal to each */
+    GLuint* remap;              /* new index of each vector */
+    GLuint* kept;               /* vector each new index came from */
+} GLMweld;
+
+/* glmWeldCells: the grid cell of a vector, and which neighbour (-1 or
+ * +1) along each axis may also hold vectors that are equal to it */
+static GLvoid
+glmWeldCells(GLMweld* weld, const GLfloat* vector, double* cells, int* sides)
+{
+    double x;
+    GLuint j;
+
+    for (j = 0; j < weld->size; j++) {
+        x = vector[j] * weld->scale;
+        cells[j] = floor(x);
+        sides[j] = x - cells[j] < 0.5 ? -1 : 1;
+        if (cells[j] > GLM_WELD_LIMIT) {
+            cells[j] = GLM_WELD_LIMIT;
+            sides[j] = -1;
+        } else if (cells[j] < -GLM_WELD_LIMIT) {
+            cells[j] = -GLM_WELD_LIMIT;
+            sides[j] = 1;
+        }
+    }
+}
+
+/* glmWeldBucket: the bucket a grid cell (offset by d) hashes to */
+static GLuint
+glmWeldBucket(GLMweld* weld, const double* cells, const int* d)
 {
-    GLfloat* copies;
-    GLuint copied;
+    static const unsigned long long primes[3] = {
+        0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull
+    };
+    unsigned long long hash = 0;
+    GLuint j;
+
+    for (j = 0; j < weld->size; j++)
+        hash ^= (unsigned long long)(long long)(cells[j] + d[j]) * primes[j];
+    return (GLuint)(hash ^ (hash >> 29) ^ (hash >> 47)) & weld->mask;
+}
+
+/* glmWeldHash: find the buckets of the vectors in [begin, end).
+ * Vectors that are not finite can't be equal to anything, so they are
+ * left out of the grid. */
+static GLvoid
+glmWeldHash(GLMweld* weld, GLuint begin, GLuint end)
+{
+    static const int zero[3] = { 0, 0, 0 };
+    const GLfloat* vector;
+    double cells[3];
+    int sides[3];
     GLuint i, j;
 
-    copies = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (*numvectors + 1));
-    memcpy(copies, vectors, (sizeof(GLfloat) * 3 * (*numvectors + 1)));
+    for (i = begin; i < end; i++) {
+        vector = &weld->vectors[weld->size * i];
+        weld->buckets[i] = GLM_WELD_NONE;
+        if (!(weld->epsilon > 0))
+            continue;
+        for (j = 0; j < weld->size; j++)
+            if (!isfinite(vector[j]))
+                break;
+        if (j < weld->size)
+            continue;
+        glmWeldCells(weld, vector, cells, sides);
+        weld->buckets[i] = glmWeldBucket(weld, cells, zero);
+    }
+}
 
-    copied = 1;
-    for (i = 1; i <= *numvectors; i++) {
-        for (j = 1; j <= copied; j++) {
-            if (glmEqual(&vectors[3 * i], &copies[3 * j], epsilon)) {
-                goto duplicate;
+/* glmWeldFind: the first vector before vector i that is glmEqual() to
+ * it, or 0 if there is none.  With kept set only vectors that have
+ * been kept so far are considered. */
+static GLuint
+glmWeldFind(GLMweld* weld, GLuint i, GLboolean kept)
+{
+    const GLfloat* vector = &weld->vectors[weld->size * i];
+    GLuint best, bucket, j, k, e, n;
+    double cells[3];
+    int sides[3], d[3];
+
+    if (weld->buckets[i] == GLM_WELD_NONE)
+        return 0;
+
+    best = i;
+    glmWeldCells(weld, vector, cells, sides);
+    for (n = 0; n < (1u << weld->size); n++) {
+        for (j = 0; j < weld->size; j++)
+            d[j] = n & (1 << j) ? sides[j] : 0;
+        bucket = n ? glmWeldBucket(weld, cells, d) : weld->buckets[i];
+        for (e = weld->offsets[bucket]; e < weld->offsets[bucket + 1]; e++) {
+            k = weld->entries[e];
+            if (k >= best)
+                break;
+            if ((!kept || weld->kept[weld->remap[k]] == k) &&
+                glmEqual(vector, &weld->vectors[weld->size * k],
+                    weld->size, weld->epsilon)) {
+                best = k;
+                break;
             }
         }
+    }
+    return best == i ? 0 : best;
+}
+
+/* glmWeldFirst: find the first earlier equal vector of the vectors in
+ * [begin, end) */
+static GLvoid
+glmWeldFirst(GLMweld* weld, GLuint begin, GLuint end)
+{
+    GLuint i;
+
+    for (i = begin; i < end; i++)
+        weld->first[i] = glmWeldFind(weld, i, GL_FALSE);
+}
+
+/* glmWeldVectors: eliminate (weld) vectors that are within an
+ * epsilon of each other.  Every vector is matched to the first
+ * (lowest numbered) earlier vector it is glmEqual() to that was kept,
+ * or else kept itself.  Returns an array (to be free'd) that maps the
+ * old vector indices to the new ones; the kept vectors keep their
+ * order.
+ *
+ * vectors    - array of numvectors vectors, starting at index 1
+ * numvectors - number of vectors in vectors
+ * size       - components per vector (2 or 3)
+ * epsilon    - maximum difference between vectors
+ * numwelded  - set to the number of vectors kept
+ */
+static GLuint*
+glmWeldVectors(const GLfloat* vectors, GLuint numvectors, GLuint size,
+               GLfloat epsilon, GLuint* numwelded)
+{
+    std::vector<std::thread> threads;
+    GLMweld weld;
+    GLuint  numbuckets, numthreads, copied, i, k;
+    GLuint* ranges;
+
+    weld.vectors = vectors;
+    weld.size = size;
+    weld.epsilon = epsilon;
+    weld.scale = 0.25 / epsilon;
+    for (numbuckets = 64; numbuckets < 2 * numvectors; numbuckets *= 2)
+        ;
+    weld.mask = numbuckets - 1;
+    weld.buckets = (GLuint*)malloc(sizeof(GLuint) * (numvectors + 1));
+    weld.offsets = (GLuint*)calloc(numbuckets + 2, sizeof(GLuint));
+    weld.entries = (GLuint*)malloc(sizeof(GLuint) * (numvectors + 1));
+    weld.first = (GLuint*)malloc(sizeof(GLuint) * (numvectors + 1));
+    weld.remap = (GLuint*)malloc(sizeof(GLuint) * (numvectors + 1));
+    weld.kept = (GLuint*)malloc(sizeof(GLuint) * (numvectors + 1));
+
+    numthreads = numvectors < GLM_PARALLEL_VERTICES ? 1 :
+        std::thread::hardware_concurrency();
+    if (numthreads < 2)
+        numthreads = 1;
+    ranges = (GLuint*)malloc(sizeof(GLuint) * (numthreads + 1));
+    for (i = 0; i <= numthreads; i++)
+        ranges[i] = 1 + (GLuint)((unsigned long long)numvectors *
+            i / numthreads);
+
+    /* hash the vectors into buckets */
+    if (numthreads == 1) {
+        glmWeldHash(&weld, ranges[0], ranges[1]);
+    } else {
+        for (i = 0; i < numthreads; i++)
+            threads.push_back(std::thread(glmWeldHash, &weld,
+                ranges[i], ranges[i + 1]));
+        for (i = 0; i < numthreads; i++)
+            threads[i].join();
+        threads.clear();
+    }
+
+    /* counting sort the vectors by bucket, keeping index order */
+    for (i = 1; i <= numvectors; i++)
+        if (weld.buckets[i] != GLM_WELD_NONE)
+            weld.offsets[weld.buckets[i] + 2]++;
+    for (i = 2; i <= numbuckets + 1; i++)
+        weld.offsets[i] += weld.offsets[i - 1];
+    for (i = 1; i <= numvectors; i++)
+        if (weld.buckets[i] != GLM_WELD_NONE)
+            weld.entries[weld.offsets[weld.buckets[i] + 1]++] = i;
+
+    /* find the first earlier vector each vector is equal to */
+    if (numthreads == 1) {
+        glmWeldFirst(&weld, ranges[0], ranges[1]);
+    } else {
+        for (i = 0; i < numthreads; i++)
+            threads.push_back(std::thread(glmWeldFirst, &weld,
+                ranges[i], ranges[i + 1]));
+        for (i = 0; i < numthreads; i++)
+            threads[i].join();
+    }
+
+    /* number the vectors in order.  The first equal vector is the one
+       to weld to if it was kept; only if it was welded itself (equality
+       within epsilon isn't transitive) do the kept ones get searched. */
+    weld.remap[0] = 0;
+    copied = 0;
+    for (i = 1; i <= numvectors; i++) {
+        k = weld.first[i];
+        if (k && weld.kept[weld.remap[k]] != k)
+            k = glmWeldFind(&weld, i, GL_TRUE);
+        if (k) {
+            weld.remap[i] = weld.remap[k];
+        } else {
+            weld.kept[++copied] = i;
+            weld.remap[i] = copied;
+        }
+    }
+
+    free(ranges);
+    free(weld.kept);
+    free(weld.first);
+    free(weld.entries);
+    free(weld.offsets);
+    free(weld.buckets);
+
+    *numwelded = copied;
+    return weld.remap;
+}
 
-        /* must not be any duplicates -- add to the copies array */
-        copies[3 * copied + 0] = vectors[3 * i + 0];
-        copies[3 * copied + 1] = vectors[3 * i + 1];
-        copies[3 * copied + 2] = vectors[3 * i + 2];
-        j = copied;             /* pass this along for below */
-        copied++;
+/* glmWeldArray: weld the vectors of one of the model's arrays and
+ * renumber the matching triangle indices (field is the offset of
+ * vindices, nindices or tindices in GLMtriangle).  The array is
+ * compacted in place, finding the bounds of what is left on the way
+ * if min and max are given. */
+static GLvoid
+glmWeldArray(GLMmodel* model, GLfloat* vectors, GLuint* numvectors,
+             GLuint size, size_t field, GLfloat epsilon,
+             GLfloat* min, GLfloat* max)
+{
+    GLuint* remap;
+    GLuint* indices;
+    GLuint numwelded, copied, i, j;
+
+    remap = glmWeldVectors(vectors, *numvectors, size, epsilon, &numwelded);
+
+#if 0
+    printf("glmWeld(): %d redundant vectors.\n", *numvectors - numwelded);
+#endif
+
+    for (i = 0; i < model->numtriangles; i++) {
+        indices = (GLuint*)((char*)&T(i) + field);
+        indices[0] = remap[indices[0]];
+        indices[1] = remap[indices[1]];
+        indices[2] = remap[indices[2]];
+    }
 
-duplicate:
-        /* set the first component of this vector to point at the correct
-        index into the new copies array */
-        vectors[3 * i + 0] = (GLfloat)j;
+    /* kept vectors never move up, so they can be packed in place */
+    copied = 0;
+    for (i = 1; i <= *numvectors; i++) {
+        if (remap[i] > copied) {
+            copied++;
+            for (j = 0; j < size; j++)
+                vectors[size * copied + j] = vectors[size * i + j];
+            for (j = 0; min && j < size; j++) {
+                if (copied == 1 || max[j] < vectors[size * i + j])
+                    max[j] = vectors[size * i + j];
+                if (copied == 1 || min[j] > vectors[size * i + j])
+                    min[j] = vectors[size * i + j];
+            }
+        }
     }
+    *numvectors = numwelded;
 
-    *numvectors = copied-1;
-    return copies;
+    free(remap);
 }
 
 /* glmFindGroup: Find a group in the model */
@@ -183,11 +414,14 @@ glmAddGroup(GLMmodel* model, char* name)
 
     group = glmFindGroup(model, name);
     if (!group) {
-        group = (GLMgroup*)malloc(sizeof(GLMgroup));
-        group->name = strdup(name);
+        group = (GLMgroup*)glmAlloc(model, sizeof(GLMgroup));
+        group->name = glmStrdup(model, name);
         group->material = 0;
         group->numtriangles = 0;
         group->triangles = NULL;
+        group->nummeshlets = 0;
+        group->meshlets = NULL;
+        group->indices = NULL;
         group->next = model->groups;
         model->groups = group;
         model->numgroups++;
@@ -225,7 +459,7 @@ found:
  *
  * NOTE: the return value should be free'd.
  */
-static char*
+char*
 glmDirName(char* path)
 {
     char* dir;
@@ -243,132 +477,6 @@ glmDirName(char* path)
 }
 
 
-/* glmReadMTL: read a wavefront material library file
- *
- * model - properly initialized GLMmodel structure
- * name  - name of the material library
- */
-static GLvoid
-glmReadMTL(GLMmodel* model, char* name)
-{
-    FILE* file;
-    char* dir;
-    char* filename;
-    char buf[128];
-    GLuint nummaterials, i;
-
-    dir = glmDirName(model->pathname);
-    filename = (char*)malloc(sizeof(char) * (strlen(dir) + strlen(name) + 1));
-    strcpy(filename, dir);
-    strcat(filename, name);
-    free(dir);
-
-    file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "glmReadMTL() failed: can't open material file \"%s\".\n",
-            filename);
-        exit(1);
-    }
-    free(filename);
-
-    /* count the number of materials in the file */
-    nummaterials = 1;
-    while(fscanf(file, "%s", buf) != EOF) {
-        switch(buf[0]) {
-        case '#':               /* comment */
-            /* eat up rest of line */
-            fgets(buf, sizeof(buf), file);
-            break;
-        case 'n':               /* newmtl */
-            fgets(buf, sizeof(buf), file);
-            nummaterials++;
-            sscanf(buf, "%s %s", buf, buf);
-            break;
-        default:
-            /* eat up rest of line */
-            fgets(buf, sizeof(buf), file);
-            break;
-        }
-    }
-
-    rewind(file);
-
-    model->materials = (GLMmaterial*)malloc(sizeof(GLMmaterial) * nummaterials);
-    model->nummaterials = nummaterials;
-
-    /* set the default material */
-    for (i = 0; i < nummaterials; i++) {
-        model->materials[i].name = NULL;
-        model->materials[i].shininess = 65.0;
-        model->materials[i].diffuse[0] = 0.8;
-        model->materials[i].diffuse[1] = 0.8;
-        model->materials[i].diffuse[2] = 0.8;
-        model->materials[i].diffuse[3] = 1.0;
-        model->materials[i].ambient[0] = 0.2;
-        model->materials[i].ambient[1] = 0.2;
-        model->materials[i].ambient[2] = 0.2;
-        model->materials[i].ambient[3] = 1.0;
-        model->materials[i].specular[0] = 0.0;
-        model->materials[i].specular[1] = 0.0;
-        model->materials[i].specular[2] = 0.0;
-        model->materials[i].specular[3] = 1.0;
-    }
-    model->materials[0].name = strdup("default");
-
-    /* now, read in the data */
-    nummaterials = 0;
-    while(fscanf(file, "%s", buf) != EOF) {
-        switch(buf[0]) {
-        case '#':               /* comment */
-            /* eat up rest of line */
-            fgets(buf, sizeof(buf), file);
-            break;
-        case 'n':               /* newmtl */
-            fgets(buf, sizeof(buf), file);
-            sscanf(buf, "%s %s", buf, buf);
-            nummaterials++;
-            model->materials[nummaterials].name = strdup(buf);
-            break;
-        case 'N':
-            fscanf(file, "%f", &model->materials[nummaterials].shininess);
-            /* wavefront shininess is from [0, 1000], so scale for OpenGL */
-            model->materials[nummaterials].shininess /= 1000.0;
-            model->materials[nummaterials].shininess *= 128.0;
-            break;
-        case 'K':
-            switch(buf[1]) {
-            case 'd':
-                fscanf(file, "%f %f %f",
-                    &model->materials[nummaterials].diffuse[0],
-                    &model->materials[nummaterials].diffuse[1],
-                    &model->materials[nummaterials].diffuse[2]);
-                break;
-            case 's':
-                fscanf(file, "%f %f %f",
-                    &model->materials[nummaterials].specular[0],
-                    &model->materials[nummaterials].specular[1],
-                    &model->materials[nummaterials].specular[2]);
-                break;
-            case 'a':
-                fscanf(file, "%f %f %f",
-                    &model->materials[nummaterials].ambient[0],
-                    &model->materials[nummaterials].ambient[1],
-                    &model->materials[nummaterials].ambient[2]);
-                break;
-            default:
-                /* eat up rest of line */
-                fgets(buf, sizeof(buf), file);
-                break;
-            }
-            break;
-            default:
-                /* eat up rest of line */
-                fgets(buf, sizeof(buf), file);
-                break;
-        }
-    }
-}
-
 /* glmWriteMTL: write a wavefront material library file
  *
  * model   - properly initialized GLMmodel structure
@@ -424,337 +532,189 @@ glmWriteMTL(GLMmodel* model, char* modelpath, char* mtllibname)
 }
 
 
-/* glmFirstPass: first pass at a Wavefront OBJ file that gets all the
- * statistics of the model (such as #vertices, #normals, etc)
- *
- * model - properly initialized GLMmodel structure
- * file  - (fopen'd) file descriptor
- */
+/* glmSweepThreads: number of threads to split a sweep over the
+ * vertices of a model into (memory bound, so only for big models) */
+static GLuint
+glmSweepThreads(GLMmodel* model)
+{
+    GLuint numthreads;
+
+    if (model->numvertices < GLM_PARALLEL_SWEEP)
+        return 1;
+    numthreads = std::thread::hardware_concurrency();
+    return numthreads < 2 ? 1 : numthreads;
+}
+
+/* glmPadded: length of the soa arrays of a model */
+static GLuint
+glmPadded(GLMmodel* model)
+{
+    return (model->numvertices + GLM_SOA_PAD - 1) & ~(GLM_SOA_PAD - 1);
+}
+
+/* glmSweepSplit: where part i of numthreads of a sweep starts, in the
+ * vertices array (from 1) or on a padding boundary of the soa arrays
+ * (from 0, so the padding is swept too) */
+static GLuint
+glmSweepSplit(GLMmodel* model, GLuint i, GLuint numthreads)
+{
+    if (model->layout == GLM_SOA)
+        return i == numthreads ? glmPadded(model) :
+            (GLuint)((unsigned long long)glmPadded(model) * i /
+            numthreads) & ~(GLM_SOA_PAD - 1);
+    return 1 + (GLuint)((unsigned long long)model->numvertices *
+        i / numthreads);
+}
+
+/* glmBoundsPart: glmBoundsRange() on one part of a sweep */
 static GLvoid
-glmFirstPass(GLMmodel* model, FILE* file)
+glmBoundsPart(GLMmodel* model, GLuint begin, GLuint end,
+              GLfloat* min, GLfloat* max)
 {
-    GLuint numvertices;        /* number of vertices in model */
-    GLuint numnormals;         /* number of normals in model */
-    GLuint numtexcoords;       /* number of texcoords in model */
-    GLuint numtriangles;       /* number of triangles in model */
-    GLMgroup* group;           /* current group */
-    int v, n, t;
-    char buf[128];
-
-    /* make a default group */
-    char mode[] = "default";
-    group = glmAddGroup(model, mode);
-
-    numvertices = numnormals = numtexcoords = numtriangles = 0;
-    while(fscanf(file, "%s", buf) != EOF) {
-        switch(buf[0]) {
-        case '#':               /* comment */
-            /* eat up rest of line */
-            fgets(buf, sizeof(buf), file);
-            break;
-        case 'v':               /* v, vn, vt */
-            switch(buf[1]) {
-            case '\0':          /* vertex */
-                /* eat up rest of line */
-                fgets(buf, sizeof(buf), file);
-                numvertices++;
-                break;
-            case 'n':           /* normal */
-                /* eat up rest of line */
-                fgets(buf, sizeof(buf), file);
-                numnormals++;
-                break;
-            case 't':           /* texcoord */
-                /* eat up rest of line */
-                fgets(buf, sizeof(buf), file);
-                numtexcoords++;
-                break;
-            default:
-                printf("glmFirstPass(): Unknown token \"%s\".\n", buf);
-                exit(1);
-                break;
-            }
-            break;
-            case 'm':
-                fgets(buf, sizeof(buf), file);
-                sscanf(buf, "%s %s", buf, buf);
-                model->mtllibname = strdup(buf);
-                glmReadMTL(model, buf);
-                break;
-            case 'u':
-                /* eat up rest of line */
-                fgets(buf, sizeof(buf), file);
-                break;
-            case 'g':               /* group */
-                /* eat up rest of line */
-                fgets(buf, sizeof(buf), file);
-#if SINGLE_STRING_GROUP_NAMES
-                sscanf(buf, "%s", buf);
-#else
-                buf[strlen(buf)-1] = '\0';  /* nuke '\n' */
-#endif
-                group = glmAddGroup(model, buf);
-                break;
-            case 'f':               /* face */
-                v = n = t = 0;
-                fscanf(file, "%s", buf);
-                /* can be one of %d, %d//%d, %d/%d, %d/%d/%d %d//%d */
-                if (strstr(buf, "//")) {
-                    /* v//n */
-                    sscanf(buf, "%d//%d", &v, &n);
-                    fscanf(file, "%d//%d", &v, &n);
-                    fscanf(file, "%d//%d", &v, &n);
-                    numtriangles++;
-                    group->numtriangles++;
-                    while(fscanf(file, "%d//%d", &v, &n) > 0) {
-                        numtriangles++;
-                        group->numtriangles++;
-                    }
-                } else if (sscanf(buf, "%d/%d/%d", &v, &t, &n) == 3) {
-                    /* v/t/n */
-                    fscanf(file, "%d/%d/%d", &v, &t, &n);
-                    fscanf(file, "%d/%d/%d", &v, &t, &n);
-                    numtriangles++;
-                    group->numtriangles++;
-                    while(fscanf(file, "%d/%d/%d", &v, &t, &n) > 0) {
-                        numtriangles++;
-                        group->numtriangles++;
-                    }
-                } else if (sscanf(buf, "%d/%d", &v, &t) == 2) {
-                    /* v/t */
-                    fscanf(file, "%d/%d", &v, &t);
-                    fscanf(file, "%d/%d", &v, &t);
-                    numtriangles++;
-                    group->numtriangles++;
-                    while(fscanf(file, "%d/%d", &v, &t) > 0) {
-                        numtriangles++;
-                        group->numtriangles++;
-                    }
-                } else {
-                    /* v */
-                    fscanf(file, "%d", &v);
-                    fscanf(file, "%d", &v);
-                    numtriangles++;
-                    group->numtriangles++;
-                    while(fscanf(file, "%d", &v) > 0) {
-                        numtriangles++;
-                        group->numtriangles++;
-                    }
-                }
-                break;
+    if (model->layout == GLM_SOA)
+        glmBoundsSoA(model->soa, begin, end, min, max);
+    else
+        glmBoundsRange(model->vertices, begin, end, min, max);
+}
 
-            default:
-                /* eat up rest of line */
-                fgets(buf, sizeof(buf), file);
-                break;
-        }
-  }
-
-  /* set the stats in the model structure */
-  model->numvertices  = numvertices;
-  model->numnormals   = numnormals;
-  model->numtexcoords = numtexcoords;
-  model->numtriangles = numtriangles;
-
-  /* allocate memory for the triangles in each group */
-  group = model->groups;
-  while(group) {
-      group->triangles = (GLuint*)malloc(sizeof(GLuint) * group->numtriangles);
-      group->numtriangles = 0;
-      group = group->next;
-  }
+/* glmTransformPart: glmTransformRange() on one part of a sweep */
+static GLvoid
+glmTransformPart(GLMmodel* model, GLuint begin, GLuint end,
+                 const GLfloat* translate, GLfloat scale,
+                 const GLfloat* center, GLfloat* radius2)
+{
+    if (model->layout == GLM_SOA)
+        glmTransformSoA(model->soa, begin, end, translate, scale,
+            center, radius2);
+    else
+        glmTransformRange(model->vertices, begin, end, translate, scale,
+            center, radius2);
 }
 
-/* glmSecondPass: second pass at a Wavefront OBJ file that gets all
- * the data.
- *
- * model - properly initialized GLMmodel structure
- * file  - (fopen'd) file descriptor
- */
+/* glmBounds: rescan the vertices for the bounding box, in parallel
+ * for big models */
 static GLvoid
-glmSecondPass(GLMmodel* model, FILE* file)
+glmBounds(GLMmodel* model)
 {
-    GLuint numvertices;        /* number of vertices in model */
-    GLuint numnormals;         /* number of normals in model */
-    GLuint numtexcoords;       /* number of texcoords in model */
-    GLuint numtriangles;       /* number of triangles in model */
-    GLfloat* vertices;         /* array of vertices  */
-    GLfloat* normals;          /* array of normals */
-    GLfloat* texcoords;        /* array of texture coordinates */
-    GLMgroup* group;           /* current group pointer */
-    GLuint material;           /* current material */
-    int v, n, t;
-    char buf[128];
-
-    /* set the pointer shortcuts */
-    vertices       = model->vertices;
-    normals    = model->normals;
-    texcoords    = model->texcoords;
-    group      = model->groups;
-
-    /* on the second pass through the file, read all the data into the
-    allocated arrays */
-    numvertices = numnormals = numtexcoords = 1;
-    numtriangles = 0;
-    material = 0;
-    while(fscanf(file, "%s", buf) != EOF) {
-        switch(buf[0]) {
-        case '#':               /* comment */
-            /* eat up rest of line */
-            fgets(buf, sizeof(buf), file);
-            break;
-        case 'v':               /* v, vn, vt */
-            switch(buf[1]) {
-            case '\0':          /* vertex */
-                fscanf(file, "%f %f %f",
-                    &vertices[3 * numvertices + 0],
-                    &vertices[3 * numvertices + 1],
-                    &vertices[3 * numvertices + 2]);
-                numvertices++;
-                break;
-            case 'n':           /* normal */
-                fscanf(file, "%f %f %f",
-                    &normals[3 * numnormals + 0],
-                    &normals[3 * numnormals + 1],
-                    &normals[3 * numnormals + 2]);
-                numnormals++;
-                break;
-            case 't':           /* texcoord */
-                fscanf(file, "%f %f",
-                    &texcoords[2 * numtexcoords + 0],
-                    &texcoords[2 * numtexcoords + 1]);
-                numtexcoords++;
-                break;
-            }
-            break;
-            case 'u':
-                fgets(buf, sizeof(buf), file);
-                sscanf(buf, "%s %s", buf, buf);
-                group->material = material = glmFindMaterial(model, buf);
-                break;
-            case 'g':               /* group */
-                /* eat up rest of line */
-                fgets(buf, sizeof(buf), file);
-#if SINGLE_STRING_GROUP_NAMES
-                sscanf(buf, "%s", buf);
-#else
-                buf[strlen(buf)-1] = '\0';  /* nuke '\n' */
-#endif
-                group = glmFindGroup(model, buf);
-                group->material = material;
-                break;
-            case 'f':               /* face */
-                v = n = t = 0;
-                fscanf(file, "%s", buf);
-                /* can be one of %d, %d//%d, %d/%d, %d/%d/%d %d//%d */
-                if (strstr(buf, "//")) {
-                    /* v//n */
-                    sscanf(buf, "%d//%d", &v, &n);
-                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).nindices[0] = n < 0 ? n + numnormals : n;
-                    fscanf(file, "%d//%d", &v, &n);
-                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).nindices[1] = n < 0 ? n + numnormals : n;
-                    fscanf(file, "%d//%d", &v, &n);
-                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-                    group->triangles[group->numtriangles++] = numtriangles;
-                    numtriangles++;
-                    while(fscanf(file, "%d//%d", &v, &n) > 0) {
-                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-                        T(numtriangles).nindices[0] = T(numtriangles-1).nindices[0];
-                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-                        T(numtriangles).nindices[1] = T(numtriangles-1).nindices[2];
-                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                        T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-                        group->triangles[group->numtriangles++] = numtriangles;
-                        numtriangles++;
-                    }
-                } else if (sscanf(buf, "%d/%d/%d", &v, &t, &n) == 3) {
-                    /* v/t/n */
-                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[0] = t < 0 ? t + numtexcoords : t;
-                    T(numtriangles).nindices[0] = n < 0 ? n + numnormals : n;
-                    fscanf(file, "%d/%d/%d", &v, &t, &n);
-                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[1] = t < 0 ? t + numtexcoords : t;
-                    T(numtriangles).nindices[1] = n < 0 ? n + numnormals : n;
-                    fscanf(file, "%d/%d/%d", &v, &t, &n);
-                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
-                    T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-                    group->triangles[group->numtriangles++] = numtriangles;
-                    numtriangles++;
-                    while(fscanf(file, "%d/%d/%d", &v, &t, &n) > 0) {
-                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-                        T(numtriangles).tindices[0] = T(numtriangles-1).tindices[0];
-                        T(numtriangles).nindices[0] = T(numtriangles-1).nindices[0];
-                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-                        T(numtriangles).tindices[1] = T(numtriangles-1).tindices[2];
-                        T(numtriangles).nindices[1] = T(numtriangles-1).nindices[2];
-                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                        T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
-                        T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-                        group->triangles[group->numtriangles++] = numtriangles;
-                        numtriangles++;
-                    }
-                } else if (sscanf(buf, "%d/%d", &v, &t) == 2) {
-                    /* v/t */
-                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[0] = t < 0 ? t + numtexcoords : t;
-                    fscanf(file, "%d/%d", &v, &t);
-                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[1] = t < 0 ? t + numtexcoords : t;
-                    fscanf(file, "%d/%d", &v, &t);
-                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
-                    group->triangles[group->numtriangles++] = numtriangles;
-                    numtriangles++;
-                    while(fscanf(file, "%d/%d", &v, &t) > 0) {
-                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-                        T(numtriangles).tindices[0] = T(numtriangles-1).tindices[0];
-                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-                        T(numtriangles).tindices[1] = T(numtriangles-1).tindices[2];
-                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                        T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
-                        group->triangles[group->numtriangles++] = numtriangles;
-                        numtriangles++;
-                    }
-                } else {
-                    /* v */
-                    sscanf(buf, "%d", &v);
-                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
-                    fscanf(file, "%d", &v);
-                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
-                    fscanf(file, "%d", &v);
-                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                    group->triangles[group->numtriangles++] = numtriangles;
-                    numtriangles++;
-                    while(fscanf(file, "%d", &v) > 0) {
-                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                        group->triangles[group->numtriangles++] = numtriangles;
-                        numtriangles++;
-                    }
-                }
-                break;
+    std::vector<std::thread> threads;
+    std::vector<GLfloat> bounds;
+    GLuint i, j, numthreads;
+
+    model->dirty &= ~GLM_DIRTY_BOUNDS;
+    model->dirty |= GLM_DIRTY_SPHERE;
+
+    if (!model->numvertices) {
+        for (j = 0; j < 3; j++)
+            model->min[j] = model->max[j] = 0.0;
+        return;
+    }
+
+    /* every part starts from the first vertex */
+    numthreads = glmSweepThreads(model);
+    bounds.resize(6 * numthreads);
+    for (i = 0; i < numthreads; i++)
+        for (j = 0; j < 3; j++)
+            bounds[6 * i + j] = bounds[6 * i + 3 + j] =
+                model->layout == GLM_SOA ? model->soa[j][0] :
+                model->vertices[3 + j];
+    if (numthreads == 1) {
+        glmBoundsPart(model, glmSweepSplit(model, 0, 1),
+            glmSweepSplit(model, 1, 1), &bounds[0], &bounds[3]);
+    } else {
+        for (i = 0; i < numthreads; i++)
+            threads.push_back(std::thread(glmBoundsPart, model,
+                glmSweepSplit(model, i, numthreads),
+                glmSweepSplit(model, i + 1, numthreads),
+                &bounds[6 * i], &bounds[6 * i + 3]));
+        for (i = 0; i < numthreads; i++)
+            threads[i].join();
+    }
+
+    for (j = 0; j < 3; j++)
+        model->min[j] = model->max[j] = bounds[j];
+    for (i = 0; i < numthreads; i++) {
+        for (j = 0; j < 3; j++) {
+            if (model->max[j] < bounds[6 * i + 3 + j])
+                model->max[j] = bounds[6 * i + 3 + j];
+            if (model->min[j] > bounds[6 * i + j])
+                model->min[j] = bounds[6 * i + j];
+        }
+    }
+}
 
-            default:
-                /* eat up rest of line */
-                fgets(buf, sizeof(buf), file);
-                break;
+/* glmTransform: v = (v - translate) * scale over all the vertices
+ * (translate may be NULL to only measure), and if the bounding box is
+ * valid (already for the transformed vertices) find the bounding
+ * sphere in the same sweep.  In parallel for big models. */
+static GLvoid
+glmTransform(GLMmodel* model, const GLfloat* translate, GLfloat scale)
+{
+    std::vector<std::thread> threads;
+    std::vector<GLfloat> radii;
+    GLfloat* center = NULL;
+    GLuint i, numthreads;
+
+    if (!(model->dirty & GLM_DIRTY_BOUNDS)) {
+        center = model->center;
+        for (i = 0; i < 3; i++)
+            center[i] = (model->min[i] + model->max[i]) / 2.0;
+    }
+
+    numthreads = glmSweepThreads(model);
+    radii.assign(numthreads, 0.0);
+    if (numthreads == 1) {
+        glmTransformPart(model, glmSweepSplit(model, 0, 1),
+            glmSweepSplit(model, 1, 1), translate, scale, center,
+            &radii[0]);
+    } else {
+        for (i = 0; i < numthreads; i++)
+            threads.push_back(std::thread(glmTransformPart, model,
+                glmSweepSplit(model, i, numthreads),
+                glmSweepSplit(model, i + 1, numthreads),
+                translate, scale, center, &radii[i]));
+        for (i = 0; i < numthreads; i++)
+            threads[i].join();
+    }
+
+    if (translate && model->layout == GLM_SOA)
+        model->dirty |= GLM_DIRTY_PACKED;
+
+    if (center) {
+        for (i = 1; i < numthreads; i++)
+            if (radii[0] < radii[i])
+                radii[0] = radii[i];
+        model->radius = sqrt(radii[0]);
+        model->dirty &= ~GLM_DIRTY_SPHERE;
+    } else {
+        model->dirty |= GLM_DIRTY_SPHERE;
     }
-  }
+}
 
-#if 0
-  /* announce the memory requirements */
-  printf(" Memory: %d bytes\n",
-      numvertices  * 3*sizeof(GLfloat) +
-      numnormals   * 3*sizeof(GLfloat) * (numnormals ? 1 : 0) +
-      numtexcoords * 3*sizeof(GLfloat) * (numtexcoords ? 1 : 0) +
-      numtriangles * sizeof(GLMtriangle));
-#endif
+/* glmUnpack: (re)build the soa arrays from the vertices array */
+static GLvoid
+glmUnpack(GLMmodel* model)
+{
+    GLuint i, j, padded;
+
+    for (j = 3; j-- > 0; ) {
+        glmFree(model, model->soa[j]);
+        model->soa[j] = NULL;
+    }
+    padded = glmPadded(model);
+    if (!padded)
+        return;
+
+    /* the simd kernels load whole vectors, so each array starts on a
+       cache line (padded floats are a whole number of them) */
+    for (j = 0; j < 3; j++) {
+        model->soa[j] = (GLfloat*)aligned_alloc(GLM_ARENA_ALIGN,
+            sizeof(GLfloat) * padded);
+        for (i = 0; i < model->numvertices; i++)
+            model->soa[j][i] = model->vertices[3 * (i + 1) + j];
+        for (; i < padded; i++)
+            model->soa[j][i] = model->soa[j][model->numvertices - 1];
+    }
+    model->dirty &= ~GLM_DIRTY_PACKED;
 }
 
 
@@ -773,31 +733,17 @@ glmUnitize(GLMmodel* model)
     GLuint i;
     GLfloat maxx, minx, maxy, miny, maxz, minz;
     GLfloat cx, cy, cz, w, h, d;
-    GLfloat scale;
+    GLfloat scale, translate[3];
 
     assert(model);
     assert(model->vertices);
 
     /* get the max/mins */
-    maxx = minx = model->vertices[3 + 0];
-    maxy = miny = model->vertices[3 + 1];
-    maxz = minz = model->vertices[3 + 2];
-    for (i = 1; i <= model->numvertices; i++) {
-        if (maxx < model->vertices[3 * i + 0])
-            maxx = model->vertices[3 * i + 0];
-        if (minx > model->vertices[3 * i + 0])
-            minx = model->vertices[3 * i + 0];
-
-        if (maxy < model->vertices[3 * i + 1])
-            maxy = model->vertices[3 * i + 1];
-        if (miny > model->vertices[3 * i + 1])
-            miny = model->vertices[3 * i + 1];
-
-        if (maxz < model->vertices[3 * i + 2])
-            maxz = model->vertices[3 * i + 2];
-        if (minz > model->vertices[3 * i + 2])
-            minz = model->vertices[3 * i + 2];
-    }
+    if (model->dirty & GLM_DIRTY_BOUNDS)
+        glmBounds(model);
+    maxx = model->max[0]; minx = model->min[0];
+    maxy = model->max[1]; miny = model->min[1];
+    maxz = model->max[2]; minz = model->min[2];
 
     /* calculate model width, height, and depth */
     w = glmAbs(maxx) + glmAbs(minx);
@@ -812,15 +758,22 @@ glmUnitize(GLMmodel* model)
     /* calculate unitizing scale factor */
     scale = 2.0 / glmMax(glmMax(w, h), d);
 
-    /* translate around center then scale */
-    for (i = 1; i <= model->numvertices; i++) {
-        model->vertices[3 * i + 0] -= cx;
-        model->vertices[3 * i + 1] -= cy;
-        model->vertices[3 * i + 2] -= cz;
-        model->vertices[3 * i + 0] *= scale;
-        model->vertices[3 * i + 1] *= scale;
-        model->vertices[3 * i + 2] *= scale;
+    /* the transform is monotonic, so the new bounding box is just the
+       old one transformed (bit for bit) */
+    translate[0] = cx;
+    translate[1] = cy;
+    translate[2] = cz;
+    for (i = 0; i < 3; i++) {
+        model->min[i] = (model->min[i] - translate[i]) * scale;
+        model->max[i] = (model->max[i] - translate[i]) * scale;
     }
+    if (!(scale > 0.0) || isinf(scale))
+        model->dirty |= GLM_DIRTY_BOUNDS;
+
+    /* translate around center then scale */
+    glmTransform(model, translate, scale);
+
+    model->version++;
 
     return scale;
 }
@@ -834,38 +787,120 @@ glmUnitize(GLMmodel* model)
 GLvoid
 glmDimensions(GLMmodel* model, GLfloat* dimensions)
 {
-    GLuint i;
-    GLfloat maxx, minx, maxy, miny, maxz, minz;
-
     assert(model);
     assert(model->vertices);
     assert(dimensions);
 
-    /* get the max/mins */
-    maxx = minx = model->vertices[3 + 0];
-    maxy = miny = model->vertices[3 + 1];
-    maxz = minz = model->vertices[3 + 2];
-    for (i = 1; i <= model->numvertices; i++) {
-        if (maxx < model->vertices[3 * i + 0])
-            maxx = model->vertices[3 * i + 0];
-        if (minx > model->vertices[3 * i + 0])
-            minx = model->vertices[3 * i + 0];
+    /* rescan only if the vertices changed in some untracked way */
+    if (model->dirty & GLM_DIRTY_BOUNDS)
+        glmBounds(model);
+
+    /* calculate model width, height, and depth */
+    dimensions[0] = glmAbs(model->max[0]) + glmAbs(model->min[0]);
+    dimensions[1] = glmAbs(model->max[1]) + glmAbs(model->min[1]);
+    dimensions[2] = glmAbs(model->max[2]) + glmAbs(model->min[2]);
+}
+
+/* glmBoundingBox: Returns the axis aligned bounding box of a model.
+ *
+ * model - initialized GLMmodel structure
+ * min   - array of 3 GLfloats (GLfloat min[3]), minimum x, y and z
+ * max   - array of 3 GLfloats (GLfloat max[3]), maximum x, y and z
+ */
+GLvoid
+glmBoundingBox(GLMmodel* model, GLfloat* min, GLfloat* max)
+{
+    GLuint i;
+
+    assert(model);
+    assert(min);
+    assert(max);
 
-        if (maxy < model->vertices[3 * i + 1])
-            maxy = model->vertices[3 * i + 1];
-        if (miny > model->vertices[3 * i + 1])
-            miny = model->vertices[3 * i + 1];
+    if (model->dirty & GLM_DIRTY_BOUNDS)
+        glmBounds(model);
 
-        if (maxz < model->vertices[3 * i + 2])
-            maxz = model->vertices[3 * i + 2];
-        if (minz > model->vertices[3 * i + 2])
-            minz = model->vertices[3 * i + 2];
+    for (i = 0; i < 3; i++) {
+        min[i] = model->min[i];
+        max[i] = model->max[i];
     }
+}
 
-    /* calculate model width, height, and depth */
-    dimensions[0] = glmAbs(maxx) + glmAbs(minx);
-    dimensions[1] = glmAbs(maxy) + glmAbs(miny);
-    dimensions[2] = glmAbs(maxz) + glmAbs(minz);
+/* glmBoundingSphere: Returns a bounding sphere of a model, centered on
+ * its bounding box.
+ *
+ * model  - initialized GLMmodel structure
+ * center - array of 3 GLfloats (GLfloat center[3])
+ * radius - set to the radius of the sphere
+ */
+GLvoid
+glmBoundingSphere(GLMmodel* model, GLfloat* center, GLfloat* radius)
+{
+    assert(model);
+    assert(center);
+    assert(radius);
+
+    if (model->dirty & GLM_DIRTY_BOUNDS)
+        glmBounds(model);
+    if (model->dirty & GLM_DIRTY_SPHERE)
+        glmTransform(model, NULL, 1.0);
+
+    center[0] = model->center[0];
+    center[1] = model->center[1];
+    center[2] = model->center[2];
+    *radius = model->radius;
+}
+
+/* glmVertexLayout: Switches the layout the vertices of a model are
+ * kept in (GLM_AOS or GLM_SOA).
+ *
+ * model  - initialized GLMmodel structure (not still streaming)
+ * layout - GLM_AOS or GLM_SOA
+ */
+GLvoid
+glmVertexLayout(GLMmodel* model, GLuint layout)
+{
+    GLuint j;
+
+    assert(model);
+    assert(!model->stream);
+
+    if (layout == model->layout)
+        return;
+
+    if (layout == GLM_SOA) {
+        model->layout = GLM_SOA;
+        glmUnpack(model);
+    } else {
+        glmVertices(model);
+        for (j = 3; j-- > 0; ) {
+            glmFree(model, model->soa[j]);
+            model->soa[j] = NULL;
+        }
+        model->layout = GLM_AOS;
+    }
+}
+
+/* glmVertices: Returns the interleaved vertices array of a model, up
+ * to date.
+ *
+ * model - initialized GLMmodel structure
+ */
+GLfloat*
+glmVertices(GLMmodel* model)
+{
+    GLuint i;
+
+    assert(model);
+
+    if (model->dirty & GLM_DIRTY_PACKED) {
+        for (i = 0; i < model->numvertices; i++) {
+            model->vertices[3 * (i + 1) + 0] = model->soa[0][i];
+            model->vertices[3 * (i + 1) + 1] = model->soa[1][i];
+            model->vertices[3 * (i + 1) + 2] = model->soa[2][i];
+        }
+        model->dirty &= ~GLM_DIRTY_PACKED;
+    }
+    return model->vertices;
 }
 
 /* glmScale: Scales a model by a given amount.
@@ -876,13 +911,31 @@ glmDimensions(GLMmodel* model, GLfloat* dimensions)
 GLvoid
 glmScale(GLMmodel* model, GLfloat scale)
 {
+    static const GLfloat origin[3] = { 0.0, 0.0, 0.0 };
+    GLfloat min;
     GLuint i;
 
-    for (i = 1; i <= model->numvertices; i++) {
-        model->vertices[3 * i + 0] *= scale;
-        model->vertices[3 * i + 1] *= scale;
-        model->vertices[3 * i + 2] *= scale;
+    assert(model);
+
+    /* v * scale is monotonic too, just backwards for a negative scale
+       (and v - 0 is v, so the sweep scales exactly as before) */
+    if (!(model->dirty & GLM_DIRTY_BOUNDS)) {
+        for (i = 0; i < 3; i++) {
+            min = model->min[i] * scale;
+            model->max[i] = model->max[i] * scale;
+            model->min[i] = min;
+            if (scale < 0.0) {
+                model->min[i] = model->max[i];
+                model->max[i] = min;
+            }
+        }
+        if (scale != scale || isinf(scale))
+            model->dirty |= GLM_DIRTY_BOUNDS;
     }
+
+    glmTransform(model, origin, scale);
+
+    model->version++;
 }
 
 /* glmReverseWinding: Reverse the polygon winding for all polygons in
@@ -929,148 +982,194 @@ glmReverseWinding(GLMmodel* model)
         model->normals[3 * i + 1] = -model->normals[3 * i + 1];
         model->normals[3 * i + 2] = -model->normals[3 * i + 2];
     }
+
+    model->version++;
 }
 
 /* glmFacetNormals: Generates facet normals for a model (by taking the
  * cross product of the two vectors derived from the sides of each
- * triangle).  Assumes a counter-clockwise winding.
+ * triangle).  Assumes a counter-clockwise winding.  The normals are
+ * computed several triangles at a time with SIMD instructions, and
+ * large models are split across threads.
  *
  * model - initialized GLMmodel structure
  */
 GLvoid
 glmFacetNormals(GLMmodel* model)
 {
-    GLuint  i;
-    GLfloat u[3];
-    GLfloat v[3];
+    std::vector<std::thread> threads;
+    GLuint i, numthreads, begin, end;
 
     assert(model);
     assert(model->vertices);
+    glmVertices(model);
 
     /* clobber any old facetnormals */
-    if (model->facetnorms)
-        free(model->facetnorms);
+    glmFree(model, model->facetnorms);
 
     /* allocate memory for the new facet normals */
     model->numfacetnorms = model->numtriangles;
     model->facetnorms = (GLfloat*)malloc(sizeof(GLfloat) *
                        3 * (model->numfacetnorms + 1));
 
+    numthreads = model->numtriangles < GLM_PARALLEL_TRIANGLES ? 1 :
+        std::thread::hardware_concurrency();
+    if (numthreads < 2) {
+        glmFacetNormalsRange(model, 0, model->numtriangles);
+        return;
+    }
+
+    /* ranges are multiples of 8 triangles so every thread stays on the
+       full width SIMD path (except at the very end) */
+    for (i = 0; i < numthreads; i++) {
+        begin = (GLuint)((unsigned long long)model->numtriangles *
+            i / numthreads) & ~7u;
+        end = i + 1 == numthreads ? model->numtriangles :
+            (GLuint)((unsigned long long)model->numtriangles *
+            (i + 1) / numthreads) & ~7u;
+        threads.push_back(std::thread(glmFacetNormalsRange, model,
+            begin, end));
+    }
+    for (i = 0; i < numthreads; i++)
+        threads[i].join();
+}
+
+/* GLMcorner: a triangle corner in the per vertex lists of
+ * glmVertexNormals(), with a copy of the triangle's facet normal so
+ * the lists can be walked without touching the triangles */
+typedef struct _GLMcorner {
+    GLuint  corner;             /* triangle index << 2 | corner (0-2) */
+    GLfloat normal[3];          /* facet normal of the triangle */
+} GLMcorner;
+
+/* GLMsmooth: state shared by the passes of glmVertexNormals().  The
+ * corners around vertex v are corners[offsets[v]] up to (not
+ * including) corners[offsets[v + 1]], highest triangle first, which
+ * is the order the original linked lists were in.
+ */
+typedef struct _GLMsmooth {
+    GLMmodel*  model;
+    GLfloat    cos_angle;
+    GLuint*    offsets;         /* numvertices + 2 list offsets */
+    GLMcorner* corners;         /* 3 * numtriangles corners */
+} GLMsmooth;
+
+/* glmSmoothCorners: sort the triangle corners by vertex (a counting
+ * sort into compressed sparse row form) */
+static GLvoid
+glmSmoothCorners(GLMsmooth* smooth)
+{
+    GLMmodel* model = smooth->model;
+    GLuint* offsets;
+    GLMcorner* corner;
+    GLfloat* facet;
+    GLuint i, j, c, v;
+
+    offsets = (GLuint*)calloc(model->numvertices + 2, sizeof(GLuint));
+    smooth->corners = (GLMcorner*)malloc(sizeof(GLMcorner) *
+        (3 * model->numtriangles + 1));
+
+    /* count the corners of each vertex, then turn the counts into the
+       offset of the end of each vertex's list */
     for (i = 0; i < model->numtriangles; i++) {
-        model->triangles[i].findex = i+1;
+        offsets[T(i).vindices[0]]++;
+        offsets[T(i).vindices[1]]++;
+        offsets[T(i).vindices[2]]++;
+    }
+    for (i = 1; i <= model->numvertices + 1; i++)
+        offsets[i] += offsets[i - 1];
 
-        u[0] = model->vertices[3 * T(i).vindices[1] + 0] -
-            model->vertices[3 * T(i).vindices[0] + 0];
-        u[1] = model->vertices[3 * T(i).vindices[1] + 1] -
-            model->vertices[3 * T(i).vindices[0] + 1];
-        u[2] = model->vertices[3 * T(i).vindices[1] + 2] -
-            model->vertices[3 * T(i).vindices[0] + 2];
+    /* fill each list from its end, so it comes out in descending
+       triangle order and the offsets end up at the start of the lists */
+    for (i = 0; i < model->numtriangles; i++) {
+        facet = &model->facetnorms[3 * T(i).findex];
+        for (j = 0; j < 3; j++) {
+            /* a vertex used twice by a triangle always gets the normal
+               of its first corner */
+            v = T(i).vindices[j];
+            c = T(i).vindices[0] == v ? 0 : T(i).vindices[1] == v ? 1 : 2;
+            corner = &smooth->corners[--offsets[v]];
+            corner->corner = i << 2 | c;
+            corner->normal[0] = facet[0];
+            corner->normal[1] = facet[1];
+            corner->normal[2] = facet[2];
+        }
+    }
 
-        v[0] = model->vertices[3 * T(i).vindices[2] + 0] -
-            model->vertices[3 * T(i).vindices[0] + 0];
-        v[1] = model->vertices[3 * T(i).vindices[2] + 1] -
-            model->vertices[3 * T(i).vindices[0] + 1];
-        v[2] = model->vertices[3 * T(i).vindices[2] + 2] -
-            model->vertices[3 * T(i).vindices[0] + 2];
+    smooth->offsets = offsets;
+}
 
-        glmCross(u, v, &model->facetnorms[3 * (i+1)]);
-        glmNormalize(&model->facetnorms[3 * (i+1)]);
+/* glmSmoothCount: count the normals the vertices in [begin, end) will
+ * need: one for the average (if any facet normal is averaged) and one
+ * for every facet normal that isn't.
+ */
+static GLvoid
+glmSmoothCount(GLMsmooth* smooth, GLuint begin, GLuint end, GLuint* count)
+{
+    const GLuint* offsets = smooth->offsets;
+    GLMcorner* corners = smooth->corners;
+    GLfloat* first;
+    GLfloat cos_angle = smooth->cos_angle;
+    GLuint i, k, n, avg, averaged;
+
+    /* (written without branches on the angle test, which is as good
+       as random at hard edges) */
+    n = 0;
+    for (i = begin; i < end; i++) {
+        if (offsets[i] == offsets[i + 1])
+            continue;
+        avg = 0;
+        first = corners[offsets[i]].normal;
+        for (k = offsets[i]; k < offsets[i + 1]; k++) {
+            averaged = glmDot(corners[k].normal, first) > cos_angle;
+            avg |= averaged;
+            n += !averaged;
+        }
+        n += avg;
     }
+    *count = n;
 }
 
-/* glmVertexNormals: Generates smooth vertex normals for a model.
- * First builds a list of all the triangles each vertex is in.   Then
- * loops through each vertex in the the list averaging all the facet
- * normals of the triangles each vertex is in.   Finally, sets the
- * normal index in the triangle for the vertex to the generated smooth
- * normal.   If the dot product of a facet normal and the facet normal
- * associated with the first triangle in the list of triangles the
- * current vertex is in is greater than the cosine of the angle
- * parameter to the function, that facet normal is not added into the
- * average normal calculation and the corresponding vertex is given
- * the facet normal.  This tends to preserve hard edges.  The angle to
- * use depends on the model, but 90 degrees is usually a good start.
- *
- * model - initialized GLMmodel structure
- * angle - maximum angle (in degrees) to smooth across
+/* glmSmoothVertices: average the facet normals around the vertices in
+ * [begin, end), store the resulting normals starting at index next
+ * and point the triangle corners at them.
  */
-GLvoid
-glmVertexNormals(GLMmodel* model, GLfloat angle)
+static GLvoid
+glmSmoothVertices(GLMsmooth* smooth, GLuint begin, GLuint end, GLuint next)
 {
-    GLMnode* node;
-    GLMnode* tail;
-    GLMnode** members;
-    GLfloat* normals;
-    GLuint numnormals;
+    GLMmodel* model = smooth->model;
+    const GLuint* offsets = smooth->offsets;
+    GLMcorner* corners = smooth->corners;
+    GLfloat* normals = model->normals;
+    GLfloat* first;
+    GLfloat* facet;
     GLfloat average[3];
-    GLfloat dot, cos_angle;
-    GLuint i, avg;
-
-    assert(model);
-    assert(model->facetnorms);
-
-    /* calculate the cosine of the angle (in degrees) */
-    cos_angle = cos(angle * M_PI / 180.0);
+    GLfloat cos_angle = smooth->cos_angle;
+    GLuint i, k, avg;
 
-    /* nuke any previous normals */
-    if (model->normals)
-        free(model->normals);
-
-    /* allocate space for new normals */
-    model->numnormals = model->numtriangles * 3; /* 3 normals per triangle */
-    model->normals = (GLfloat*)malloc(sizeof(GLfloat)* 3* (model->numnormals+1));
-
-    /* allocate a structure that will hold a linked list of triangle
-    indices for each vertex */
-    members = (GLMnode**)malloc(sizeof(GLMnode*) * (model->numvertices + 1));
-    for (i = 1; i <= model->numvertices; i++)
-        members[i] = NULL;
-
-    /* for every triangle, create a node for each vertex in it */
-    for (i = 0; i < model->numtriangles; i++) {
-        node = (GLMnode*)malloc(sizeof(GLMnode));
-        node->index = i;
-        node->next  = members[T(i).vindices[0]];
-        members[T(i).vindices[0]] = node;
-
-        node = (GLMnode*)malloc(sizeof(GLMnode));
-        node->index = i;
-        node->next  = members[T(i).vindices[1]];
-        members[T(i).vindices[1]] = node;
-
-        node = (GLMnode*)malloc(sizeof(GLMnode));
-        node->index = i;
-        node->next  = members[T(i).vindices[2]];
-        members[T(i).vindices[2]] = node;
-    }
-
-    /* calculate the average normal for each vertex */
-    numnormals = 1;
-    for (i = 1; i <= model->numvertices; i++) {
-    /* calculate an average normal for this vertex by averaging the
-        facet normal of every triangle this vertex is in */
-        node = members[i];
-        if (!node)
+    for (i = begin; i < end; i++) {
+        if (offsets[i] == offsets[i + 1]) {
             fprintf(stderr, "glmVertexNormals(): vertex w/o a triangle\n");
+            continue;
+        }
+
+        /* calculate an average normal for this vertex by averaging the
+        facet normal of every triangle this vertex is in.  Only average
+        if the dot product of the angle between the two facet normals
+        is greater than the cosine of the threshold angle -- or, said
+        another way, the angle between the two facet normals is less
+        than (or equal to) the threshold angle */
         average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
         avg = 0;
-        while (node) {
-        /* only average if the dot product of the angle between the two
-        facet normals is greater than the cosine of the threshold
-        angle -- or, said another way, the angle between the two
-            facet normals is less than (or equal to) the threshold angle */
-            dot = glmDot(&model->facetnorms[3 * T(node->index).findex],
-                &model->facetnorms[3 * T(members[i]->index).findex]);
-            if (dot > cos_angle) {
-                node->averaged = GL_TRUE;
-                average[0] += model->facetnorms[3 * T(node->index).findex + 0];
-                average[1] += model->facetnorms[3 * T(node->index).findex + 1];
-                average[2] += model->facetnorms[3 * T(node->index).findex + 2];
+        first = corners[offsets[i]].normal;
+        for (k = offsets[i]; k < offsets[i + 1]; k++) {
+            facet = corners[k].normal;
+            if (glmDot(facet, first) > cos_angle) {
+                average[0] += facet[0];
+                average[1] += facet[1];
+                average[2] += facet[2];
                 avg = 1;            /* we averaged at least one normal! */
-            } else {
-                node->averaged = GL_FALSE;
             }
-            node = node->next;
         }
 
         if (avg) {
@@ -1078,69 +1177,116 @@ glmVertexNormals(GLMmodel* model, GLfloat angle)
             glmNormalize(average);
 
             /* add the normal to the vertex normals list */
-            model->normals[3 * numnormals + 0] = average[0];
-            model->normals[3 * numnormals + 1] = average[1];
-            model->normals[3 * numnormals + 2] = average[2];
-            avg = numnormals;
-            numnormals++;
+            normals[3 * next + 0] = average[0];
+            normals[3 * next + 1] = average[1];
+            normals[3 * next + 2] = average[2];
+            avg = next++;
         }
 
-        /* set the normal of this vertex in each triangle it is in */
-        node = members[i];
-        while (node) {
-            if (node->averaged) {
-                /* if this node was averaged, use the average normal */
-                if (T(node->index).vindices[0] == i)
-                    T(node->index).nindices[0] = avg;
-                else if (T(node->index).vindices[1] == i)
-                    T(node->index).nindices[1] = avg;
-                else if (T(node->index).vindices[2] == i)
-                    T(node->index).nindices[2] = avg;
+        /* set the normal of this vertex in each triangle it is in: the
+           average if it was averaged, its own facet normal if not */
+        for (k = offsets[i]; k < offsets[i + 1]; k++) {
+            facet = corners[k].normal;
+            if (glmDot(facet, first) > cos_angle) {
+                T(corners[k].corner >> 2).nindices[corners[k].corner & 3] = avg;
             } else {
-                /* if this node wasn't averaged, use the facet normal */
-                model->normals[3 * numnormals + 0] =
-                    model->facetnorms[3 * T(node->index).findex + 0];
-                model->normals[3 * numnormals + 1] =
-                    model->facetnorms[3 * T(node->index).findex + 1];
-                model->normals[3 * numnormals + 2] =
-                    model->facetnorms[3 * T(node->index).findex + 2];
-                if (T(node->index).vindices[0] == i)
-                    T(node->index).nindices[0] = numnormals;
-                else if (T(node->index).vindices[1] == i)
-                    T(node->index).nindices[1] = numnormals;
-                else if (T(node->index).vindices[2] == i)
-                    T(node->index).nindices[2] = numnormals;
-                numnormals++;
+                normals[3 * next + 0] = facet[0];
+                normals[3 * next + 1] = facet[1];
+                normals[3 * next + 2] = facet[2];
+                T(corners[k].corner >> 2).nindices[corners[k].corner & 3] = next;
+                next++;
             }
-            node = node->next;
         }
     }
+}
 
-    model->numnormals = numnormals - 1;
+/* glmVertexNormals: Generates smooth vertex normals for a model.
+ * First builds a list of all the triangles each vertex is in.   Then
+ * loops through each vertex in the the list averaging all the facet
+ * normals of the triangles each vertex is in.   Finally, sets the
+ * normal index in the triangle for the vertex to the generated smooth
+ * normal.   If the dot product of a facet normal and the facet normal
+ * associated with the first triangle in the list of triangles the
+ * current vertex is in is greater than the cosine of the angle
+ * parameter to the function, that facet normal is not added into the
+ * average normal calculation and the corresponding vertex is given
+ * the facet normal.  This tends to preserve hard edges.  The angle to
+ * use depends on the model, but 90 degrees is usually a good start.
+ * Large models are processed on several threads, each taking a range
+ * of vertices.
+ *
+ * model - initialized GLMmodel structure
+ * angle - maximum angle (in degrees) to smooth across
+ */
+GLvoid
+glmVertexNormals(GLMmodel* model, GLfloat angle)
+{
+    std::vector<std::thread> threads;
+    GLMsmooth smooth;
+    GLuint* ranges;
+    GLuint* counts;
+    GLuint i, numthreads, numnormals;
 
-    /* free the member information */
-    for (i = 1; i <= model->numvertices; i++) {
-        node = members[i];
-        while (node) {
-            tail = node;
-            node = node->next;
-            free(tail);
-        }
+    assert(model);
+    assert(model->facetnorms);
+
+    /* calculate the cosine of the angle (in degrees) */
+    smooth.model = model;
+    smooth.cos_angle = cos(angle * M_PI / 180.0);
+
+    /* build the list of triangles each vertex is in */
+    glmSmoothCorners(&smooth);
+
+    /* split the vertices into one range per thread */
+    numthreads = std::thread::hardware_concurrency();
+    if (numthreads < 2 || model->numvertices < GLM_PARALLEL_VERTICES)
+        numthreads = 1;
+    ranges = (GLuint*)malloc(sizeof(GLuint) * (numthreads + 1));
+    counts = (GLuint*)malloc(sizeof(GLuint) * numthreads);
+    for (i = 0; i <= numthreads; i++)
+        ranges[i] = 1 + (GLuint)((unsigned long long)model->numvertices *
+            i / numthreads);
+
+    /* count the normals of each range to know where its normals start
+       (they are numbered in vertex order, as if made one at a time) */
+    if (numthreads == 1) {
+        glmSmoothCount(&smooth, ranges[0], ranges[1], &counts[0]);
+    } else {
+        for (i = 0; i < numthreads; i++)
+            threads.push_back(std::thread(glmSmoothCount, &smooth,
+                ranges[i], ranges[i + 1], &counts[i]));
+        for (i = 0; i < numthreads; i++)
+            threads[i].join();
+        threads.clear();
+    }
+    numnormals = 1;
+    for (i = 0; i < numthreads; i++) {
+        numnormals += counts[i];
+        counts[i] = numnormals - counts[i];
     }
-    free(members);
 
-    /* pack the normals array (we previously allocated the maximum
-    number of normals that could possibly be created (numtriangles *
-    3), so get rid of some of them (usually alot unless none of the
-    facet normals were averaged)) */
-    normals = model->normals;
-    model->normals = (GLfloat*)malloc(sizeof(GLfloat)* 3* (model->numnormals+1));
-    for (i = 1; i <= model->numnormals; i++) {
-        model->normals[3 * i + 0] = normals[3 * i + 0];
-        model->normals[3 * i + 1] = normals[3 * i + 1];
-        model->normals[3 * i + 2] = normals[3 * i + 2];
+    /* nuke any previous normals, and make exactly as many new ones */
+    glmFree(model, model->normals);
+    model->numnormals = numnormals - 1;
+    model->normals = (GLfloat*)malloc(sizeof(GLfloat) *
+        3 * (model->numnormals + 1));
+
+    if (numthreads == 1) {
+        glmSmoothVertices(&smooth, ranges[0], ranges[1], counts[0]);
+    } else {
+        for (i = 0; i < numthreads; i++)
+            threads.push_back(std::thread(glmSmoothVertices, &smooth,
+                ranges[i], ranges[i + 1], counts[i]));
+        for (i = 0; i < numthreads; i++)
+            threads[i].join();
     }
-    free(normals);
+
+    free(counts);
+    free(ranges);
+    free(smooth.corners);
+    free(smooth.offsets);
+
+    model->dirty &= ~GLM_DIRTY_NORMALS;
 }
 
 
@@ -1160,8 +1306,7 @@ glmLinearTexture(GLMmodel* model)
 
     assert(model);
 
-    if (model->texcoords)
-        free(model->texcoords);
+    glmFree(model, model->texcoords);
     model->numtexcoords = model->numvertices;
     model->texcoords=(GLfloat*)malloc(sizeof(GLfloat)*2*(model->numtexcoords+1));
 
@@ -1170,11 +1315,20 @@ glmLinearTexture(GLMmodel* model)
         glmAbs(glmMax(glmMax(dimensions[0], dimensions[1]), dimensions[2]));
 
     /* do the calculations */
-    for(i = 1; i <= model->numvertices; i++) {
-        x = model->vertices[3 * i + 0] * scalefactor;
-        y = model->vertices[3 * i + 2] * scalefactor;
-        model->texcoords[2 * i + 0] = (x + 1.0) / 2.0;
-        model->texcoords[2 * i + 1] = (y + 1.0) / 2.0;
+    if (model->layout == GLM_SOA) {
+        for (i = 0; i < model->numvertices; i++) {
+            x = model->soa[0][i] * scalefactor;
+            y = model->soa[2][i] * scalefactor;
+            model->texcoords[2 * (i + 1) + 0] = (x + 1.0) / 2.0;
+            model->texcoords[2 * (i + 1) + 1] = (y + 1.0) / 2.0;
+        }
+    } else {
+        for (i = 1; i <= model->numvertices; i++) {
+            x = model->vertices[3 * i + 0] * scalefactor;
+            y = model->vertices[3 * i + 2] * scalefactor;
+            model->texcoords[2 * i + 0] = (x + 1.0) / 2.0;
+            model->texcoords[2 * i + 1] = (y + 1.0) / 2.0;
+        }
     }
 
     /* go through and put texture coordinate indices in all the triangles */
@@ -1215,8 +1369,7 @@ glmSpheremapTexture(GLMmodel* model)
     assert(model);
     assert(model->normals);
 
-    if (model->texcoords)
-        free(model->texcoords);
+    glmFree(model, model->texcoords);
     model->numtexcoords = model->numnormals;
     model->texcoords=(GLfloat*)malloc(sizeof(GLfloat)*2*(model->numtexcoords+1));
 
@@ -1270,52 +1423,90 @@ glmDelete(GLMmodel* model)
 
     assert(model);
 
-    if (model->pathname)     free(model->pathname);
-    if (model->mtllibname) free(model->mtllibname);
-    if (model->vertices)     free(model->vertices);
-    if (model->normals)  free(model->normals);
-    if (model->texcoords)  free(model->texcoords);
-    if (model->facetnorms) free(model->facetnorms);
-    if (model->triangles)  free(model->triangles);
-    if (model->materials) {
-        for (i = 0; i < model->nummaterials; i++)
-            free(model->materials[i].name);
-    }
-    free(model->materials);
-    while(model->groups) {
-        group = model->groups;
-        model->groups = model->groups->next;
-        free(group->name);
-        free(group->triangles);
-        free(group);
-    }
+    /* a model that is still loading has growing arrays outside the arena */
+    if (model->stream) {
+        glmFree(model, model->vertices);
+        glmFree(model, model->triangles);
+        for (group = model->groups; group; group = group->next)
+            glmFree(model, group->triangles);
+        glmUnmapFile(&model->stream->file);
+        free(model->stream);
+    }
+
+    /* so are the arrays that are computed (and recomputed) from the
+       loaded ones, once they have been */
+    glmFree(model, model->normals);
+    glmFree(model, model->texcoords);
+    glmFree(model, model->facetnorms);
+    for (i = 0; i < 3; i++)
+        glmFree(model, model->soa[i]);
+    glmFree(model, model->interleaved);
+    for (group = model->groups; group; group = group->next) {
+        glmFree(model, group->indices);
+        glmFree(model, group->meshlets);
+    }
+
+    /* the levels of detail are models of their own */
+    if (model->lod)
+        glmDelete(model->lod);
+
+    /* everything else lives in the arena or the cache mapping */
+    glmReleaseCache(model);
+    glmArenaDelete(model->arena);
 
     free(model);
 }
 
-/* glmReadOBJ: Reads a model description from a Wavefront .OBJ file.
- * Returns a pointer to the created object which should be free'd with
- * glmDelete().
+/* glmPrepare: Runs the one-time preparation passes on a freshly
+ * loaded model: unitizes it, generates facet and smooth vertex
+ * normals and scales it to its final size.
  *
- * filename - name of the file containing the Wavefront .OBJ format data.
+ * model - initialized GLMmodel structure
+ * scale - scalefactor applied after unitizing
+ * angle - maximum angle (in degrees) to smooth across
  */
+GLvoid
+glmPrepare(GLMmodel* model, GLfloat scale, GLfloat angle)
+{
+    assert(model);
+
+    glmUnitize(model);
+    glmFacetNormals(model);
+    glmVertexNormals(model, angle);
+
+    /* a uniform scale leaves the normals pointing the same way, so
+       this doesn't mark them dirty again */
+    if (scale != 1.0)
+        glmScale(model, scale);
+}
+
+/* glmUpdate: Regenerates the facet and vertex normals of a model only
+ * if its vertices changed since they were last computed.
+ *
+ * model - initialized GLMmodel structure
+ * angle - maximum angle (in degrees) to smooth across
+ */
+GLvoid
+glmUpdate(GLMmodel* model, GLfloat angle)
+{
+    assert(model);
+
+    if (!(model->dirty & GLM_DIRTY_NORMALS))
+        return;
+
+    glmFacetNormals(model);
+    glmVertexNormals(model, angle);
+}
+
+/* glmNewModel: allocate an empty model for the given path */
 GLMmodel*
-glmReadOBJ(char* filename)
+glmNewModel(char* filename)
 {
     GLMmodel* model;
-    FILE* file;
 
-    /* open the file */
-    file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "glmReadOBJ() failed: can't open data file \"%s\".\n",
-            filename);
-        exit(1);
-    }
-
-    /* allocate a new model */
     model = (GLMmodel*)malloc(sizeof(GLMmodel));
-    model->pathname    = strdup(filename);
+    model->arena         = glmArenaCreate();
+    model->pathname    = glmStrdup(model, filename);
     model->mtllibname    = NULL;
     model->numvertices   = 0;
     model->vertices    = NULL;
@@ -1334,97 +1525,476 @@ glmReadOBJ(char* filename)
     model->position[0]   = 0.0;
     model->position[1]   = 0.0;
     model->position[2]   = 0.0;
+    model->version       = 0;
+    model->dirty         = GLM_DIRTY_NORMALS | GLM_DIRTY_BOUNDS | GLM_DIRTY_SPHERE;
+    model->layout        = GLM_AOS;
+    model->soa[0]        = NULL;
+    model->soa[1]        = NULL;
+    model->soa[2]        = NULL;
+    model->lod           = NULL;
+    model->error         = 0.0;
+    model->lodversion    = 0;
+    model->meshletversion = 0;
+    model->numinterleaved = 0;
+    model->interleaved   = NULL;
+    model->interleavedformat = GL_V3F;
+    model->interleavedmode = GLM_NONE;
+    model->indextype     = GL_UNSIGNED_INT;
+    model->indexedversion = 0;
+    model->warned        = 0;
+    model->cache         = NULL;
+    model->cachesize     = 0;
+    model->stream        = NULL;
+
+    return model;
+}
 
-    /* make a first pass through the file to get a count of the number
-    of vertices, normals, texcoords & triangles */
-    glmFirstPass(model, file);
+/* glmOptimize: put the triangles of a freshly read model in the order
+ * glmReadOBJ() promises */
+static GLvoid
+glmOptimize(GLMmodel* model)
+{
+    glmOptimizeVertexCache(model, GLM_VERTEX_CACHE);
+    glmOptimizeOverdraw(model, GLM_VERTEX_CACHE, GLM_OVERDRAW_THRESHOLD);
+}
 
-    /* allocate memory */
-    model->vertices = (GLfloat*)malloc(sizeof(GLfloat) *
-        3 * (model->numvertices + 1));
-    model->triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) *
-        model->numtriangles);
-    if (model->numnormals) {
-        model->normals = (GLfloat*)malloc(sizeof(GLfloat) *
-            3 * (model->numnormals + 1));
+/* glmReadOBJ: Reads a model description from a Wavefront .OBJ file.
+ * Returns a pointer to the created object which should be free'd with
+ * glmDelete().  Files of GLM_THREADED_SIZE bytes or more are parsed
+ * with one thread per core.  The triangles of each group are put in
+ * vertex cache and overdraw order (see glmOptimizeVertexCache() and
+ * glmOptimizeOverdraw()).  An up to date
+ * binary cache is used instead of the file when there is one, and
+ * written when there isn't.
+ *
+ * filename - name of the file containing the Wavefront .OBJ format data.
+ */
+GLMmodel*
+glmReadOBJ(char* filename)
+{
+    GLMmodel* model;
+    GLMparser parser;
+    GLMfile file;
+
+    /* use the cache if the OBJ (and MTL) haven't changed */
+    model = glmReadCache(filename);
+    if (model)
+        return model;
+
+    /* map the file */
+    if (!glmMapFile(&file, filename)) {
+        fprintf(stderr, "glmReadOBJ() failed: can't open data file \"%s\".\n",
+            filename);
+        exit(1);
     }
-    if (model->numtexcoords) {
-        model->texcoords = (GLfloat*)malloc(sizeof(GLfloat) *
-            2 * (model->numtexcoords + 1));
+
+    /* read all of the data in a single pass over the file */
+    model = glmNewModel(filename);
+    glmParserInit(&parser, model);
+    if (file.size >= GLM_THREADED_SIZE)
+        glmParseOBJThreaded(&parser, file.data, file.data + file.size, 0);
+    else
+        glmParseOBJ(&parser, file.data, file.data + file.size);
+    glmParserFinish(&parser);
+
+    /* unmap the file */
+    glmUnmapFile(&file);
+
+    /* draw the triangles in vertex cache and overdraw friendly order */
+    glmOptimize(model);
+
+    /* the next read can skip the parse (failing to write is harmless) */
+    glmWriteCache(model);
+
+    return model;
+}
+
+/* glmReadOBJThreaded: Reads a model description from a Wavefront .OBJ
+ * file using several threads.  The model is exactly the same as the
+ * one glmReadOBJ() returns.
+ *
+ * filename   - name of the file containing the Wavefront .OBJ format data.
+ * numthreads - number of threads to parse with (0 for one per core)
+ */
+GLMmodel*
+glmReadOBJThreaded(char* filename, GLuint numthreads)
+{
+    GLMmodel* model;
+    GLMparser parser;
+    GLMfile file;
+
+    if (!glmMapFile(&file, filename)) {
+        fprintf(stderr, "glmReadOBJThreaded() failed: can't open data file \"%s\".\n",
+            filename);
+        exit(1);
     }
 
-    /* rewind to beginning of file and read in the data this pass */
-    rewind(file);
+    model = glmNewModel(filename);
+    glmParserInit(&parser, model);
+    glmParseOBJThreaded(&parser, file.data, file.data + file.size, numthreads);
+    glmParserFinish(&parser);
 
-    glmSecondPass(model, file);
+    glmUnmapFile(&file);
 
-    /* close the file */
-    fclose(file);
+    glmOptimize(model);
 
     return model;
 }
 
-/* glmWriteOBJ: Writes a model description in Wavefront .OBJ format to
- * a file.
+/* glmStreamOBJ: Starts a progressive read of a Wavefront .OBJ file.
+ * glmStreamStep() does the actual parsing.
  *
- * model - initialized GLMmodel structure
- * filename - name of the file to write the Wavefront .OBJ format data to
- * mode  - a bitwise or of values describing what is written to the file
- *             GLM_NONE     -  render with only vertices
- *             GLM_FLAT     -  render with facet normals
- *             GLM_SMOOTH   -  render with vertex normals
- *             GLM_TEXTURE  -  render with texture coords
- *             GLM_COLOR    -  render with colors (color material)
- *             GLM_MATERIAL -  render with materials
- *             GLM_COLOR and GLM_MATERIAL should not both be specified.
- *             GLM_FLAT and GLM_SMOOTH should not both be specified.
+ * filename - name of the file containing the Wavefront .OBJ format data.
  */
-GLvoid
-glmWriteOBJ(GLMmodel* model, char* filename, GLuint mode)
+GLMmodel*
+glmStreamOBJ(char* filename)
+{
+    GLMmodel* model;
+    GLMstream* stream;
+
+    /* a cached model is complete right away */
+    model = glmReadCache(filename);
+    if (model)
+        return model;
+
+    stream = (GLMstream*)malloc(sizeof(GLMstream));
+    memset(stream, 0, sizeof(GLMstream));
+    if (!glmMapFile(&stream->file, filename)) {
+        fprintf(stderr, "glmStreamOBJ() failed: can't open data file \"%s\".\n",
+            filename);
+        exit(1);
+    }
+
+    model = glmNewModel(filename);
+    model->stream = stream;
+    glmParserInit(&stream->parser, model);
+    stream->next = stream->file.data;
+
+    return model;
+}
+
+/* glmStreamReady: extend the bounds over the vertices parsed since the
+ * last step, and give facet normals to the triangles that became
+ * drawable (those whose vertices have all been parsed).
+ */
+static GLvoid
+glmStreamReady(GLMmodel* model)
+{
+    GLMstream* stream = model->stream;
+    GLfloat* vertex;
+    GLuint i, j;
+
+    for (i = stream->numbounded + 1; i <= model->numvertices; i++) {
+        vertex = &model->vertices[3 * i];
+        for (j = 0; j < 3; j++) {
+            if (i == 1 || stream->min[j] > vertex[j])
+                stream->min[j] = vertex[j];
+            if (i == 1 || stream->max[j] < vertex[j])
+                stream->max[j] = vertex[j];
+        }
+    }
+    stream->numbounded = model->numvertices;
+
+    if (stream->maxfacetnorms < model->numtriangles + 1) {
+        stream->maxfacetnorms = 2 * (model->numtriangles + 1);
+        model->facetnorms = (GLfloat*)realloc(model->facetnorms,
+            sizeof(GLfloat) * 3 * stream->maxfacetnorms);
+    }
+
+    /* find the first triangle with a vertex still to come */
+    i = stream->numready;
+    while (i < model->numtriangles &&
+           T(i).vindices[0] <= model->numvertices &&
+           T(i).vindices[1] <= model->numvertices &&
+           T(i).vindices[2] <= model->numvertices)
+        i++;
+    glmFacetNormalsRange(model, stream->numready, i);
+    stream->numready = i;
+    model->numfacetnorms = i;
+}
+
+/* glmStreamStep: Parses the next part of a model started with
+ * glmStreamOBJ(), for about budget milliseconds.  Returns GL_TRUE once
+ * the model is complete.
+ *
+ * model  - model returned by glmStreamOBJ()
+ * budget - time to spend parsing, in milliseconds
+ */
+GLboolean
+glmStreamStep(GLMmodel* model, GLfloat budget)
 {
+    std::chrono::steady_clock::time_point start;
+    GLMstream* stream;
+    const char* end;
+    const char* slice;
     GLuint i;
-    FILE* file;
-    GLMgroup* group;
 
     assert(model);
 
-    /* do a bit of warning */
+    stream = model->stream;
+    if (!stream)
+        return GL_TRUE;
+
+    /* parse whole lines a slice at a time until the budget is spent */
+    start = std::chrono::steady_clock::now();
+    end = stream->file.data + stream->file.size;
+    do {
+        slice = stream->next + GLM_STREAM_SLICE;
+        if (slice < end)
+            slice = (const char*)memchr(slice, '\n', end - slice);
+        slice = slice && slice < end ? slice + 1 : end;
+        stream->next = glmParseOBJ(&stream->parser, stream->next, slice);
+    } while (stream->next < end &&
+        std::chrono::duration<GLfloat, std::milli>(
+            std::chrono::steady_clock::now() - start).count() < budget);
+
+    if (stream->next < end) {
+        glmStreamReady(model);
+        return GL_FALSE;
+    }
+
+    /* done: leave the model exactly as glmReadOBJ() would, except
+       that the bounding box is known already */
+    if (stream->numbounded) {
+        for (i = 0; i < 3; i++) {
+            model->min[i] = stream->min[i];
+            model->max[i] = stream->max[i];
+        }
+        glmBoundsRange(model->vertices, stream->numbounded + 1,
+            model->numvertices + 1, model->min, model->max);
+        model->dirty &= ~GLM_DIRTY_BOUNDS;
+    }
+    glmParserFinish(&stream->parser);
+    glmUnmapFile(&stream->file);
+    free(stream);
+    model->stream = NULL;
+
+    free(model->facetnorms);
+    model->facetnorms = NULL;
+    model->numfacetnorms = 0;
+    for (i = 0; i < model->numtriangles; i++)
+        T(i).findex = 0;
+
+    glmOptimize(model);
+    glmWriteCache(model);
+
+    return GL_TRUE;
+}
+
+/* glmStreamTransform: Applies the unitize and scale transform of a
+ * model that is still loading to the current matrix.
+ *
+ * model - model returned by glmStreamOBJ()
+ * scale - scalefactor that will be passed to glmScale()
+ */
+GLvoid
+glmStreamTransform(GLMmodel* model, GLfloat scale)
+{
+    GLMstream* stream;
+    GLfloat w, h, d;
+
+    assert(model);
+
+    stream = model->stream;
+    if (!stream || !stream->numbounded)
+        return;
+
+    /* same width, height and depth as glmUnitize() */
+    w = glmAbs(stream->max[0]) + glmAbs(stream->min[0]);
+    h = glmAbs(stream->max[1]) + glmAbs(stream->min[1]);
+    d = glmAbs(stream->max[2]) + glmAbs(stream->min[2]);
+    if (glmMax(glmMax(w, h), d) == 0.0)
+        return;
+
+    scale *= 2.0 / glmMax(glmMax(w, h), d);
+    glScalef(scale, scale, scale);
+    glTranslatef(-(stream->max[0] + stream->min[0]) / 2.0,
+        -(stream->max[1] + stream->min[1]) / 2.0,
+        -(stream->max[2] + stream->min[2]) / 2.0);
+}
+
+/* the warnings of glmCheckMode(), worded for rendering and for output */
+static const char* glm_mode_warnings[7][2] = {
+    { "flat render mode requested with no facet normals defined.",
+      "flat normal output requested with no facet normals defined." },
+    { "smooth render mode requested with no normals defined.",
+      "smooth normal output requested with no normals defined." },
+    { "texture render mode requested with no texture coordinates defined.",
+      "texture coordinate output requested "
+      "with no texture coordinates defined." },
+    { "flat render mode requested "
+      "and smooth render mode requested (using smooth).",
+      "flat normal output requested "
+      "and smooth normal output requested (using smooth)." },
+    { "color render mode requested with no materials defined.",
+      "color output requested with no colors (materials) defined." },
+    { "material render mode requested with no materials defined.",
+      "material output requested with no materials defined." },
+    { "color and material render mode requested using only material mode.",
+      "color and material output requested outputting only materials." },
+};
+
+/* glmCheckMode: Returns a draw or output mode without the attributes
+ * the model doesn't have (and with only one kind of normal and one of
+ * color), warning about each one dropped the first time it is asked
+ * for on this model.
+ *
+ * model  - initialized GLMmodel structure
+ * mode   - a bitwise OR of GLM_* values
+ * caller - name of the function to warn as
+ * output - GL_TRUE to word the warnings for output (glmWriteOBJ())
+ */
+GLuint
+glmCheckMode(GLMmodel* model, GLuint mode, const char* caller,
+    GLboolean output)
+{
+    GLuint warnings, shift, i;
+
+    warnings = 0;
     if (mode & GLM_FLAT && !model->facetnorms) {
-        printf("glmWriteOBJ() warning: flat normal output requested "
-            "with no facet normals defined.\n");
+        warnings |= 1 << 0;
         mode &= ~GLM_FLAT;
     }
     if (mode & GLM_SMOOTH && !model->normals) {
-        printf("glmWriteOBJ() warning: smooth normal output requested "
-            "with no normals defined.\n");
+        warnings |= 1 << 1;
         mode &= ~GLM_SMOOTH;
     }
     if (mode & GLM_TEXTURE && !model->texcoords) {
-        printf("glmWriteOBJ() warning: texture coordinate output requested "
-            "with no texture coordinates defined.\n");
+        warnings |= 1 << 2;
         mode &= ~GLM_TEXTURE;
     }
     if (mode & GLM_FLAT && mode & GLM_SMOOTH) {
-        printf("glmWriteOBJ() warning: flat normal output requested "
-            "and smooth normal output requested (using smooth).\n");
+        warnings |= 1 << 3;
         mode &= ~GLM_FLAT;
     }
     if (mode & GLM_COLOR && !model->materials) {
-        printf("glmWriteOBJ() warning: color output requested "
-            "with no colors (materials) defined.\n");
+        warnings |= 1 << 4;
         mode &= ~GLM_COLOR;
     }
     if (mode & GLM_MATERIAL && !model->materials) {
-        printf("glmWriteOBJ() warning: material output requested "
-            "with no materials defined.\n");
+        warnings |= 1 << 5;
         mode &= ~GLM_MATERIAL;
     }
     if (mode & GLM_COLOR && mode & GLM_MATERIAL) {
-        printf("glmWriteOBJ() warning: color and material output requested "
-            "outputting only materials.\n");
+        warnings |= 1 << 6;
         mode &= ~GLM_COLOR;
     }
 
+    /* render and output warnings are remembered apart */
+    shift = output ? 8 : 0;
+    for (i = 0; i < 7; i++)
+        if (warnings & ~(model->warned >> shift) & 1 << i)
+            printf("%s() warning: %s\n", caller,
+                glm_mode_warnings[i][output ? 1 : 0]);
+    model->warned |= warnings << shift;
+
+    return mode;
+}
+
+/* glmWriteFaces: the "f" lines of a group, specialized for the
+ * GLM_FLAT, GLM_SMOOTH and GLM_TEXTURE bits of the output mode */
+template <GLuint MODE>
+static GLvoid
+glmWriteFaces(FILE* file, GLMmodel* model, GLMgroup* group)
+{
+    GLuint i;
+
+    for (i = 0; i < group->numtriangles; i++) {
+        if (MODE & GLM_SMOOTH && MODE & GLM_TEXTURE) {
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n",
+                T(group->triangles[i]).vindices[0],
+                T(group->triangles[i]).tindices[0],
+                T(group->triangles[i]).nindices[0],
+                T(group->triangles[i]).vindices[1],
+                T(group->triangles[i]).tindices[1],
+                T(group->triangles[i]).nindices[1],
+                T(group->triangles[i]).vindices[2],
+                T(group->triangles[i]).tindices[2],
+                T(group->triangles[i]).nindices[2]);
+        } else if (MODE & GLM_FLAT && MODE & GLM_TEXTURE) {
+            fprintf(file, "f %d/%d %d/%d %d/%d\n",
+                T(group->triangles[i]).vindices[0],
+                T(group->triangles[i]).findex,
+                T(group->triangles[i]).vindices[1],
+                T(group->triangles[i]).findex,
+                T(group->triangles[i]).vindices[2],
+                T(group->triangles[i]).findex);
+        } else if (MODE & GLM_TEXTURE) {
+            fprintf(file, "f %d/%d %d/%d %d/%d\n",
+                T(group->triangles[i]).vindices[0],
+                T(group->triangles[i]).tindices[0],
+                T(group->triangles[i]).vindices[1],
+                T(group->triangles[i]).tindices[1],
+                T(group->triangles[i]).vindices[2],
+                T(group->triangles[i]).tindices[2]);
+        } else if (MODE & GLM_SMOOTH) {
+            fprintf(file, "f %d//%d %d//%d %d//%d\n",
+                T(group->triangles[i]).vindices[0],
+                T(group->triangles[i]).nindices[0],
+                T(group->triangles[i]).vindices[1],
+                T(group->triangles[i]).nindices[1],
+                T(group->triangles[i]).vindices[2],
+                T(group->triangles[i]).nindices[2]);
+        } else if (MODE & GLM_FLAT) {
+            fprintf(file, "f %d//%d %d//%d %d//%d\n",
+                T(group->triangles[i]).vindices[0],
+                T(group->triangles[i]).findex,
+                T(group->triangles[i]).vindices[1],
+                T(group->triangles[i]).findex,
+                T(group->triangles[i]).vindices[2],
+                T(group->triangles[i]).findex);
+        } else {
+            fprintf(file, "f %d %d %d\n",
+                T(group->triangles[i]).vindices[0],
+                T(group->triangles[i]).vindices[1],
+                T(group->triangles[i]).vindices[2]);
+        }
+    }
+}
+
+typedef GLvoid (*GLMwritefaces)(FILE*, GLMmodel*, GLMgroup*);
+
+/* the glmWriteFaces() of each combination of GLM_FLAT, GLM_SMOOTH and
+   GLM_TEXTURE (glmCheckMode() leaves only one kind of normal) */
+static const GLMwritefaces glm_write_faces[8] = {
+    glmWriteFaces<GLM_NONE>,
+    glmWriteFaces<GLM_FLAT>,
+    glmWriteFaces<GLM_SMOOTH>,
+    glmWriteFaces<GLM_SMOOTH>,
+    glmWriteFaces<GLM_TEXTURE>,
+    glmWriteFaces<GLM_FLAT | GLM_TEXTURE>,
+    glmWriteFaces<GLM_SMOOTH | GLM_TEXTURE>,
+    glmWriteFaces<GLM_SMOOTH | GLM_TEXTURE>,
+};
+
+/* glmWriteOBJ: Writes a model description in Wavefront .OBJ format to
+ * a file.
+ *
+ * model - initialized GLMmodel structure
+ * filename - name of the file to write the Wavefront .OBJ format data to
+ * mode  - a bitwise or of values describing what is written to the file
+ *             GLM_NONE     -  render with only vertices
+ *             GLM_FLAT     -  render with facet normals
+ *             GLM_SMOOTH   -  render with vertex normals
+ *             GLM_TEXTURE  -  render with texture coords
+ *             GLM_COLOR    -  render with colors (color material)
+ *             GLM_MATERIAL -  render with materials
+ *             GLM_COLOR and GLM_MATERIAL should not both be specified.
+ *             GLM_FLAT and GLM_SMOOTH should not both be specified.
+ */
+GLvoid
+glmWriteOBJ(GLMmodel* model, char* filename, GLuint mode)
+{
+    GLuint i;
+    FILE* file;
+    GLMgroup* group;
+    GLMwritefaces write;
+
+    assert(model);
+    glmVertices(model);
+
+    /* do a bit of warning */
+    mode = glmCheckMode(model, mode, "glmWriteOBJ", GL_TRUE);
 
     /* open the file */
     file = fopen(filename, "w");
@@ -1496,62 +2066,13 @@ glmWriteOBJ(GLMmodel* model, char* filename, GLuint mode)
     fprintf(file, "# %d faces (triangles)\n", model->numtriangles);
     fprintf(file, "\n");
 
+    write = glm_write_faces[mode & (GLM_FLAT | GLM_SMOOTH | GLM_TEXTURE)];
     group = model->groups;
     while(group) {
         fprintf(file, "g %s\n", group->name);
         if (mode & GLM_MATERIAL)
             fprintf(file, "usemtl %s\n", model->materials[group->material].name);
-        for (i = 0; i < group->numtriangles; i++) {
-            if (mode & GLM_SMOOTH && mode & GLM_TEXTURE) {
-                fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n",
-                    T(group->triangles[i]).vindices[0],
-                    T(group->triangles[i]).tindices[0],
-                    T(group->triangles[i]).nindices[0],
-                    T(group->triangles[i]).vindices[1],
-                    T(group->triangles[i]).tindices[1],
-                    T(group->triangles[i]).nindices[1],
-                    T(group->triangles[i]).vindices[2],
-                    T(group->triangles[i]).tindices[2],
-                    T(group->triangles[i]).nindices[2]);
-            } else if (mode & GLM_FLAT && mode & GLM_TEXTURE) {
-                fprintf(file, "f %d/%d %d/%d %d/%d\n",
-                    T(group->triangles[i]).vindices[0],
-                    T(group->triangles[i]).findex,
-                    T(group->triangles[i]).vindices[1],
-                    T(group->triangles[i]).findex,
-                    T(group->triangles[i]).vindices[2],
-                    T(group->triangles[i]).findex);
-            } else if (mode & GLM_TEXTURE) {
-                fprintf(file, "f %d/%d %d/%d %d/%d\n",
-                    T(group->triangles[i]).vindices[0],
-                    T(group->triangles[i]).tindices[0],
-                    T(group->triangles[i]).vindices[1],
-                    T(group->triangles[i]).tindices[1],
-                    T(group->triangles[i]).vindices[2],
-                    T(group->triangles[i]).tindices[2]);
-            } else if (mode & GLM_SMOOTH) {
-                fprintf(file, "f %d//%d %d//%d %d//%d\n",
-                    T(group->triangles[i]).vindices[0],
-                    T(group->triangles[i]).nindices[0],
-                    T(group->triangles[i]).vindices[1],
-                    T(group->triangles[i]).nindices[1],
-                    T(group->triangles[i]).vindices[2],
-                    T(group->triangles[i]).nindices[2]);
-            } else if (mode & GLM_FLAT) {
-                fprintf(file, "f %d//%d %d//%d %d//%d\n",
-                    T(group->triangles[i]).vindices[0],
-                    T(group->triangles[i]).findex,
-                    T(group->triangles[i]).vindices[1],
-                    T(group->triangles[i]).findex,
-                    T(group->triangles[i]).vindices[2],
-                    T(group->triangles[i]).findex);
-            } else {
-                fprintf(file, "f %d %d %d\n",
-                    T(group->triangles[i]).vindices[0],
-                    T(group->triangles[i]).vindices[1],
-                    T(group->triangles[i]).vindices[2]);
-            }
-        }
+        write(file, model, group);
         fprintf(file, "\n");
         group = group->next;
     }
@@ -1559,6 +2080,79 @@ glmWriteOBJ(GLMmodel* model, char* filename, GLuint mode)
     fclose(file);
 }
 
+/* glmDrawTriangles: the glBegin()/glEnd() of a group, specialized for
+ * the GLM_FLAT, GLM_SMOOTH and GLM_TEXTURE bits of the render mode so
+ * the vertex loop doesn't test them.  Stops at the first triangle that
+ * isn't ready, and skips the meshlets cull rejects (unless it's NULL).
+ */
+template <GLuint MODE>
+static GLvoid
+glmDrawTriangles(GLMmodel* model, GLMgroup* group, GLuint numready,
+    const GLMcull* cull)
+{
+    GLMtriangle* triangle;
+    GLuint i, meshlet, next;
+
+    meshlet = 0;
+    next = cull ? 0 : (GLuint)-1;
+
+    glBegin(GL_TRIANGLES);
+    for (i = 0; i < group->numtriangles; i++) {
+        if (i == next) {
+            /* skip to the next meshlet that can be seen */
+            while (i < group->numtriangles &&
+                   glmCullMeshlet(cull, &group->meshlets[meshlet])) {
+                i += group->meshlets[meshlet].numtriangles;
+                meshlet++;
+            }
+            if (i >= group->numtriangles)
+                break;
+            next = i + group->meshlets[meshlet++].numtriangles;
+        }
+        if (group->triangles[i] >= numready)
+            break;
+        triangle = &T(group->triangles[i]);
+
+        if (MODE & GLM_FLAT)
+            glNormal3fv(&model->facetnorms[3 * triangle->findex]);
+
+        if (MODE & GLM_SMOOTH)
+            glNormal3fv(&model->normals[3 * triangle->nindices[0]]);
+        if (MODE & GLM_TEXTURE)
+            glTexCoord2fv(&model->texcoords[2 * triangle->tindices[0]]);
+        glVertex3fv(&model->vertices[3 * triangle->vindices[0]]);
+
+        if (MODE & GLM_SMOOTH)
+            glNormal3fv(&model->normals[3 * triangle->nindices[1]]);
+        if (MODE & GLM_TEXTURE)
+            glTexCoord2fv(&model->texcoords[2 * triangle->tindices[1]]);
+        glVertex3fv(&model->vertices[3 * triangle->vindices[1]]);
+
+        if (MODE & GLM_SMOOTH)
+            glNormal3fv(&model->normals[3 * triangle->nindices[2]]);
+        if (MODE & GLM_TEXTURE)
+            glTexCoord2fv(&model->texcoords[2 * triangle->tindices[2]]);
+        glVertex3fv(&model->vertices[3 * triangle->vindices[2]]);
+    }
+    glEnd();
+}
+
+typedef GLvoid (*GLMdrawtriangles)(GLMmodel*, GLMgroup*, GLuint,
+    const GLMcull*);
+
+/* the glmDrawTriangles() of each combination of GLM_FLAT, GLM_SMOOTH
+   and GLM_TEXTURE (glmCheckMode() leaves only one kind of normal) */
+static const GLMdrawtriangles glm_draw_triangles[8] = {
+    glmDrawTriangles<GLM_NONE>,
+    glmDrawTriangles<GLM_FLAT>,
+    glmDrawTriangles<GLM_SMOOTH>,
+    glmDrawTriangles<GLM_SMOOTH>,
+    glmDrawTriangles<GLM_TEXTURE>,
+    glmDrawTriangles<GLM_FLAT | GLM_TEXTURE>,
+    glmDrawTriangles<GLM_SMOOTH | GLM_TEXTURE>,
+    glmDrawTriangles<GLM_SMOOTH | GLM_TEXTURE>,
+};
+
 /* glmDraw: Renders the model to the current OpenGL context using the
  * mode specified.
  *
@@ -1570,107 +2164,59 @@ glmWriteOBJ(GLMmodel* model, char* filename, GLuint mode)
  *             GLM_TEXTURE  -  render with texture coords
  *             GLM_COLOR    -  render with colors (color material)
  *             GLM_MATERIAL -  render with materials
+ *             GLM_CULL     -  skip meshlets that can't be seen
  *             GLM_COLOR and GLM_MATERIAL should not both be specified.
  *             GLM_FLAT and GLM_SMOOTH should not both be specified.
  */
 GLvoid
 glmDraw(GLMmodel* model, GLuint mode)
 {
-    static GLuint i;
-    static GLMgroup* group;
-    static GLMtriangle* triangle;
-    static GLMmaterial* material;
+    GLMgroup* group;
+    GLMmaterial* material;
+    GLuint numready;
+    GLMcull cull;
+    GLboolean culling;
+    GLMdrawtriangles draw;
 
     assert(model);
+
+    /* a model that is still loading only draws its ready triangles */
+    numready = model->stream ? model->stream->numready : model->numtriangles;
+    if (!numready)
+        return;
     assert(model->vertices);
+    glmVertices(model);
 
     /* do a bit of warning */
-    if (mode & GLM_FLAT && !model->facetnorms) {
-        printf("glmDraw() warning: flat render mode requested "
-            "with no facet normals defined.\n");
-        mode &= ~GLM_FLAT;
-    }
-    if (mode & GLM_SMOOTH && !model->normals) {
-        printf("glmDraw() warning: smooth render mode requested "
-            "with no normals defined.\n");
-        mode &= ~GLM_SMOOTH;
-    }
-    if (mode & GLM_TEXTURE && !model->texcoords) {
-        printf("glmDraw() warning: texture render mode requested "
-            "with no texture coordinates defined.\n");
-        mode &= ~GLM_TEXTURE;
-    }
-    if (mode & GLM_FLAT && mode & GLM_SMOOTH) {
-        printf("glmDraw() warning: flat render mode requested "
-            "and smooth render mode requested (using smooth).\n");
-        mode &= ~GLM_FLAT;
-    }
-    if (mode & GLM_COLOR && !model->materials) {
-        printf("glmDraw() warning: color render mode requested "
-            "with no materials defined.\n");
-        mode &= ~GLM_COLOR;
-    }
-    if (mode & GLM_MATERIAL && !model->materials) {
-        printf("glmDraw() warning: material render mode requested "
-            "with no materials defined.\n");
-        mode &= ~GLM_MATERIAL;
-    }
-    if (mode & GLM_COLOR && mode & GLM_MATERIAL) {
-        printf("glmDraw() warning: color and material render mode requested "
-            "using only material mode.\n");
-        mode &= ~GLM_COLOR;
-    }
+    mode = glmCheckMode(model, mode, "glmDraw", GL_FALSE);
     if (mode & GLM_COLOR)
-        glEnable(GL_COLOR_MATERIAL);
+        glmEnable(GL_COLOR_MATERIAL);
     else if (mode & GLM_MATERIAL)
-        glDisable(GL_COLOR_MATERIAL);
+        glmDisable(GL_COLOR_MATERIAL);
+
+    /* the triangle loop is picked once, for the attributes drawn */
+    draw = glm_draw_triangles[mode & (GLM_FLAT | GLM_SMOOTH | GLM_TEXTURE)];
 
-    /* perhaps this loop should be unrolled into material, color, flat,
-       smooth, etc. loops?  since most cpu's have good branch prediction
-       schemes (and these branches will always go one way), probably
-       wouldn't gain too much?  */
+    /* meshlets are tested against the matrices once per draw */
+    culling = mode & GLM_CULL && glmCullBegin(model, &cull);
 
     group = model->groups;
     while (group) {
         if (mode & GLM_MATERIAL) {
             material = &model->materials[group->material];
-            glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, material->ambient);
-            glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, material->diffuse);
-            glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, material->specular);
-            glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, material->shininess);
+            glmMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, material->ambient);
+            glmMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, material->diffuse);
+            glmMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, material->specular);
+            glmMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, material->shininess);
         }
 
         if (mode & GLM_COLOR) {
-            glColor3fv(material->diffuse);
+            material = &model->materials[group->material];
+            glmColor3fv(material->diffuse);
         }
 
-        glBegin(GL_TRIANGLES);
-        for (i = 0; i < group->numtriangles; i++) {
-            triangle = &T(group->triangles[i]);
-
-            if (mode & GLM_FLAT)
-                glNormal3fv(&model->facetnorms[3 * triangle->findex]);
-
-            if (mode & GLM_SMOOTH)
-                glNormal3fv(&model->normals[3 * triangle->nindices[0]]);
-            if (mode & GLM_TEXTURE)
-                glTexCoord2fv(&model->texcoords[2 * triangle->tindices[0]]);
-            glVertex3fv(&model->vertices[3 * triangle->vindices[0]]);
-
-            if (mode & GLM_SMOOTH)
-                glNormal3fv(&model->normals[3 * triangle->nindices[1]]);
-            if (mode & GLM_TEXTURE)
-                glTexCoord2fv(&model->texcoords[2 * triangle->tindices[1]]);
-            glVertex3fv(&model->vertices[3 * triangle->vindices[1]]);
-
-            if (mode & GLM_SMOOTH)
-                glNormal3fv(&model->normals[3 * triangle->nindices[2]]);
-            if (mode & GLM_TEXTURE)
-                glTexCoord2fv(&model->texcoords[2 * triangle->tindices[2]]);
-            glVertex3fv(&model->vertices[3 * triangle->vindices[2]]);
-
-        }
-        glEnd();
+        draw(model, group, numready,
+            culling && group->meshlets ? &cull : NULL);
 
         group = group->next;
     }
@@ -1687,6 +2233,8 @@ glmDraw(GLMmodel* model, GLuint mode)
  *             GLM_TEXTURE  -  render with texture coords
  *             GLM_COLOR    -  render with colors (color material)
  *             GLM_MATERIAL -  render with materials
+ *             GLM_CULL     -  has no effect, since the list is drawn
+ *                             from other viewpoints too
  *             GLM_COLOR and GLM_MATERIAL should not both be specified.
  * GLM_FLAT and GLM_SMOOTH should not both be specified.
  */
@@ -1695,10 +2243,14 @@ glmList(GLMmodel* model, GLuint mode)
 {
     GLuint list;
 
+    /* the state cache can't drop anything the list needs, and what it
+       shadows while compiling never reached OpenGL */
     list = glGenLists(1);
+    glmForgetState(GL_ALL_ATTRIB_BITS);
     glNewList(list, GL_COMPILE);
-    glmDraw(model, mode);
+    glmDraw(model, mode & ~GLM_CULL);
     glEndList();
+    glmForgetState(GL_ALL_ATTRIB_BITS);
 
     return list;
 }
@@ -1714,43 +2266,58 @@ glmList(GLMmodel* model, GLuint mode)
 GLvoid
 glmWeld(GLMmodel* model, GLfloat epsilon)
 {
-    GLfloat* vectors;
-    GLfloat* copies;
-    GLuint numvectors;
-    GLuint i;
+    assert(model);
 
-    /* vertices */
-    numvectors = model->numvertices;
-    vectors  = model->vertices;
-    copies = glmWeldVectors(vectors, &numvectors, epsilon);
+    glmWeldArray(model, glmVertices(model), &model->numvertices, 3,
+        offsetof(GLMtriangle, vindices), epsilon, model->min, model->max);
 
-#if 0
-    printf("glmWeld(): %d redundant vertices.\n",
-        model->numvertices - numvectors - 1);
-#endif
+    if (model->layout == GLM_SOA)
+        glmUnpack(model);
 
-    for (i = 0; i < model->numtriangles; i++) {
-        T(i).vindices[0] = (GLuint)vectors[3 * T(i).vindices[0] + 0];
-        T(i).vindices[1] = (GLuint)vectors[3 * T(i).vindices[1] + 0];
-        T(i).vindices[2] = (GLuint)vectors[3 * T(i).vindices[2] + 0];
-    }
+    model->version++;
+    model->dirty |= GLM_DIRTY_NORMALS | GLM_DIRTY_SPHERE;
+    if (model->numvertices)
+        model->dirty &= ~GLM_DIRTY_BOUNDS;
+    else
+        model->dirty |= GLM_DIRTY_BOUNDS;
+}
+
+/* glmWeldNormals: eliminate (weld) normals that are within an epsilon
+ * of each other.
+ *
+ * model   - initialized GLMmodel structure
+ * epsilon - maximum difference between normals
+ */
+GLvoid
+glmWeldNormals(GLMmodel* model, GLfloat epsilon)
+{
+    assert(model);
 
-    /* free space for old vertices */
-    free(vectors);
+    if (!model->numnormals)
+        return;
+    glmWeldArray(model, model->normals, &model->numnormals, 3,
+        offsetof(GLMtriangle, nindices), epsilon, NULL, NULL);
 
-    /* allocate space for the new vertices */
-    model->numvertices = numvectors;
-    model->vertices = (GLfloat*)malloc(sizeof(GLfloat) *
-        3 * (model->numvertices + 1));
+    model->version++;
+}
 
-    /* copy the optimized vertices into the actual vertex list */
-    for (i = 1; i <= model->numvertices; i++) {
-        model->vertices[3 * i + 0] = copies[3 * i + 0];
-        model->vertices[3 * i + 1] = copies[3 * i + 1];
-        model->vertices[3 * i + 2] = copies[3 * i + 2];
-    }
+/* glmWeldTexcoords: eliminate (weld) texture coordinates that are
+ * within an epsilon of each other.
+ *
+ * model   - initialized GLMmodel structure
+ * epsilon - maximum difference between texture coordinates
+ */
+GLvoid
+glmWeldTexcoords(GLMmodel* model, GLfloat epsilon)
+{
+    assert(model);
+
+    if (!model->numtexcoords)
+        return;
+    glmWeldArray(model, model->texcoords, &model->numtexcoords, 2,
+        offsetof(GLMtriangle, tindices), epsilon, NULL, NULL);
 
-    free(copies);
+    model->version++;
 }
 
 /* glmReadPPM: read a PPM raw (type P6) file.  The PPM file has a header
@@ -1827,73 +2394,6 @@ glmReadPPM(char* filename, int* width, int* height)
     return image;
 }
 
-#if 0
-/* normals */
-if (model->numnormals) {
-    numvectors = model->numnormals;
-    vectors  = model->normals;
-    copies = glmOptimizeVectors(vectors, &numvectors);
-
-    printf("glmOptimize(): %d redundant normals.\n",
-        model->numnormals - numvectors);
-
-    for (i = 0; i < model->numtriangles; i++) {
-        T(i).nindices[0] = (GLuint)vectors[3 * T(i).nindices[0] + 0];
-        T(i).nindices[1] = (GLuint)vectors[3 * T(i).nindices[1] + 0];
-        T(i).nindices[2] = (GLuint)vectors[3 * T(i).nindices[2] + 0];
-    }
-
-    /* free space for old normals */
-    free(vectors);
-
-    /* allocate space for the new normals */
-    model->numnormals = numvectors;
-    model->normals = (GLfloat*)malloc(sizeof(GLfloat) *
-        3 * (model->numnormals + 1));
-
-    /* copy the optimized vertices into the actual vertex list */
-    for (i = 1; i <= model->numnormals; i++) {
-        model->normals[3 * i + 0] = copies[3 * i + 0];
-        model->normals[3 * i + 1] = copies[3 * i + 1];
-        model->normals[3 * i + 2] = copies[3 * i + 2];
-    }
-
-    free(copies);
-}
-
-/* texcoords */
-if (model->numtexcoords) {
-    numvectors = model->numtexcoords;
-    vectors  = model->texcoords;
-    copies = glmOptimizeVectors(vectors, &numvectors);
-
-    printf("glmOptimize(): %d redundant texcoords.\n",
-        model->numtexcoords - numvectors);
-
-    for (i = 0; i < model->numtriangles; i++) {
-        for (j = 0; j < 3; j++) {
-            T(i).tindices[j] = (GLuint)vectors[3 * T(i).tindices[j] + 0];
-        }
-    }
-
-    /* free space for old texcoords */
-    free(vectors);
-
-    /* allocate space for the new texcoords */
-    model->numtexcoords = numvectors;
-    model->texcoords = (GLfloat*)malloc(sizeof(GLfloat) *
-        2 * (model->numtexcoords + 1));
-
-    /* copy the optimized vertices into the actual vertex list */
-    for (i = 1; i <= model->numtexcoords; i++) {
-        model->texcoords[2 * i + 0] = copies[2 * i + 0];
-        model->texcoords[2 * i + 1] = copies[2 * i + 1];
-    }
-
-    free(copies);
-}
-#endif
-
 #if 0
 /* look for unused vertices */
 /* look for unused normals */
@@ -11,6 +11,10 @@
 
  */
 
+#ifndef GLM_H_INCLUDED
+#define GLM_H_INCLUDED
+
+#include <stddef.h>
 
 #if defined(__APPLE__) || defined(MACOSX)
 #include <GLUT/glut.h>
@@ -29,6 +33,32 @@
 #define GLM_TEXTURE  (1 << 2)       /* render with texture coords */
 #define GLM_COLOR    (1 << 3)       /* render with colors */
 #define GLM_MATERIAL (1 << 4)       /* render with materials */
+#define GLM_CULL     (1 << 5)       /* skip meshlets that can't be seen */
+
+#define GLM_THREADED_SIZE (16 << 20) /* glmReadOBJ() goes parallel above */
+
+#define GLM_DIRTY_NORMALS (1 << 0)  /* facet & vertex normals are stale */
+#define GLM_DIRTY_BOUNDS  (1 << 1)  /* cached bounding box is stale */
+#define GLM_DIRTY_SPHERE  (1 << 2)  /* cached bounding sphere is stale */
+#define GLM_DIRTY_PACKED  (1 << 3)  /* vertices lag behind soa (GLM_SOA) */
+
+#define GLM_AOS 0                   /* vertex layout: interleaved xyz */
+#define GLM_SOA 1                   /* vertex layout: separate x, y, z */
+#define GLM_SOA_PAD 16              /* soa arrays are padded to this */
+
+#define GLM_CACHE_SUFFIX ".glmb"    /* binary cache written next to an OBJ */
+
+#define GLM_VERTEX_CACHE 16         /* post transform cache size to optimize for */
+#define GLM_OVERDRAW_THRESHOLD 1.05 /* cache miss ratio overdraw ordering may cost */
+#define GLM_LOD_PIXELS 1.0          /* screen space error glmLOD() allows */
+#define GLM_MESHLET_TRIANGLES 128   /* most triangles in a meshlet */
+#define GLM_MESHLET_ANGLE 15.0      /* widest normal cone of a meshlet */
+#define GLM_LIST_CACHE 16           /* display lists a list cache keeps */
+#define GLM_PRIMITIVE_LEVELS 4      /* most levels of detail of a primitive */
+
+#define GLM_CUBE   0                /* primitive: glutSolidCube(1.0) */
+#define GLM_SPHERE 1                /* primitive: unit sphere */
+#define GLM_NUMPRIMITIVES 2
 
 
 /* GLMmaterial: Structure that defines a material in a model. 
@@ -52,6 +82,19 @@ typedef struct _GLMtriangle {
   GLuint findex;                /* index of triangle facet normal */
 } GLMtriangle;
 
+/* GLMmeshlet: Structure that defines a meshlet, a run of triangles of
+ * a group with bounds for culling (see glmBuildMeshlets()).
+ */
+typedef struct _GLMmeshlet {
+  GLuint  begin;                /* first triangle (in group->triangles) */
+  GLuint  numtriangles;         /* number of triangles in this meshlet */
+  GLfloat center[3];            /* bounding sphere */
+  GLfloat radius;
+  GLfloat axis[3];              /* cone around the facet normals */
+  GLfloat apex[3];
+  GLfloat cutoff;               /* sine of the cone angle (1: no cone) */
+} GLMmeshlet;
+
 /* GLMgroup: Structure that defines a group in a model.
  */
 typedef struct _GLMgroup {
@@ -59,6 +102,9 @@ typedef struct _GLMgroup {
   GLuint            numtriangles;   /* number of triangles in this group */
   GLuint*           triangles;      /* array of triangle indices */
   GLuint            material;       /* index to material for group */
+  GLuint            nummeshlets;    /* number of meshlets in this group */
+  GLMmeshlet*       meshlets;       /* array of meshlets */
+  GLvoid*           indices;        /* interleaved vertex of each corner */
   struct _GLMgroup* next;           /* pointer to next group in model */
 } GLMgroup;
 
@@ -91,8 +137,163 @@ typedef struct _GLMmodel {
 
   GLfloat position[3];          /* position of the model */
 
+  GLuint  version;              /* geometry version, bumped on vertex edits */
+  GLuint  dirty;                /* GLM_DIRTY_* flags of stale derived data */
+  GLfloat min[3];               /* cached bounding box (see glmBoundingBox()) */
+  GLfloat max[3];
+  GLfloat center[3];            /* cached bounding sphere */
+  GLfloat radius;
+
+  GLuint  layout;               /* GLM_AOS or GLM_SOA (see glmVertexLayout()) */
+  GLfloat* soa[3];              /* GLM_SOA: x, y and z of the vertices */
+
+  struct _GLMmodel* lod;        /* next coarser level of detail (glmBuildLODs()) */
+  GLfloat error;                /* simplification error of this level */
+  GLuint  lodversion;           /* version the levels were built from */
+  GLuint  meshletversion;       /* version the meshlets were built from */
+
+  GLuint   numinterleaved;      /* number of interleaved vertices */
+  GLfloat* interleaved;         /* array of distinct (vertex, normal,
+                                   texcoord) triplets (glmBuildIndexed()) */
+  GLenum   interleavedformat;   /* their glInterleavedArrays() format */
+  GLuint   interleavedmode;     /* GLM_* attributes they hold */
+  GLenum   indextype;           /* type of group->indices */
+  GLuint   indexedversion;      /* version they were built from */
+
+  GLuint  warned;               /* mode warnings printed (glmDraw() etc.) */
+
+  GLvoid* cache;                /* .glmb mapping the arrays live in */
+  size_t  cachesize;            /* size of that mapping */
+
+  struct _GLMarena* arena;      /* owns what the model is loaded with */
+  struct _GLMstream* stream;    /* progressive load still in progress */
+
 } GLMmodel;
 
+/* GLMrange: Structure that defines the indices of a group in a mesh.
+ */
+typedef struct _GLMrange {
+  GLMgroup* group;              /* group drawn */
+  GLuint    first;              /* first index (in the index buffer) */
+  GLuint    count;              /* number of indices */
+} GLMrange;
+
+/* GLMmesh: Structure that defines a model kept in OpenGL buffer objects
+ * (see glmNewMesh()).
+ */
+typedef struct _GLMmesh {
+  GLMmodel* model;              /* model (level) the mesh was made from */
+  GLuint    vbo;                /* buffer of the interleaved vertices */
+  GLuint    ibo;                /* buffer of the indices of all groups */
+  GLenum    format;             /* glInterleavedArrays() format */
+  GLenum    indextype;          /* GL_UNSIGNED_SHORT or GL_UNSIGNED_INT */
+  GLuint    mode;               /* GLM_* attributes in the vertices */
+  GLuint    version;            /* model version in the buffers */
+  GLuint    numranges;          /* number of ranges (one per group) */
+  GLMrange* ranges;             /* array of ranges, in group order */
+  struct _GLMmesh* lod;         /* mesh of model->lod */
+} GLMmesh;
+
+/* GLMlist: Structure that defines a display list in a list cache.
+ */
+typedef struct _GLMlist {
+  GLMmodel* model;              /* model the list draws */
+  GLuint    mode;               /* mode it was compiled with */
+  GLuint    version;            /* model version it was compiled from */
+  GLuint    list;               /* the display list */
+  GLuint    used;               /* cache clock at its last use */
+} GLMlist;
+
+/* GLMlistcache: Structure that defines a cache of display lists
+ * compiled by glmList() (see glmNewListCache()).
+ */
+typedef struct _GLMlistcache {
+  GLuint   maxlists;            /* most lists kept */
+  GLuint   numlists;            /* number of lists in the cache */
+  GLMlist* lists;               /* array of lists */
+  GLuint   clock;               /* bumped on every lookup */
+
+  GLuint   hits;                /* lookups that found an up to date list */
+  GLuint   misses;              /* lookups that compiled one */
+  GLuint   evictions;           /* lists deleted to make room */
+  GLdouble compiletime;         /* seconds spent compiling lists */
+} GLMlistcache;
+
+/* GLMprimitive: Structure that defines a primitive shape kept in
+ * buffer objects at a few levels of detail (see glmPrimitive()).
+ */
+typedef struct _GLMprimitive {
+  GLuint    numvertices;        /* vertices of all levels */
+  GLfloat*  vertices;           /* normal and position of each vertex */
+  GLuint    numindices;         /* indices of all levels */
+  GLushort* indices;            /* triangles of all levels */
+  GLuint    numlevels;          /* number of levels, finest first */
+  GLuint    first[GLM_PRIMITIVE_LEVELS]; /* first index of each level */
+  GLuint    count[GLM_PRIMITIVE_LEVELS]; /* number of indices of each */
+  GLfloat   error[GLM_PRIMITIVE_LEVELS]; /* farthest each is from the shape */
+  GLfloat   radius;             /* bounding sphere (around the origin) */
+  GLuint    vbo;                /* buffer of the vertices */
+  GLuint    ibo;                /* buffer of the indices */
+} GLMprimitive;
+
+/* GLMbatch: Structure that defines copies (instances) of a small shape
+ * drawn together (see glmNewBatch()).
+ */
+typedef struct _GLMbatch {
+  GLuint   numvertices;         /* vertices of the shape (3 per triangle) */
+  GLfloat* shape;               /* normal and position of each vertex */
+  GLuint   numinstances;        /* copies added this frame */
+  GLuint   maxinstances;        /* room for copies */
+  GLfloat* matrices;            /* modelview matrix of each copy */
+  GLfloat* colors;              /* RGBA color of each copy */
+  GLfloat* vertices;            /* copies in eye space (GL_C4F_N3F_V3F) */
+  GLuint   vbo;                 /* buffer they are streamed into */
+  GLuint   drawcalls;           /* draw calls made (for measuring) */
+} GLMbatch;
+
+/* GLMdrawfunc: Function that draws something queued with glmQueueCall().
+ */
+typedef GLvoid (*GLMdrawfunc)(GLvoid* data);
+
+/* GLMitem: Structure that defines something to draw in a render queue.
+ */
+typedef struct _GLMitem {
+  GLfloat      matrix[16];      /* modelview matrix it was queued with */
+  GLMmesh*     mesh;            /* mesh of a group (NULL for a callback) */
+  GLuint       range;           /* range of the group in the mesh */
+  GLuint       mode;            /* GLM_MATERIAL and GLM_CULL for a group */
+  GLMdrawfunc  draw;            /* callback that draws anything else */
+  GLvoid*      data;            /* argument of the callback */
+  GLuint       texture;         /* 2D texture (0 for none) */
+  GLMmaterial* material;        /* material (NULL to leave it alone) */
+  GLboolean    colored;         /* whether color is used */
+  GLfloat      color[4];        /* color material (diffuse) color */
+} GLMitem;
+
+/* GLMqueuestate: Structure that defines a (material, color) pair a
+ * render queue has numbered for its sort keys.
+ */
+typedef struct _GLMqueuestate {
+  const GLMmaterial* material;  /* material */
+  GLboolean          colored;   /* whether color is used */
+  GLfloat            color[4];  /* color */
+} GLMqueuestate;
+
+/* GLMqueue: Structure that defines a render queue (see glmNewQueue()).
+ */
+typedef struct _GLMqueue {
+  struct _GLMarena*   arena;    /* memory of the frame, reset every frame */
+  GLuint              numitems; /* number of items queued this frame */
+  GLuint              maxitems; /* room for items (grows, never shrinks) */
+  GLMitem*            items;    /* array of items (in the arena) */
+  unsigned long long* keys;     /* array of their sort keys (in the arena) */
+
+  GLuint              numstates; /* number of states numbered this frame */
+  GLuint              maxstates; /* room for states */
+  GLMqueuestate*      states;   /* array of states, in number order
+                                   (room grows, never shrinks) */
+} GLMqueue;
+
 
 /* glmUnitize: "unitize" a model by translating it to the origin and
  * scaling it to fit in a unit cube around the origin.  Returns the
@@ -112,6 +313,51 @@ glmUnitize(GLMmodel* model);
 GLvoid
 glmDimensions(GLMmodel* model, GLfloat* dimensions);
 
+/* glmBoundingBox: Returns the axis aligned bounding box of a model.
+ * The box is cached in the model and kept up to date by glmUnitize(),
+ * glmScale() and glmWeld(), so this is usually O(1).
+ *
+ * model - initialized GLMmodel structure
+ * min   - array of 3 GLfloats (GLfloat min[3]), minimum x, y and z
+ * max   - array of 3 GLfloats (GLfloat max[3]), maximum x, y and z
+ */
+GLvoid
+glmBoundingBox(GLMmodel* model, GLfloat* min, GLfloat* max);
+
+/* glmBoundingSphere: Returns a bounding sphere of a model, centered on
+ * its bounding box.  Cached like the bounding box.
+ *
+ * model  - initialized GLMmodel structure
+ * center - array of 3 GLfloats (GLfloat center[3])
+ * radius - set to the radius of the sphere
+ */
+GLvoid
+glmBoundingSphere(GLMmodel* model, GLfloat* center, GLfloat* radius);
+
+/* glmVertexLayout: Switches the layout the vertices of a model are
+ * kept in.  GLM_AOS (the default) is the interleaved xyz vertices
+ * array.  GLM_SOA adds separate, cache line aligned x, y and z arrays
+ * (soa[0..2], indexed from 0 for vertex 1 and padded to a multiple of
+ * GLM_SOA_PAD with copies of the last vertex) that glmUnitize(),
+ * glmScale(), glmLinearTexture() and the bounds work on with straight
+ * vector loops.  The vertices array is then brought up to date only
+ * when something needs it (see glmVertices()).
+ *
+ * model  - initialized GLMmodel structure (not still streaming)
+ * layout - GLM_AOS or GLM_SOA
+ */
+GLvoid
+glmVertexLayout(GLMmodel* model, GLuint layout);
+
+/* glmVertices: Returns the interleaved vertices array of a model,
+ * bringing it up to date first in the GLM_SOA layout.  Code that
+ * reads model->vertices directly should get it from here.
+ *
+ * model - initialized GLMmodel structure
+ */
+GLfloat*
+glmVertices(GLMmodel* model);
+
 /* glmScale: Scales a model by a given amount.
  * 
  * model - properly initialized GLMmodel structure
@@ -187,15 +433,107 @@ glmSpheremapTexture(GLMmodel* model);
 GLvoid
 glmDelete(GLMmodel* model);
 
+/* glmPrepare: Runs the one-time preparation passes on a freshly
+ * loaded model: unitizes it, generates facet and smooth vertex
+ * normals and scales it to its final size.  Call this once at load
+ * time instead of every frame; repeated unitize/scale calls slowly
+ * drift the vertices.
+ *
+ * model - initialized GLMmodel structure
+ * scale - scalefactor applied after unitizing
+ * angle - maximum angle (in degrees) to smooth across
+ */
+GLvoid
+glmPrepare(GLMmodel* model, GLfloat scale, GLfloat angle);
+
+/* glmUpdate: Regenerates the facet and vertex normals of a model only
+ * if its vertices changed since they were last computed (that is, if
+ * GLM_DIRTY_NORMALS is set).  Cheap enough to call every frame.
+ *
+ * model - initialized GLMmodel structure
+ * angle - maximum angle (in degrees) to smooth across
+ */
+GLvoid
+glmUpdate(GLMmodel* model, GLfloat angle);
+
 /* glmReadOBJ: Reads a model description from a Wavefront .OBJ file.
  * Returns a pointer to the created object which should be free'd with
- * glmDelete().
+ * glmDelete().  Files of GLM_THREADED_SIZE bytes or more are parsed
+ * with one thread per core (see glmReadOBJThreaded()).
  *
  * filename - name of the file containing the Wavefront .OBJ format data.  
  */
 GLMmodel* 
 glmReadOBJ(char* filename);
 
+/* glmReadOBJThreaded: Reads a model description from a Wavefront .OBJ
+ * file, splitting the parse across threads.  The file is cut into
+ * newline aligned chunks that are parsed in parallel and then merged
+ * with their indices renumbered, so the model is exactly the same as
+ * the one glmReadOBJ() returns for the same file.
+ *
+ * filename   - name of the file containing the Wavefront .OBJ format data.
+ * numthreads - number of threads to parse with (0 for one per core)
+ */
+GLMmodel*
+glmReadOBJThreaded(char* filename, GLuint numthreads);
+
+/* glmStreamOBJ: Starts a progressive read of a Wavefront .OBJ file.
+ * Returns a model that glmStreamStep() fills in a bit at a time, so a
+ * program can keep drawing while a large file loads.  Until it is
+ * complete, the model only holds the records parsed so far and
+ * glmDraw() draws just the triangles that are ready (with facet
+ * normals, for GLM_FLAT).  An up to date binary cache is read at once,
+ * in which case the model is already complete.
+ *
+ * filename - name of the file containing the Wavefront .OBJ format data.
+ */
+GLMmodel*
+glmStreamOBJ(char* filename);
+
+/* glmStreamStep: Parses the next part of a model started with
+ * glmStreamOBJ(), for about budget milliseconds.  Returns GL_TRUE once
+ * the whole file has been read; the model is then exactly what
+ * glmReadOBJ() would have returned.
+ *
+ * model  - model returned by glmStreamOBJ()
+ * budget - time to spend parsing, in milliseconds
+ */
+GLboolean
+glmStreamStep(GLMmodel* model, GLfloat budget);
+
+/* glmStreamTransform: Multiplies the current matrix by the transform
+ * that glmUnitize() followed by glmScale() would apply to the vertices
+ * of a model that is still loading, based on the vertices read so far.
+ * Does nothing for a complete model.
+ *
+ * model - model returned by glmStreamOBJ()
+ * scale - scalefactor that will be passed to glmScale()
+ */
+GLvoid
+glmStreamTransform(GLMmodel* model, GLfloat scale);
+
+/* glmReadCache: Reads a model from the binary cache of a Wavefront
+ * .OBJ file (the file name with GLM_CACHE_SUFFIX appended).  The cache
+ * is memory mapped and the model arrays point straight into it.
+ * Returns NULL if there is no cache, or if the OBJ file or its
+ * material library changed since the cache was written.
+ *
+ * filename - name of the Wavefront .OBJ file the cache was made from
+ */
+GLMmodel*
+glmReadCache(char* filename);
+
+/* glmWriteCache: Writes the binary cache of a model read from a
+ * Wavefront .OBJ file, for glmReadCache() to pick up next time.  The
+ * cache is written to a temporary file first and renamed into place.
+ * Returns GL_FALSE if it could not be written.
+ *
+ * model - initialized GLMmodel structure
+ */
+GLboolean
+glmWriteCache(GLMmodel* model);
+
 /* glmWriteOBJ: Writes a model description in Wavefront .OBJ format to
  * a file.
  *
@@ -220,6 +558,8 @@ glmWriteOBJ(GLMmodel* model, char* filename, GLuint mode);
  *            GLM_FLAT    -  render with facet normals
  *            GLM_SMOOTH  -  render with vertex normals
  *            GLM_TEXTURE -  render with texture coords
+ *            GLM_CULL    -  skip meshlets outside the view frustum or
+ *                           facing away from the eye (see glmBuildMeshlets())
  *            GLM_FLAT and GLM_SMOOTH should not both be specified.
  */
 GLvoid
@@ -250,6 +590,449 @@ glmList(GLMmodel* model, GLuint mode);
 GLvoid
 glmWeld(GLMmodel* model, GLfloat epsilon);
 
+/* glmWeldNormals: eliminate (weld) normals that are within an epsilon
+ * of each other.
+ *
+ * model      - initialized GLMmodel structure
+ * epsilon    - maximum difference between normals
+ */
+GLvoid
+glmWeldNormals(GLMmodel* model, GLfloat epsilon);
+
+/* glmWeldTexcoords: eliminate (weld) texture coordinates that are
+ * within an epsilon of each other.
+ *
+ * model      - initialized GLMmodel structure
+ * epsilon    - maximum difference between texture coordinates
+ */
+GLvoid
+glmWeldTexcoords(GLMmodel* model, GLfloat epsilon);
+
+/* glmCacheMissRatio: Returns the average cache miss ratio (ACMR) of
+ * drawing a model, that is how many vertices per triangle miss a FIFO
+ * post transform vertex cache of the given size.  Each group starts
+ * with an empty cache.  Ranges from 0.5 (ideal, for a large regular
+ * mesh) to 3.0 (no reuse at all).
+ *
+ * model     - initialized GLMmodel structure
+ * cachesize - number of entries in the cache (e.g. GLM_VERTEX_CACHE)
+ */
+GLfloat
+glmCacheMissRatio(GLMmodel* model, GLuint cachesize);
+
+/* glmOptimizeVertexCache: Reorders the triangles of each group of a
+ * model so that consecutive triangles reuse the vertices still in the
+ * post transform vertex cache (Tipsify).  Only the draw order changes,
+ * and groups with no more vertices than the cache has entries are left
+ * alone.
+ * glmReadOBJ() already does this with GLM_VERTEX_CACHE before writing
+ * the binary cache.  Returns the average cache miss ratio afterwards;
+ * call glmCacheMissRatio() first for the one before.
+ *
+ * model     - initialized GLMmodel structure
+ * cachesize - number of entries in the cache (e.g. GLM_VERTEX_CACHE)
+ */
+GLfloat
+glmOptimizeVertexCache(GLMmodel* model, GLuint cachesize);
+
+/* glmOptimizeOverdraw: Reorders the triangles of each group of a
+ * model to cut overdraw, independent of the viewpoint.  Each group is
+ * cut into clusters of triangles that are consecutive in vertex cache
+ * order, and the clusters are drawn outside-in: those facing away from
+ * the centroid of the group first, since they tend to hide the rest.
+ * Run it after glmOptimizeVertexCache(); the clusters cost at most
+ * about threshold times the cache miss ratio.  glmReadOBJ() already
+ * does this too.  Returns the average cache miss ratio afterwards.
+ *
+ * model     - initialized GLMmodel structure
+ * cachesize - number of entries in the cache (e.g. GLM_VERTEX_CACHE)
+ * threshold - allowed cache miss ratio factor (e.g. GLM_OVERDRAW_THRESHOLD)
+ */
+GLfloat
+glmOptimizeOverdraw(GLMmodel* model, GLuint cachesize, GLfloat threshold);
+
+/* glmBuildLODs: Builds a chain of simplified copies (levels of detail)
+ * of a model, linked from model->lod, coarsest last.  The triangles are
+ * reduced by quadric error edge collapses that keep the borders, the
+ * group (material) boundaries and the normal and texture coordinate
+ * seams in place, so the levels draw with the same modes.  Each level
+ * has its own facet normals and records its error (in model units) in
+ * level->error.  Levels that wouldn't save at least a tenth of the
+ * triangles of the one before are not made.  Build the levels once the
+ * model is prepared; glmLOD() ignores them after the vertices change.
+ * glmDelete() deletes them with the model.  Returns the number of
+ * levels built.
+ *
+ * model     - initialized GLMmodel structure
+ * numlevels - number of levels
+ * ratios    - fraction of the triangles of the model to keep in each
+ *             level, largest first (e.g. 0.5, 0.25, 0.1)
+ */
+GLuint
+glmBuildLODs(GLMmodel* model, GLuint numlevels, const GLfloat* ratios);
+
+/* glmBuildMeshlets: Cuts the triangles of each group of a model, and
+ * of its levels of detail, into meshlets: patches of at most
+ * maxtriangles neighbouring triangles, each with a bounding sphere.
+ * Meshlets on a closed surface (where every edge has two triangles)
+ * also get a cone around their facet normals, no wider than angle.
+ * glmDraw() with GLM_CULL skips the meshlets that are outside the view
+ * frustum or whose triangles all face away from the eye, without
+ * looking at their vertices.  The triangles of each group are reordered
+ * meshlet by meshlet.  Build them once the model is prepared and its
+ * triangles are in their final order (after glmBuildLODs() too); like
+ * the levels, they are ignored once the vertices change, and the
+ * optimize passes drop them.  Returns the number of meshlets of the
+ * model.
+ *
+ * model        - initialized GLMmodel structure
+ * maxtriangles - largest number of triangles in a meshlet
+ *                (e.g. GLM_MESHLET_TRIANGLES)
+ * angle        - largest angle (in degrees) between a facet normal and
+ *                the average one (e.g. GLM_MESHLET_ANGLE)
+ */
+GLuint
+glmBuildMeshlets(GLMmodel* model, GLuint maxtriangles, GLfloat angle);
+
+/* glmBuildIndexed: Converts the separately indexed vertices, normals
+ * and texture coordinates of a model, and of its levels of detail, into
+ * vertex arrays.  Each distinct (vertex, normal, texcoord) triplet the
+ * triangles use becomes one vertex of model->interleaved, laid out as
+ * model->interleavedformat says (for glInterleavedArrays()), and the
+ * triangles of each group become group->indices, three per triangle in
+ * draw order, of model->indextype (GL_UNSIGNED_SHORT if there are no
+ * more than 65536 vertices, else GL_UNSIGNED_INT).  Build them last,
+ * after anything that reorders the triangles (which drops them); they
+ * are ignored once the vertices change.  Returns the duplication ratio,
+ * how many interleaved vertices there are per vertex used (1.0 if no
+ * vertex had to be split at a normal or texture seam).
+ *
+ * model - initialized GLMmodel structure
+ * mode  - attributes to interleave with the vertices
+ *             GLM_NONE     -  only vertices
+ *             GLM_FLAT     -  facet normals
+ *             GLM_SMOOTH   -  vertex normals
+ *             GLM_TEXTURE  -  texture coords
+ */
+GLfloat
+glmBuildIndexed(GLMmodel* model, GLuint mode);
+
+/* glmLOD: Returns the coarsest level of detail of a model whose error
+ * covers no more than the given number of pixels on the screen, with
+ * the current modelview and projection matrices and viewport; that is
+ * the model itself if it has no (up to date) levels.
+ *
+ * model  - initialized GLMmodel structure
+ * pixels - largest error allowed, in pixels (e.g. GLM_LOD_PIXELS)
+ */
+GLMmodel*
+glmLOD(GLMmodel* model, GLfloat pixels);
+
+/* glmNewMesh: Makes a mesh that draws a model from OpenGL buffer
+ * objects (OpenGL 1.5): one with the interleaved vertices and one with
+ * the indices of all the groups, each group a range.  The vertex and
+ * index arrays are built first (see glmBuildIndexed()) unless they are
+ * up to date.  The levels of detail of the model get meshes too, linked
+ * from mesh->lod.  Make the mesh once the model is prepared, after its
+ * levels and meshlets.  The model has to stay around while the mesh is
+ * used.  Returns a pointer to the mesh, which should be free'd with
+ * glmDeleteMesh().
+ *
+ * model - initialized GLMmodel structure (with a current OpenGL context)
+ * mode  - attributes to put in the vertices
+ *             GLM_NONE     -  only vertices
+ *             GLM_FLAT     -  facet normals
+ *             GLM_SMOOTH   -  vertex normals
+ *             GLM_TEXTURE  -  texture coords
+ */
+GLMmesh*
+glmNewMesh(GLMmodel* model, GLuint mode);
+
+/* glmDrawMesh: Renders a mesh to the current OpenGL context with one
+ * glDrawElements() per group (or per run of meshlets that can be seen,
+ * with GLM_CULL), with the attributes it was made with.  If the
+ * vertices of the model changed since, draws the model with glmDraw()
+ * instead.
+ *
+ * mesh - mesh made by glmNewMesh()
+ * mode - a bitwise OR of values describing what is to be rendered.
+ *            GLM_COLOR    -  render with colors (color material)
+ *            GLM_MATERIAL -  render with materials
+ *            GLM_CULL     -  skip meshlets that can't be seen
+ *            GLM_COLOR and GLM_MATERIAL should not both be specified.
+ */
+GLvoid
+glmDrawMesh(GLMmesh* mesh, GLuint mode);
+
+/* glmMeshLOD: Returns the mesh of the level of detail that glmLOD()
+ * picks for the model of a mesh.
+ *
+ * mesh   - mesh made by glmNewMesh()
+ * pixels - largest error allowed, in pixels (e.g. GLM_LOD_PIXELS)
+ */
+GLMmesh*
+glmMeshLOD(GLMmesh* mesh, GLfloat pixels);
+
+/* glmDeleteMesh: Deletes a mesh, with its buffer objects and the
+ * meshes of its levels of detail.
+ *
+ * mesh - mesh made by glmNewMesh()
+ */
+GLvoid
+glmDeleteMesh(GLMmesh* mesh);
+
+/* glmNewListCache: Makes an empty cache of display lists.  Returns a
+ * pointer to the cache, which should be free'd with
+ * glmDeleteListCache().
+ *
+ * maxlists - most lists to keep (e.g. GLM_LIST_CACHE); the least
+ *            recently used one is deleted to make room for another
+ */
+GLMlistcache*
+glmNewListCache(GLuint maxlists);
+
+/* glmCallList: Renders a model to the current OpenGL context with the
+ * display list glmList() compiles for it and a mode.  The list is
+ * compiled the first time, and again whenever the vertices of the
+ * model have changed (its version), so drawing a model that doesn't
+ * change only costs a glCallList().
+ *
+ * cache - list cache made by glmNewListCache()
+ * model - initialized GLMmodel structure (not still streaming)
+ * mode  - a bitwise OR of values describing what is to be rendered
+ *         (see glmList())
+ */
+GLvoid
+glmCallList(GLMlistcache* cache, GLMmodel* model, GLuint mode);
+
+/* glmForgetLists: Deletes the lists a cache has for a model.  Call it
+ * before deleting a model that was drawn through the cache.
+ *
+ * cache - list cache made by glmNewListCache()
+ * model - model whose lists to delete
+ */
+GLvoid
+glmForgetLists(GLMlistcache* cache, GLMmodel* model);
+
+/* glmDeleteListCache: Deletes a list cache and its display lists.
+ *
+ * cache - list cache made by glmNewListCache()
+ */
+GLvoid
+glmDeleteListCache(GLMlistcache* cache);
+
+/* glmEnable, glmDisable, glmBindTexture, glmMaterialfv, glmMaterialf,
+ * glmColorMaterial, glmColor4fv, glmColor3fv, glmColor3ub, glmTexGeni:
+ * The OpenGL calls of the same names, through a cache of the state
+ * they set (in the current context) that drops the calls that
+ * wouldn't change it.  Only the enable bits of lighting, the lights,
+ * depth test, normalize, face culling, blending, color material, 2D
+ * texturing and texture generation, and the 2D texture binding are
+ * shadowed; other capabilities and targets are passed on.
+ */
+GLvoid
+glmEnable(GLenum cap);
+
+GLvoid
+glmDisable(GLenum cap);
+
+GLvoid
+glmBindTexture(GLenum target, GLuint texture);
+
+GLvoid
+glmMaterialfv(GLenum face, GLenum pname, const GLfloat* params);
+
+GLvoid
+glmMaterialf(GLenum face, GLenum pname, GLfloat param);
+
+GLvoid
+glmColorMaterial(GLenum face, GLenum mode);
+
+GLvoid
+glmColor4fv(const GLfloat* v);
+
+GLvoid
+glmColor3fv(const GLfloat* v);
+
+GLvoid
+glmColor3ub(GLubyte red, GLubyte green, GLubyte blue);
+
+GLvoid
+glmTexGeni(GLenum coord, GLenum pname, GLint param);
+
+/* glmForgetState: Makes state the state cache shadows unknown again.
+ * Call it after setting that state with OpenGL directly (a display
+ * list, glPopAttrib()), so the next glm* call that sets it goes
+ * through.
+ *
+ * mask - glPushAttrib() style bits of the state to forget
+ *            GL_ENABLE_BIT   -  enable bits
+ *            GL_TEXTURE_BIT  -  bound texture and texture generation
+ *            GL_LIGHTING_BIT -  materials and color material
+ *            GL_CURRENT_BIT  -  current color
+ *            GL_ALL_ATTRIB_BITS for all of it
+ */
+GLvoid
+glmForgetState(GLbitfield mask);
+
+/* glmStateCounts: Returns how many calls the state cache passed on to
+ * OpenGL and how many it dropped, since the last time it was asked.
+ *
+ * issued  - calls passed on
+ * avoided - calls dropped as redundant
+ */
+GLvoid
+glmStateCounts(GLuint* issued, GLuint* avoided);
+
+/* glmPrimitive: Returns a primitive shape, made (along with its
+ * buffers) the first time it is asked for (see glmprim.cpp).
+ *
+ * shape - GLM_CUBE or GLM_SPHERE
+ */
+GLMprimitive*
+glmPrimitive(GLuint shape);
+
+/* glmPrimitiveLevel: Returns the level of detail of a primitive to draw
+ * with the current OpenGL matrices and viewport: the coarsest that is
+ * within pixels of the true shape on screen.
+ *
+ * primitive - primitive returned by glmPrimitive()
+ * pixels    - largest error allowed, in pixels (GLM_LOD_PIXELS)
+ */
+GLuint
+glmPrimitiveLevel(GLMprimitive* primitive, GLfloat pixels);
+
+/* glmDrawPrimitive: Draws a primitive shape (at the level
+ * glmPrimitiveLevel() picks), in place of glutSolidCube(1.0) or
+ * glutSolidSphere(1.0, ...).  Use glScalef() for other sizes and for
+ * boxes.
+ *
+ * shape  - GLM_CUBE or GLM_SPHERE
+ * pixels - largest error allowed, in pixels (GLM_LOD_PIXELS)
+ */
+GLvoid
+glmDrawPrimitive(GLuint shape, GLfloat pixels);
+
+/* glmDeletePrimitives: Deletes the primitives made so far and their
+ * buffers.
+ */
+GLvoid
+glmDeletePrimitives(GLvoid);
+
+/* glmNewBatch: Makes a batch of copies of a shape, each placed by its
+ * own modelview matrix and drawn in its own color, that are drawn with
+ * one draw call (see glmbatch.cpp).
+ *
+ * shape       - triangles of the shape, a normal and a position per
+ *               vertex (6 floats, like GL_N3F_V3F)
+ * numvertices - number of vertices (3 per triangle)
+ */
+GLMbatch*
+glmNewBatch(const GLfloat* shape, GLuint numvertices);
+
+/* glmNewCubeBatch: Makes a batch of copies of the cube
+ * glutSolidCube(1.0) draws (the GLM_CUBE primitive).
+ */
+GLMbatch*
+glmNewCubeBatch(GLvoid);
+
+/* glmBatchBegin: Drops the copies added for the last frame.
+ *
+ * batch - batch made by glmNewBatch()
+ */
+GLvoid
+glmBatchBegin(GLMbatch* batch);
+
+/* glmBatchAdd: Adds a copy of the shape, placed by the current
+ * modelview matrix.
+ *
+ * batch - batch made by glmNewBatch()
+ * color - color of the copy (RGBA)
+ */
+GLvoid
+glmBatchAdd(GLMbatch* batch, const GLfloat* color);
+
+/* glmDrawBatch: Draws the copies added since glmBatchBegin() with one
+ * draw call, whatever the current modelview matrix.  The colors are
+ * drawn as the current color, so they are only lit with the color
+ * material enabled.
+ *
+ * batch - batch made by glmNewBatch()
+ */
+GLvoid
+glmDrawBatch(GLMbatch* batch);
+
+/* glmDeleteBatch: Deletes a batch.
+ *
+ * batch - batch made by glmNewBatch()
+ */
+GLvoid
+glmDeleteBatch(GLMbatch* batch);
+
+#define GLM_QUEUE_OPAQUE 0      /* queue pass drawn first, front to back */
+#define GLM_QUEUE_BLEND  1      /* queue pass drawn last, back to front */
+
+/* glmNewQueue: Makes an empty render queue.  Things queued in it are
+ * drawn by glmQueueFlush(), sorted by pass, texture, material and
+ * color, and eye distance (see glmqueue.cpp).
+ */
+GLMqueue*
+glmNewQueue(GLvoid);
+
+/* glmQueueBegin: Empties a render queue for a new frame.
+ *
+ * queue - render queue made by glmNewQueue()
+ */
+GLvoid
+glmQueueBegin(GLMqueue* queue);
+
+/* glmQueueMesh: Queues the groups of a mesh, to be drawn with the
+ * current modelview matrix in the opaque pass.  A mesh that is out of
+ * date is drawn right away instead.
+ *
+ * queue - render queue made by glmNewQueue()
+ * mesh  - mesh made by glmNewMesh()
+ * mode  - a bitwise OR of values describing what is to be rendered.
+ *             GLM_MATERIAL -  render with materials
+ *             GLM_CULL     -  skip meshlets that can't be seen
+ */
+GLvoid
+glmQueueMesh(GLMqueue* queue, GLMmesh* mesh, GLuint mode);
+
+/* glmQueueCall: Queues a callback that draws something with the
+ * current modelview matrix.  The callback may use the glm* state calls
+ * but has to leave client arrays and buffers as it found them.
+ *
+ * queue    - render queue made by glmNewQueue()
+ * pass     - GLM_QUEUE_OPAQUE or GLM_QUEUE_BLEND
+ * texture  - 2D texture to draw with (0 for none)
+ * material - material to draw with (NULL to leave the material alone)
+ * color    - color material (diffuse) color (NULL for none)
+ * center   - point to measure the eye distance to (NULL for the origin)
+ * draw     - function that draws it
+ * data     - argument to pass to draw
+ */
+GLvoid
+glmQueueCall(GLMqueue* queue, GLuint pass, GLuint texture,
+    GLMmaterial* material, const GLfloat* color, const GLfloat* center,
+    GLMdrawfunc draw, GLvoid* data);
+
+/* glmQueueFlush: Draws what was queued since glmQueueBegin() in key
+ * order.  It leaves the modelview matrix as it found it and 2D
+ * texturing off.
+ *
+ * queue - render queue made by glmNewQueue()
+ */
+GLvoid
+glmQueueFlush(GLMqueue* queue);
+
+/* glmDeleteQueue: Deletes a render queue.
+ *
+ * queue - render queue made by glmNewQueue()
+ */
+GLvoid
+glmDeleteQueue(GLMqueue* queue);
+
 /* glmReadPPM: read a PPM raw (type P6) file.  The PPM file has a header
  * that should look something like:
  *
@@ -280,3 +1063,5 @@ glmWeld(GLMmodel* model, GLfloat epsilon);
  */
 GLubyte* 
 glmReadPPM(char* filename, int* width, int* height);
+
+#endif
@@ -0,0 +1,296 @@
+/*
+      glmarena.cpp
+
+      Arena allocator that owns the storage of a GLMmodel.
+
+      The arrays, groups and names a model is loaded with are carved
+      out of a few large blocks, so loading does a handful of
+      allocations instead of one per array and name, related data ends
+      up next to each other and deleting the model releases everything
+      at once.  Every allocation starts on a cache line (GLM_ARENA_ALIGN
+      bytes).  Large blocks are mapped separately and, on Linux, marked
+      for transparent huge pages.
+
+      There is no per-allocation free: memory given back with
+      glmArenaRelease() is only reused if it was the most recent
+      allocation, and everything else is reclaimed by glmArenaDelete().
+      So the arrays that are computed again and again (normals, texture
+      coordinates, soa and index arrays, meshlets) don't come from here;
+      they are malloc()'d, and glmFree() tells the two apart.
+
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+#include "glm.h"
+#include "glmint.h"
+
+
+#define GLM_ARENA_BLOCK (64 << 10)      /* size of the first block */
+#define GLM_ARENA_HUGE  (2 << 20)       /* blocks this big use huge pages */
+
+
+/* GLMblock: header at the start of every block of an arena */
+typedef struct _GLMblock {
+  struct _GLMblock* next;       /* previously allocated block */
+  size_t   size;                /* size of the whole block */
+  size_t   used;                /* bytes handed out (from the block start) */
+  size_t   last;                /* offset of the most recent allocation
+                                   ((size_t)-1 after a release) */
+  GLboolean mapped;             /* block was mmap()'d, not malloc()'d */
+} GLMblock;
+
+/* GLMarena: a model's arena, the list of its blocks (newest first) */
+struct _GLMarena {
+  GLMblock* blocks;             /* block allocations come from */
+  size_t    total;              /* bytes in all blocks */
+};
+
+
+/* glmAlignUp: round a size up to a multiple of a power of two */
+static size_t
+glmAlignUp(size_t size, size_t align)
+{
+    return (size + align - 1) & ~(align - 1);
+}
+
+/* glmNewBlock: allocate a block with room for at least size bytes */
+static GLMblock*
+glmNewBlock(GLMarena* arena, size_t size)
+{
+    GLMblock* block;
+    size_t blocksize;
+    GLboolean mapped = GL_FALSE;
+
+    /* blocks double with the arena, so a model needs only a few */
+    blocksize = glmAlignUp(sizeof(GLMblock), GLM_ARENA_ALIGN) + size;
+    if (blocksize < GLM_ARENA_BLOCK)
+        blocksize = GLM_ARENA_BLOCK;
+    if (blocksize < arena->total)
+        blocksize = arena->total;
+
+    block = NULL;
+#if defined(__linux__)
+    if (blocksize >= GLM_ARENA_HUGE) {
+        blocksize = glmAlignUp(blocksize, GLM_ARENA_HUGE);
+        block = (GLMblock*)mmap(NULL, blocksize, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (block == (GLMblock*)MAP_FAILED)
+            block = NULL;
+#if defined(MADV_HUGEPAGE)
+        else
+            madvise(block, blocksize, MADV_HUGEPAGE);
+#endif
+        mapped = block != NULL;
+    }
+#endif
+    if (!block) {
+        blocksize = glmAlignUp(blocksize, GLM_ARENA_ALIGN);
+        block = (GLMblock*)aligned_alloc(GLM_ARENA_ALIGN, blocksize);
+    }
+    if (!block) {
+        fprintf(stderr, "glmArenaAlloc() failed: out of memory.\n");
+        exit(1);
+    }
+
+    block->next = arena->blocks;
+    block->size = blocksize;
+    block->used = glmAlignUp(sizeof(GLMblock), GLM_ARENA_ALIGN);
+    block->last = block->used;
+    block->mapped = mapped;
+    arena->blocks = block;
+    arena->total += blocksize;
+
+    return block;
+}
+
+
+/* glmArenaCreate: Creates an empty arena.
+ */
+GLMarena*
+glmArenaCreate(GLvoid)
+{
+    GLMarena* arena;
+
+    arena = (GLMarena*)malloc(sizeof(GLMarena));
+    arena->blocks = NULL;
+    arena->total = 0;
+    return arena;
+}
+
+/* glmArenaAlloc: Allocates size bytes (aligned to a cache line) from
+ * an arena.
+ *
+ * arena - arena to allocate from
+ * size  - number of bytes
+ */
+GLvoid*
+glmArenaAlloc(GLMarena* arena, size_t size)
+{
+    GLMblock* block;
+    size_t start;
+
+    assert(arena);
+
+    block = arena->blocks;
+    start = block ? glmAlignUp(block->used, GLM_ARENA_ALIGN) : 0;
+    if (!block || start + size > block->size) {
+        block = glmNewBlock(arena, size);
+        start = block->used;
+    }
+    block->last = start;
+    block->used = start + size;
+
+    return (char*)block + start;
+}
+
+/* glmArenaStrdup: strdup() into an arena.
+ *
+ * arena - arena to allocate from
+ * s     - string to copy
+ */
+char*
+glmArenaStrdup(GLMarena* arena, const char* s)
+{
+    size_t size;
+    char* copy;
+
+    size = strlen(s) + 1;
+    copy = (char*)glmArenaAlloc(arena, size);
+    memcpy(copy, s, size);
+    return copy;
+}
+
+/* glmArenaOwns: Returns GL_TRUE if p points into one of the blocks of
+ * an arena.
+ *
+ * arena - arena to check (may be NULL)
+ * p     - pointer to check
+ */
+GLboolean
+glmArenaOwns(GLMarena* arena, const GLvoid* p)
+{
+    GLMblock* block;
+
+    if (!arena)
+        return GL_FALSE;
+    for (block = arena->blocks; block; block = block->next)
+        if ((const char*)p >= (const char*)block &&
+            (const char*)p < (const char*)block + block->size)
+            return GL_TRUE;
+    return GL_FALSE;
+}
+
+/* glmArenaRelease: Gives memory back to an arena.  Only the most recent
+ * allocation is actually reused; anything else stays allocated until
+ * the arena is deleted.
+ *
+ * arena - arena p was allocated from
+ * p     - pointer returned by glmArenaAlloc()
+ */
+GLvoid
+glmArenaRelease(GLMarena* arena, GLvoid* p)
+{
+    GLMblock* block = arena->blocks;
+
+    if (block && block->last != (size_t)-1 &&
+        (char*)p == (char*)block + block->last) {
+        block->used = block->last;
+        block->last = (size_t)-1;       /* nothing to roll back to now */
+    }
+}
+
+/* glmArenaReset: Makes all of an arena free again, keeping only its
+ * newest (largest) block, so an arena that is reset every frame stops
+ * allocating once it is as big as a frame needs.
+ *
+ * arena - arena to reset
+ */
+GLvoid
+glmArenaReset(GLMarena* arena)
+{
+    GLMblock* block;
+    GLMblock* older;
+
+    assert(arena);
+
+    block = arena->blocks;
+    if (!block)
+        return;
+    while (block->next) {
+        older = block->next;
+        block->next = older->next;
+        arena->total -= older->size;
+#if defined(__linux__)
+        if (older->mapped) {
+            munmap(older, older->size);
+            continue;
+        }
+#endif
+        free(older);
+    }
+    block->used = glmAlignUp(sizeof(GLMblock), GLM_ARENA_ALIGN);
+    block->last = block->used;
+}
+
+/* glmArenaDelete: Releases an arena and everything allocated from it.
+ *
+ * arena - arena to delete (may be NULL)
+ */
+GLvoid
+glmArenaDelete(GLMarena* arena)
+{
+    GLMblock* block;
+
+    if (!arena)
+        return;
+    while (arena->blocks) {
+        block = arena->blocks;
+        arena->blocks = block->next;
+#if defined(__linux__)
+        if (block->mapped) {
+            munmap(block, block->size);
+            continue;
+        }
+#endif
+        free(block);
+    }
+    free(arena);
+}
+
+
+/* glmAlloc: malloc() for memory owned by a model (from its arena) */
+GLvoid*
+glmAlloc(GLMmodel* model, size_t size)
+{
+    if (!model->arena)
+        model->arena = glmArenaCreate();
+    return glmArenaAlloc(model->arena, size);
+}
+
+/* glmStrdup: strdup() for strings owned by a model */
+char*
+glmStrdup(GLMmodel* model, const char* s)
+{
+    if (!model->arena)
+        model->arena = glmArenaCreate();
+    return glmArenaStrdup(model->arena, s);
+}
+
+/* glmFree: free() for memory owned by a model */
+GLvoid
+glmFree(GLMmodel* model, GLvoid* p)
+{
+    if (!p || glmCached(model, p))
+        return;
+    if (glmArenaOwns(model->arena, p))
+        glmArenaRelease(model->arena, p);
+    else
+        free(p);
+}
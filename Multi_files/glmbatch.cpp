@@ -0,0 +1,242 @@
+/*
+      glmbatch.cpp
+
+      Batched drawing of a small shape for the GLM library.
+
+      Drawing a lot of copies of a small shape (the cubes a figure is
+      built from, say) one by one costs a draw call, a matrix and a
+      color each.  A GLMbatch keeps the shape once and collects the
+      copies (instances) of a frame, each with the modelview matrix and
+      color it was added with.  glmDrawBatch() then transforms all of
+      them into eye space on the CPU, streams the result into a buffer
+      object and draws it with a single glDrawArrays().  There is no
+      instancing in the fixed function pipeline (the instance matrix
+      would need a vertex shader), so this is the way to get one draw.
+
+ */
+
+
+#define GL_GLEXT_PROTOTYPES             /* buffer objects (OpenGL 1.5) */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "glm.h"
+#include "glmint.h"
+
+
+#define GLM_BATCH_INSTANCES 64  /* instances a batch has room for at first */
+
+
+/* glmBatchCross: n = u x v */
+static GLvoid
+glmBatchCross(const GLfloat* u, const GLfloat* v, GLfloat* n)
+{
+    n[0] = u[1]*v[2] - u[2]*v[1];
+    n[1] = u[2]*v[0] - u[0]*v[2];
+    n[2] = u[0]*v[1] - u[1]*v[0];
+}
+
+/* glmNewBatch: Makes a batch of copies of a shape.
+ *
+ * shape       - triangles of the shape, a normal and a position per
+ *               vertex (6 floats, like GL_N3F_V3F)
+ * numvertices - number of vertices (3 per triangle)
+ */
+GLMbatch*
+glmNewBatch(const GLfloat* shape, GLuint numvertices)
+{
+    GLMbatch* batch;
+
+    assert(shape);
+    assert(numvertices % 3 == 0);
+
+    batch = (GLMbatch*)malloc(sizeof(GLMbatch));
+    batch->numvertices = numvertices;
+    batch->shape = (GLfloat*)malloc(sizeof(GLfloat) * 6 * numvertices);
+    memcpy(batch->shape, shape, sizeof(GLfloat) * 6 * numvertices);
+    batch->numinstances = 0;
+    batch->maxinstances = GLM_BATCH_INSTANCES;
+    batch->matrices = (GLfloat*)malloc(sizeof(GLfloat) * 16 *
+        batch->maxinstances);
+    batch->colors = (GLfloat*)malloc(sizeof(GLfloat) * 4 *
+        batch->maxinstances);
+    batch->vertices = (GLfloat*)malloc(sizeof(GLfloat) * 10 *
+        numvertices * batch->maxinstances);
+    glGenBuffers(1, &batch->vbo);
+    batch->drawcalls = 0;
+
+    return batch;
+}
+
+/* glmNewCubeBatch: Makes a batch of copies of the cube
+ * glutSolidCube(1.0) draws (the GLM_CUBE primitive).
+ */
+GLMbatch*
+glmNewCubeBatch(GLvoid)
+{
+    GLMprimitive* cube;
+    GLMbatch* batch;
+    GLfloat* shape;
+    GLuint i;
+
+    /* the batch wants the triangles' vertices in order */
+    cube = glmPrimitive(GLM_CUBE);
+    shape = (GLfloat*)malloc(sizeof(GLfloat) * 6 * cube->count[0]);
+    for (i = 0; i < cube->count[0]; i++)
+        memcpy(&shape[6 * i],
+            &cube->vertices[6 * cube->indices[cube->first[0] + i]],
+            sizeof(GLfloat) * 6);
+    batch = glmNewBatch(shape, cube->count[0]);
+    free(shape);
+
+    return batch;
+}
+
+/* glmBatchBegin: Drops the instances of the last frame.
+ *
+ * batch - batch made by glmNewBatch()
+ */
+GLvoid
+glmBatchBegin(GLMbatch* batch)
+{
+    assert(batch);
+    batch->numinstances = 0;
+}
+
+/* glmBatchAdd: Adds a copy of the shape, placed by the current
+ * modelview matrix.
+ *
+ * batch - batch made by glmNewBatch()
+ * color - color of the copy (RGBA)
+ */
+GLvoid
+glmBatchAdd(GLMbatch* batch, const GLfloat* color)
+{
+    assert(batch);
+    assert(color);
+
+    if (batch->numinstances == batch->maxinstances) {
+        batch->maxinstances *= 2;
+        batch->matrices = (GLfloat*)realloc(batch->matrices,
+            sizeof(GLfloat) * 16 * batch->maxinstances);
+        batch->colors = (GLfloat*)realloc(batch->colors,
+            sizeof(GLfloat) * 4 * batch->maxinstances);
+        batch->vertices = (GLfloat*)realloc(batch->vertices,
+            sizeof(GLfloat) * 10 * batch->numvertices * batch->maxinstances);
+    }
+
+    glGetFloatv(GL_MODELVIEW_MATRIX, &batch->matrices[16 * batch->numinstances]);
+    memcpy(&batch->colors[4 * batch->numinstances], color, sizeof(GLfloat) * 4);
+    batch->numinstances++;
+}
+
+/* glmBatchTransform: transform the copies of the shape into eye space,
+ * as GL_C4F_N3F_V3F vertices */
+static GLvoid
+glmBatchTransform(GLMbatch* batch)
+{
+    const GLfloat* m;
+    const GLfloat* color;
+    const GLfloat* s;
+    GLfloat* v;
+    GLfloat cofactor[9], l;
+    GLuint i, j;
+
+    v = batch->vertices;
+    for (i = 0; i < batch->numinstances; i++) {
+        m = &batch->matrices[16 * i];
+        color = &batch->colors[4 * i];
+
+        /* normals go through the inverse transpose of the upper 3x3,
+           whose columns are the cross products of the other two
+           columns over the determinant (only its sign matters here) */
+        glmBatchCross(&m[4], &m[8], &cofactor[0]);
+        glmBatchCross(&m[8], &m[0], &cofactor[3]);
+        glmBatchCross(&m[0], &m[4], &cofactor[6]);
+        if (m[0] * cofactor[0] + m[1] * cofactor[1] + m[2] * cofactor[2] < 0.0)
+            for (j = 0; j < 9; j++)
+                cofactor[j] = -cofactor[j];
+
+        for (j = 0, s = batch->shape; j < batch->numvertices; j++, s += 6) {
+            v[0] = color[0];
+            v[1] = color[1];
+            v[2] = color[2];
+            v[3] = color[3];
+            v[4] = cofactor[0] * s[0] + cofactor[3] * s[1] + cofactor[6] * s[2];
+            v[5] = cofactor[1] * s[0] + cofactor[4] * s[1] + cofactor[7] * s[2];
+            v[6] = cofactor[2] * s[0] + cofactor[5] * s[1] + cofactor[8] * s[2];
+            l = sqrt(v[4] * v[4] + v[5] * v[5] + v[6] * v[6]);
+            if (l > 0.0) {
+                v[4] /= l;
+                v[5] /= l;
+                v[6] /= l;
+            }
+            v[7] = m[0] * s[3] + m[4] * s[4] + m[8] * s[5] + m[12];
+            v[8] = m[1] * s[3] + m[5] * s[4] + m[9] * s[5] + m[13];
+            v[9] = m[2] * s[3] + m[6] * s[4] + m[10] * s[5] + m[14];
+            v += 10;
+        }
+    }
+}
+
+/* glmDrawBatch: Draws the copies added since glmBatchBegin() with one
+ * draw call.  Their colors are drawn as the current color, so to light
+ * them the color material has to be enabled.
+ *
+ * batch - batch made by glmNewBatch()
+ */
+GLvoid
+glmDrawBatch(GLMbatch* batch)
+{
+    GLuint count;
+
+    assert(batch);
+    if (!batch->numinstances)
+        return;
+
+    glmBatchTransform(batch);
+    count = batch->numvertices * batch->numinstances;
+
+    /* a new store each frame, so the driver doesn't have to wait for
+       the last frame to be done with the old one */
+    glBindBuffer(GL_ARRAY_BUFFER, batch->vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 10 * count,
+        batch->vertices, GL_STREAM_DRAW);
+    glInterleavedArrays(GL_C4F_N3F_V3F, 0, NULL);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glDrawArrays(GL_TRIANGLES, 0, count);
+    glPopMatrix();
+    batch->drawcalls++;
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    /* the current color is undefined after drawing with a color array,
+       and with the color material on each color also went into the
+       material, behind the state cache's back */
+    glmForgetState(GL_CURRENT_BIT | GL_LIGHTING_BIT);
+}
+
+/* glmDeleteBatch: Deletes a batch and its buffer.
+ *
+ * batch - batch made by glmNewBatch()
+ */
+GLvoid
+glmDeleteBatch(GLMbatch* batch)
+{
+    assert(batch);
+
+    glDeleteBuffers(1, &batch->vbo);
+    free(batch->shape);
+    free(batch->matrices);
+    free(batch->colors);
+    free(batch->vertices);
+    free(batch);
+}
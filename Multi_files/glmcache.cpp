@@ -0,0 +1,603 @@
+/*
+      glmcache.cpp
+
+      Binary model cache (.glmb sidecar files) for the GLM library.
+
+      The first time glmReadOBJ() parses a file it writes the finished
+      GLMmodel next to it as <file>.glmb.  Later reads map the cache
+      and point the model arrays straight into the mapping: nothing is
+      parsed and nothing is copied.  The mapping is private and
+      writable, so the glm* functions can still edit the model in
+      place (pages are copied on write, the file never changes).
+
+      The cache records the size, modification time and a hash of the
+      OBJ file and of its material library.  It is only used while both
+      files are unchanged: a different size invalidates it, and a
+      different modification time makes the file be hashed again.
+
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include <sys/stat.h>
+#include "glm.h"
+#include "glmint.h"
+
+
+#define GLM_CACHE_MAGIC   0x424d4c47    /* "GLMB" */
+#define GLM_CACHE_VERSION 3           /* 3: triangles in overdraw order */
+#define GLM_CACHE_ALIGN   64            /* alignment of every section */
+
+
+/* GLMstamp: what identifies one version of a source file */
+typedef struct _GLMstamp {
+  unsigned long long size;            /* size in bytes */
+  unsigned long long mtime;           /* modification time (ns) */
+  unsigned long long hash;            /* FNV-1a hash of the contents */
+} GLMstamp;
+
+/* GLMcacheheader: start of a .glmb file.  Offsets are from the start
+ * of the file; pointers inside the stored materials and groups hold
+ * offsets too, until glmReadCache() relocates them.
+ */
+typedef struct _GLMcacheheader {
+  GLuint   magic;                     /* GLM_CACHE_MAGIC */
+  GLuint   version;                   /* GLM_CACHE_VERSION */
+  GLuint   sizes;                     /* layout check, see glmLayout() */
+  GLuint   numvertices;
+  GLuint   numnormals;
+  GLuint   numtexcoords;
+  GLuint   numfacetnorms;
+  GLuint   numtriangles;
+  GLuint   nummaterials;
+  GLuint   numgroups;
+  GLMstamp obj;                       /* the OBJ file cached */
+  GLMstamp mtl;                       /* its material library (if any) */
+  unsigned long long mtllibname;      /* offset of the name, or 0 */
+  unsigned long long vertices;
+  unsigned long long normals;
+  unsigned long long texcoords;
+  unsigned long long facetnorms;
+  unsigned long long triangles;
+  unsigned long long materials;
+  unsigned long long groups;          /* GLMgroup array in list order */
+  unsigned long long size;            /* size of the whole file */
+} GLMcacheheader;
+
+
+/* glmLayout: a number that changes whenever the in-memory layout the
+ * cache depends on does (pointer size, structure sizes) */
+static GLuint
+glmLayout(GLvoid)
+{
+    return (GLuint)(sizeof(GLvoid*) << 24 ^ sizeof(GLMtriangle) << 16 ^
+        sizeof(GLMmaterial) << 8 ^ sizeof(GLMgroup));
+}
+
+/* glmCacheName: return the name of the cache of an OBJ file
+ *
+ * NOTE: the return value should be free'd.
+ */
+static char*
+glmCacheName(const char* filename)
+{
+    char* name;
+
+    name = (char*)malloc(strlen(filename) + strlen(GLM_CACHE_SUFFIX) + 1);
+    strcpy(name, filename);
+    strcat(name, GLM_CACHE_SUFFIX);
+    return name;
+}
+
+/* glmMtlName: return the path of the material library of a model, or
+ * NULL if it doesn't have one.
+ *
+ * NOTE: the return value should be free'd.
+ */
+static char*
+glmMtlName(char* pathname, const char* mtllibname)
+{
+    char* dir;
+    char* name;
+
+    if (!mtllibname)
+        return NULL;
+    dir = glmDirName(pathname);
+    name = (char*)malloc(strlen(dir) + strlen(mtllibname) + 1);
+    strcpy(name, dir);
+    strcat(name, mtllibname);
+    free(dir);
+    return name;
+}
+
+/* glmHash: FNV-1a hash of a whole file (0 if it can't be read) */
+static unsigned long long
+glmHash(const char* filename)
+{
+    unsigned long long hash;
+    GLMfile file;
+    size_t i;
+
+    if (!glmMapFile(&file, filename))
+        return 0;
+    hash = 0xcbf29ce484222325ULL;
+    for (i = 0; i < file.size; i++) {
+        hash ^= (unsigned char)file.data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    glmUnmapFile(&file);
+    return hash;
+}
+
+/* glmStat: size and modification time of a file */
+static GLboolean
+glmStat(const char* filename, GLMstamp* stamp)
+{
+    struct stat st;
+
+    if (stat(filename, &st) < 0)
+        return GL_FALSE;
+    stamp->size = st.st_size;
+    stamp->mtime = (unsigned long long)st.st_mtime * 1000000000ULL;
+#if defined(__linux__)
+    stamp->mtime += st.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    stamp->mtime += st.st_mtimespec.tv_nsec;
+#endif
+    return GL_TRUE;
+}
+
+/* glmStamp: fill in the full stamp (including hash) of a file */
+static GLboolean
+glmStamp(const char* filename, GLMstamp* stamp)
+{
+    if (!glmStat(filename, stamp))
+        return GL_FALSE;
+    stamp->hash = glmHash(filename);
+    return GL_TRUE;
+}
+
+/* glmFresh: check a source file against the stamp it was cached with.
+ * Only hashes the file if the size matches but the time doesn't, and
+ * then moves the stamp to the new time if the contents are the same
+ * (see glmRestamp()).
+ */
+static GLboolean
+glmFresh(const char* filename, GLMstamp* stamp)
+{
+    GLMstamp now;
+
+    if (!glmStat(filename, &now) || now.size != stamp->size)
+        return GL_FALSE;
+    if (now.mtime == stamp->mtime)
+        return GL_TRUE;
+    if (glmHash(filename) != stamp->hash)
+        return GL_FALSE;
+    stamp->mtime = now.mtime;
+    return GL_TRUE;
+}
+
+/* glmRestamp: write the stamps of a cache header back to the cache
+ * file, so a source file that was only touched isn't hashed again on
+ * every read.  Failing is harmless (the next read hashes again).
+ */
+static GLvoid
+glmRestamp(const char* filename, const GLMcacheheader* header)
+{
+    char* cachename;
+    FILE* file;
+
+    cachename = glmCacheName(filename);
+    file = fopen(cachename, "r+b");
+    free(cachename);
+    if (!file)
+        return;
+    if (fseek(file, offsetof(GLMcacheheader, obj), SEEK_SET) == 0)
+        fwrite(&header->obj, sizeof(GLMstamp), 1, file);
+    if (fseek(file, offsetof(GLMcacheheader, mtl), SEEK_SET) == 0)
+        fwrite(&header->mtl, sizeof(GLMstamp), 1, file);
+    fclose(file);
+}
+
+/* glmAlign: round an offset up to the section alignment */
+static unsigned long long
+glmAlign(unsigned long long offset)
+{
+    return (offset + GLM_CACHE_ALIGN - 1) & ~(unsigned long long)(GLM_CACHE_ALIGN - 1);
+}
+
+/* glmPut: write a section at the (aligned) current offset and return
+ * where it went, or 0 for an empty section */
+static unsigned long long
+glmPut(FILE* file, unsigned long long* offset, const GLvoid* data, size_t size)
+{
+    static const char zeros[GLM_CACHE_ALIGN] = { 0 };
+    unsigned long long start;
+
+    if (!data || !size)
+        return 0;
+    start = glmAlign(*offset);
+    fwrite(zeros, 1, start - *offset, file);
+    fwrite(data, 1, size, file);
+    *offset = start + size;
+    return start;
+}
+
+/* glmSection: check that a section of count elements of size bytes at
+ * offset lies within a cache of the given size (and is aligned the way
+ * glmPut() aligns it) */
+static GLboolean
+glmSection(unsigned long long offset, unsigned long long count, size_t size,
+    size_t cachesize)
+{
+    if (offset < sizeof(GLMcacheheader) || offset > cachesize ||
+        offset % GLM_CACHE_ALIGN)
+        return GL_FALSE;
+    return count <= (cachesize - offset) / size;
+}
+
+/* glmString: check that a string at offset ends within the cache */
+static GLboolean
+glmString(const char* base, unsigned long long offset, size_t cachesize)
+{
+    return glmSection(offset, 1, 1, cachesize) &&
+        memchr(base + offset, '\0', cachesize - offset) != NULL;
+}
+
+/* glmValid: check that every section and string a cache points at is
+ * inside it, and that every index in it (of the triangles' vertices,
+ * normals, texture coordinates and facet normals, of the groups'
+ * triangles and materials) is in range, so a corrupt cache (that still
+ * has the right size) is rejected instead of crashing the reader or
+ * the draw and build functions later */
+static GLboolean
+glmValid(const char* base, size_t size)
+{
+    const GLMcacheheader* header;
+    const GLMmaterial* materials;
+    const GLMgroup* groups;
+    const GLMtriangle* triangles;
+    const GLuint* indices;
+    GLuint i, j;
+
+    header = (const GLMcacheheader*)base;
+    if (header->magic != GLM_CACHE_MAGIC ||
+        header->version != GLM_CACHE_VERSION ||
+        header->sizes != glmLayout() || header->size != size)
+        return GL_FALSE;
+
+    /* the 1-based arrays have an unused element 0 */
+    if (!glmSection(header->vertices, header->numvertices + 1ULL,
+            sizeof(GLfloat) * 3, size) ||
+        (header->numnormals && !glmSection(header->normals,
+            header->numnormals + 1ULL, sizeof(GLfloat) * 3, size)) ||
+        (header->numtexcoords && !glmSection(header->texcoords,
+            header->numtexcoords + 1ULL, sizeof(GLfloat) * 2, size)) ||
+        (header->numfacetnorms && !glmSection(header->facetnorms,
+            header->numfacetnorms + 1ULL, sizeof(GLfloat) * 3, size)) ||
+        (header->numtriangles && !glmSection(header->triangles,
+            header->numtriangles, sizeof(GLMtriangle), size)) ||
+        (header->nummaterials && !glmSection(header->materials,
+            header->nummaterials, sizeof(GLMmaterial), size)) ||
+        (header->numgroups && !glmSection(header->groups,
+            header->numgroups, sizeof(GLMgroup), size)) ||
+        (header->mtllibname && !glmString(base, header->mtllibname, size)))
+        return GL_FALSE;
+
+    /* 0 is allowed too, for the attributes a triangle doesn't have */
+    triangles = (const GLMtriangle*)(base + header->triangles);
+    for (i = 0; i < header->numtriangles; i++) {
+        for (j = 0; j < 3; j++)
+            if (triangles[i].vindices[j] > header->numvertices ||
+                triangles[i].nindices[j] > header->numnormals ||
+                triangles[i].tindices[j] > header->numtexcoords)
+                return GL_FALSE;
+        if (triangles[i].findex > header->numfacetnorms)
+            return GL_FALSE;
+    }
+
+    materials = (const GLMmaterial*)(base + header->materials);
+    for (i = 0; i < header->nummaterials; i++)
+        if (!glmString(base, (size_t)materials[i].name, size))
+            return GL_FALSE;
+
+    groups = (const GLMgroup*)(base + header->groups);
+    for (i = 0; i < header->numgroups; i++) {
+        if (!glmString(base, (size_t)groups[i].name, size) ||
+            (groups[i].numtriangles && !glmSection(
+                (size_t)groups[i].triangles, groups[i].numtriangles,
+                sizeof(GLuint), size)) ||
+            (groups[i].material && groups[i].material >= header->nummaterials))
+            return GL_FALSE;
+        indices = (const GLuint*)(base + (size_t)groups[i].triangles);
+        for (j = 0; j < groups[i].numtriangles; j++)
+            if (indices[j] >= header->numtriangles)
+                return GL_FALSE;
+    }
+
+    return GL_TRUE;
+}
+
+
+/* glmWriteCache: Writes the binary cache of a model.
+ *
+ * model - initialized GLMmodel structure
+ */
+GLboolean
+glmWriteCache(GLMmodel* model)
+{
+    GLMcacheheader header;
+    GLMmaterial* materials;
+    GLMgroup* groups;
+    GLMgroup* group;
+    unsigned long long offset;
+    unsigned long long* names;
+    char* filename;
+    char* tmpname;
+    char* mtlname;
+    FILE* file;
+    GLboolean failed;
+    GLuint i;
+
+    assert(model);
+
+    memset(&header, 0, sizeof(header));
+    header.magic = GLM_CACHE_MAGIC;
+    header.version = GLM_CACHE_VERSION;
+    header.sizes = glmLayout();
+    header.numvertices = model->numvertices;
+    header.numnormals = model->numnormals;
+    header.numtexcoords = model->numtexcoords;
+    header.numfacetnorms = model->numfacetnorms;
+    header.numtriangles = model->numtriangles;
+    header.nummaterials = model->nummaterials;
+    header.numgroups = model->numgroups;
+
+    if (!glmStamp(model->pathname, &header.obj))
+        return GL_FALSE;
+    mtlname = glmMtlName(model->pathname, model->mtllibname);
+    if (mtlname) {
+        glmStamp(mtlname, &header.mtl);
+        free(mtlname);
+    }
+
+    /* write to a temporary file and rename it over the cache, so a
+       reader never maps a half written cache */
+    filename = glmCacheName(model->pathname);
+    tmpname = (char*)malloc(strlen(filename) + 5);
+    strcpy(tmpname, filename);
+    strcat(tmpname, ".tmp");
+    file = fopen(tmpname, "wb");
+    if (!file) {
+        free(tmpname);
+        free(filename);
+        return GL_FALSE;
+    }
+
+    /* header first (again at the end, once the offsets are known) */
+    fwrite(&header, sizeof(header), 1, file);
+    offset = sizeof(header);
+
+    header.vertices = glmPut(file, &offset, model->vertices,
+        sizeof(GLfloat) * 3 * (model->numvertices + 1));
+    if (model->numnormals)
+        header.normals = glmPut(file, &offset, model->normals,
+            sizeof(GLfloat) * 3 * (model->numnormals + 1));
+    if (model->numtexcoords)
+        header.texcoords = glmPut(file, &offset, model->texcoords,
+            sizeof(GLfloat) * 2 * (model->numtexcoords + 1));
+    if (model->numfacetnorms)
+        header.facetnorms = glmPut(file, &offset, model->facetnorms,
+            sizeof(GLfloat) * 3 * (model->numfacetnorms + 1));
+    header.triangles = glmPut(file, &offset, model->triangles,
+        sizeof(GLMtriangle) * model->numtriangles);
+
+    /* strings: material names, group names and the library name */
+    names = (unsigned long long*)malloc(sizeof(unsigned long long) *
+        (model->nummaterials + model->numgroups + 1));
+    for (i = 0; i < model->nummaterials; i++)
+        names[i] = glmPut(file, &offset, model->materials[i].name,
+            strlen(model->materials[i].name) + 1);
+    for (i = 0, group = model->groups; group; group = group->next, i++)
+        names[model->nummaterials + i] = glmPut(file, &offset, group->name,
+            strlen(group->name) + 1);
+    if (model->mtllibname)
+        header.mtllibname = glmPut(file, &offset, model->mtllibname,
+            strlen(model->mtllibname) + 1);
+
+    /* group triangle lists, then the groups with offsets for pointers */
+    groups = (GLMgroup*)malloc(sizeof(GLMgroup) * (model->numgroups + 1));
+    for (i = 0, group = model->groups; group; group = group->next, i++) {
+        groups[i] = *group;
+        groups[i].name = (char*)(size_t)names[model->nummaterials + i];
+        groups[i].triangles = (GLuint*)(size_t)glmPut(file, &offset,
+            group->triangles, sizeof(GLuint) * group->numtriangles);
+        groups[i].nummeshlets = 0;
+        groups[i].meshlets = NULL;
+        groups[i].indices = NULL;
+        groups[i].next = NULL;
+    }
+    header.groups = glmPut(file, &offset, groups,
+        sizeof(GLMgroup) * model->numgroups);
+
+    materials = (GLMmaterial*)malloc(sizeof(GLMmaterial) *
+        (model->nummaterials + 1));
+    for (i = 0; i < model->nummaterials; i++) {
+        materials[i] = model->materials[i];
+        materials[i].name = (char*)(size_t)names[i];
+    }
+    header.materials = glmPut(file, &offset, materials,
+        sizeof(GLMmaterial) * model->nummaterials);
+    header.size = offset;
+
+    free(materials);
+    free(groups);
+    free(names);
+
+    /* a short write anywhere (a full disk, say) must not be renamed
+       into place as a good cache; rewind() clears the error flag, so
+       look at it first */
+    failed = ferror(file) != 0;
+    rewind(file);
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+        failed = GL_TRUE;
+    if (fclose(file) != 0 || failed || rename(tmpname, filename) != 0) {
+        remove(tmpname);
+        free(tmpname);
+        free(filename);
+        return GL_FALSE;
+    }
+
+    free(tmpname);
+    free(filename);
+    return GL_TRUE;
+}
+
+/* glmReadCache: Reads a model from the binary cache of an OBJ file.
+ * Returns NULL if there is no cache or it is stale.
+ *
+ * filename - name of the Wavefront .OBJ file (not of the cache)
+ */
+GLMmodel*
+glmReadCache(char* filename)
+{
+    GLMcacheheader* header;
+    GLMmodel* model;
+    GLMgroup* groups;
+    char* cachename;
+    char* mtlname;
+    char* base;
+    size_t size;
+    GLMstamp obj, mtl;
+    GLuint i;
+    int fd;
+    struct stat st;
+
+    cachename = glmCacheName(filename);
+    fd = open(cachename, O_RDONLY);
+    free(cachename);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(GLMcacheheader)) {
+        close(fd);
+        return NULL;
+    }
+    size = st.st_size;
+
+#if defined(_WIN32)
+    base = (char*)malloc(size);
+    if (read(fd, base, size) != (int)size) {
+        free(base);
+        base = NULL;
+    }
+#else
+    base = (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (base == (char*)MAP_FAILED)
+        base = NULL;
+#endif
+    close(fd);
+    if (!base)
+        return NULL;
+
+    model = glmNewModel(filename);
+    model->cache = base;
+    model->cachesize = size;
+
+    header = (GLMcacheheader*)base;
+    if (!glmValid(base, size)) {
+        glmDelete(model);
+        return NULL;
+    }
+    obj = header->obj;
+    mtl = header->mtl;
+    if (!glmFresh(filename, &header->obj)) {
+        glmDelete(model);
+        return NULL;
+    }
+    mtlname = glmMtlName(filename,
+        header->mtllibname ? base + header->mtllibname : NULL);
+    if (mtlname) {
+        if (!glmFresh(mtlname, &header->mtl)) {
+            free(mtlname);
+            glmDelete(model);
+            return NULL;
+        }
+        free(mtlname);
+    }
+    if (memcmp(&obj, &header->obj, sizeof(obj)) ||
+        memcmp(&mtl, &header->mtl, sizeof(mtl)))
+        glmRestamp(filename, header);
+
+    /* point the model into the mapping */
+    if (header->mtllibname)
+        model->mtllibname = glmStrdup(model, base + header->mtllibname);
+    model->numvertices = header->numvertices;
+    model->vertices = (GLfloat*)(base + header->vertices);
+    model->numnormals = header->numnormals;
+    model->normals = header->numnormals ? (GLfloat*)(base + header->normals) : NULL;
+    model->numtexcoords = header->numtexcoords;
+    model->texcoords = header->numtexcoords ?
+        (GLfloat*)(base + header->texcoords) : NULL;
+    model->numfacetnorms = header->numfacetnorms;
+    model->facetnorms = header->numfacetnorms ?
+        (GLfloat*)(base + header->facetnorms) : NULL;
+    model->numtriangles = header->numtriangles;
+    model->triangles = header->numtriangles ?
+        (GLMtriangle*)(base + header->triangles) : NULL;
+    model->nummaterials = header->nummaterials;
+    model->materials = header->nummaterials ?
+        (GLMmaterial*)(base + header->materials) : NULL;
+    model->numgroups = header->numgroups;
+
+    /* relocate the pointers stored as offsets */
+    for (i = 0; i < model->nummaterials; i++)
+        model->materials[i].name = base + (size_t)model->materials[i].name;
+    groups = (GLMgroup*)(base + header->groups);
+    for (i = 0; i < model->numgroups; i++) {
+        groups[i].name = base + (size_t)groups[i].name;
+        groups[i].triangles = groups[i].numtriangles ?
+            (GLuint*)(base + (size_t)groups[i].triangles) : NULL;
+        groups[i].next = i + 1 < model->numgroups ? &groups[i + 1] : NULL;
+        groups[i].nummeshlets = 0;      /* never cached, whatever is there */
+        groups[i].meshlets = NULL;
+        groups[i].indices = NULL;
+    }
+    model->groups = model->numgroups ? groups : NULL;
+
+    return model;
+}
+
+/* glmCached: returns GL_TRUE if p points into the cache mapping of the
+ * model (and so must not be free'd).
+ */
+GLboolean
+glmCached(GLMmodel* model, const GLvoid* p)
+{
+    return model->cache && (const char*)p >= (const char*)model->cache &&
+        (const char*)p < (const char*)model->cache + model->cachesize;
+}
+
+/* glmReleaseCache: unmap the cache backing a model */
+GLvoid
+glmReleaseCache(GLMmodel* model)
+{
+    if (!model->cache)
+        return;
+#if defined(_WIN32)
+    free(model->cache);
+#else
+    munmap(model->cache, model->cachesize);
+#endif
+    model->cache = NULL;
+    model->cachesize = 0;
+}
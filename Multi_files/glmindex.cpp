@@ -0,0 +1,217 @@
+/*
+      glmindex.cpp
+
+      Single index vertex arrays for the GLM library.
+
+      A Wavefront OBJ triangle indexes its vertex, normal and texture
+      coordinate separately, which OpenGL vertex arrays can't do.
+      glmBuildIndexed() gives every distinct (vertex, normal, texture
+      coordinate) triplet used by the triangles one interleaved vertex,
+      found through a hash table, and rewrites the triangles of each
+      group as an index array into those vertices, in draw order, with
+      16 bit indices when they fit.  The arrays can be handed straight
+      to glInterleavedArrays() and glDrawElements().
+
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "glm.h"
+#include "glmint.h"
+
+
+#define T(x) (model->triangles[(x)])
+
+#define GLM_INDEX_NONE ((GLuint)-1)     /* empty hash table slot */
+
+
+/* GLMindex: hash table of the triplets seen so far.  slots hold the
+ * interleaved vertex of each triplet, keys its vertex, normal and
+ * texture coordinate indices.
+ */
+typedef struct _GLMindex {
+  GLuint  mask;                 /* number of slots - 1 */
+  GLuint* slots;                /* interleaved vertex (or none) */
+  GLuint* keys;                 /* triplet of each interleaved vertex */
+  GLuint  numvertices;          /* interleaved vertices so far */
+} GLMindex;
+
+/* glmIndexHash: the slot a triplet hashes to */
+static GLuint
+glmIndexHash(GLMindex* index, const GLuint* key)
+{
+    static const unsigned long long primes[3] = {
+        0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull
+    };
+    unsigned long long hash = 0;
+    GLuint j;
+
+    for (j = 0; j < 3; j++)
+        hash ^= key[j] * primes[j];
+    return (GLuint)(hash ^ (hash >> 29) ^ (hash >> 47)) & index->mask;
+}
+
+/* glmIndexFind: the interleaved vertex of a triplet, a new one if it
+ * wasn't seen before */
+static GLuint
+glmIndexFind(GLMindex* index, const GLuint* key)
+{
+    GLuint slot, v;
+
+    for (slot = glmIndexHash(index, key); ; slot = (slot + 1) & index->mask) {
+        v = index->slots[slot];
+        if (v == GLM_INDEX_NONE)
+            break;
+        if (index->keys[3 * v] == key[0] && index->keys[3 * v + 1] == key[1] &&
+            index->keys[3 * v + 2] == key[2])
+            return v;
+    }
+
+    v = index->numvertices++;
+    index->slots[slot] = v;
+    memcpy(&index->keys[3 * v], key, sizeof(GLuint) * 3);
+    return v;
+}
+
+/* glmBuildIndexed: Builds the interleaved vertices and group index
+ * arrays of a model and of its levels of detail.  Returns how many
+ * interleaved vertices there are per vertex used.
+ *
+ * model - initialized GLMmodel structure (not still streaming)
+ * mode  - attributes to interleave with the vertices
+ *             GLM_NONE     -  only vertices
+ *             GLM_FLAT     -  facet normals
+ *             GLM_SMOOTH   -  vertex normals
+ *             GLM_TEXTURE  -  texture coords
+ */
+GLfloat
+glmBuildIndexed(GLMmodel* model, GLuint mode)
+{
+    GLMindex index;
+    GLMgroup* group;
+    GLMtriangle* triangle;
+    GLfloat* vertex;
+    GLuint* indices;
+    GLuint* used;
+    GLuint numcorners, numused, size, stride, i, j, k, v;
+    GLuint key[3];
+
+    assert(model);
+    assert(!model->stream);
+
+    glmVertices(model);
+    if (mode & GLM_FLAT && !model->facetnorms)
+        mode &= ~GLM_FLAT;
+    if (mode & GLM_SMOOTH && !model->normals)
+        mode &= ~GLM_SMOOTH;
+    if (mode & GLM_TEXTURE && !model->texcoords)
+        mode &= ~GLM_TEXTURE;
+    if (mode & GLM_FLAT && mode & GLM_SMOOTH)
+        mode &= ~GLM_FLAT;
+    mode &= GLM_FLAT | GLM_SMOOTH | GLM_TEXTURE;
+
+    /* the hash table is at most half full */
+    numcorners = 0;
+    for (group = model->groups; group; group = group->next)
+        numcorners += 3 * group->numtriangles;
+    for (size = 1; size < 2 * numcorners; size <<= 1)
+        ;
+    index.mask = size - 1;
+    index.slots = (GLuint*)malloc(sizeof(GLuint) * size);
+    memset(index.slots, 0xff, sizeof(GLuint) * size);
+    index.keys = (GLuint*)malloc(sizeof(GLuint) * 3 * (numcorners + 1));
+    index.numvertices = 0;
+    indices = (GLuint*)malloc(sizeof(GLuint) * (numcorners + 1));
+
+    /* number the triplets in order of first use, group by group */
+    k = 0;
+    for (group = model->groups; group; group = group->next) {
+        for (i = 0; i < group->numtriangles; i++) {
+            triangle = &T(group->triangles[i]);
+            for (j = 0; j < 3; j++) {
+                key[0] = triangle->vindices[j];
+                key[1] = mode & GLM_FLAT ? triangle->findex :
+                    mode & GLM_SMOOTH ? triangle->nindices[j] : 0;
+                key[2] = mode & GLM_TEXTURE ? triangle->tindices[j] : 0;
+                indices[k++] = glmIndexFind(&index, key);
+            }
+        }
+    }
+
+    /* the interleaved vertices, laid out the way glInterleavedArrays()
+       takes them: texture coordinate, normal, then vertex */
+    stride = 3;
+    if (mode & (GLM_FLAT | GLM_SMOOTH))
+        stride += 3;
+    if (mode & GLM_TEXTURE)
+        stride += 2;
+    glmFree(model, model->interleaved);
+    model->numinterleaved = index.numvertices;
+    model->interleaved = (GLfloat*)malloc(sizeof(GLfloat) * stride *
+        (index.numvertices + 1));
+    for (v = 0; v < index.numvertices; v++) {
+        vertex = &model->interleaved[stride * v];
+        if (mode & GLM_TEXTURE) {
+            memcpy(vertex, &model->texcoords[2 * index.keys[3 * v + 2]],
+                sizeof(GLfloat) * 2);
+            vertex += 2;
+        }
+        if (mode & GLM_FLAT) {
+            memcpy(vertex, &model->facetnorms[3 * index.keys[3 * v + 1]],
+                sizeof(GLfloat) * 3);
+            vertex += 3;
+        } else if (mode & GLM_SMOOTH) {
+            memcpy(vertex, &model->normals[3 * index.keys[3 * v + 1]],
+                sizeof(GLfloat) * 3);
+            vertex += 3;
+        }
+        memcpy(vertex, &model->vertices[3 * index.keys[3 * v]],
+            sizeof(GLfloat) * 3);
+    }
+    model->interleavedformat = mode & GLM_TEXTURE ?
+        (mode & (GLM_FLAT | GLM_SMOOTH) ? GL_T2F_N3F_V3F : GL_T2F_V3F) :
+        (mode & (GLM_FLAT | GLM_SMOOTH) ? GL_N3F_V3F : GL_V3F);
+    model->interleavedmode = mode;
+
+    /* the index arrays, 16 bit if every vertex fits */
+    model->indextype = index.numvertices <= 0x10000 ?
+        GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    k = 0;
+    for (group = model->groups; group; group = group->next) {
+        glmFree(model, group->indices);
+        if (model->indextype == GL_UNSIGNED_SHORT) {
+            group->indices = malloc(sizeof(GLushort) *
+                (3 * group->numtriangles + 1));
+            for (i = 0; i < 3 * group->numtriangles; i++)
+                ((GLushort*)group->indices)[i] = (GLushort)indices[k++];
+        } else {
+            group->indices = malloc(sizeof(GLuint) *
+                (3 * group->numtriangles + 1));
+            memcpy(group->indices, &indices[k],
+                sizeof(GLuint) * 3 * group->numtriangles);
+            k += 3 * group->numtriangles;
+        }
+    }
+    model->indexedversion = model->version;
+
+    /* how many vertices are used, for the duplication ratio */
+    used = (GLuint*)calloc(model->numvertices + 1, sizeof(GLuint));
+    numused = 0;
+    for (v = 0; v < index.numvertices; v++)
+        if (!used[index.keys[3 * v]]++)
+            numused++;
+
+    free(used);
+    free(indices);
+    free(index.keys);
+    free(index.slots);
+
+    if (model->lod)
+        glmBuildIndexed(model->lod, mode);
+
+    return numused ? (GLfloat)index.numvertices / numused : 1.0;
+}
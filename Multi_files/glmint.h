@@ -0,0 +1,385 @@
+/*
+      glmint.h
+
+      Internal declarations shared between the glm*.cpp files.  These
+      are not part of the public GLM interface in glm.h.
+
+ */
+
+#ifndef GLMINT_H_INCLUDED
+#define GLMINT_H_INCLUDED
+
+#include <stddef.h>
+#include "glm.h"
+
+
+/* GLMfile: Structure that holds the contents of a whole file, either
+ * memory mapped or read into a buffer.  The data is always followed
+ * by a '\0' so it can be scanned without checking the end pointer on
+ * every character, and by at least GLM_NUM_PADDING readable bytes for
+ * the parsers in glmnum.h.
+ */
+typedef struct _GLMfile {
+  char*     data;               /* contents of the file */
+  size_t    size;               /* size of the file in bytes */
+  GLboolean mapped;             /* data is a mapping (not a buffer) */
+} GLMfile;
+
+/* GLMparser: Structure that holds the state of a Wavefront OBJ parse
+ * in progress.  The model arrays grow as records are parsed.
+ */
+typedef struct _GLMparser {
+  GLMmodel* model;              /* model being filled in */
+  GLMgroup* group;              /* current group */
+  GLuint    material;           /* current material */
+  struct _GLMchunk* chunk;      /* chunk being parsed (threaded reads) */
+} GLMparser;
+
+/* GLMarena: Allocator that owns all the storage of a model, in a few
+ * large cache aligned blocks (see glmarena.cpp).
+ */
+typedef struct _GLMarena GLMarena;
+
+#define GLM_ARENA_ALIGN 64      /* alignment of every arena allocation */
+
+/* GLMstream: Structure that holds the state of a progressive load
+ * (see glmStreamOBJ()).  The triangles before numready have facet
+ * normals and only use vertices that have been parsed, so they can be
+ * drawn while the rest of the file is still being read.
+ */
+typedef struct _GLMstream {
+  GLMfile     file;             /* the OBJ file being read */
+  GLMparser   parser;           /* parse state between steps */
+  const char* next;             /* first character not parsed yet */
+  GLuint      numready;         /* triangles that can be drawn */
+  GLuint      numbounded;       /* vertices included in min/max */
+  GLuint      maxfacetnorms;    /* facet normals allocated */
+  GLfloat     min[3];           /* running bounds of the vertices */
+  GLfloat     max[3];
+} GLMstream;
+
+/* GLMcull: Structure that holds what glmDraw() needs to cull meshlets
+ * with the current OpenGL matrices, in model space.
+ */
+typedef struct _GLMcull {
+  GLfloat   planes[6][4];       /* view frustum, normals pointing in */
+  GLfloat   eye[3];             /* eye (direction of view if parallel) */
+  GLboolean perspective;        /* perspective (not parallel) projection */
+  GLboolean backfaces;          /* eye is known, so cones can be tested */
+} GLMcull;
+
+
+/* glmMapFile: Maps a whole file into memory.  Returns GL_FALSE if the
+ * file can't be opened.
+ *
+ * file     - GLMfile structure to fill in
+ * filename - name of the file to map
+ */
+GLboolean
+glmMapFile(GLMfile* file, const char* filename);
+
+/* glmUnmapFile: Releases a file mapped with glmMapFile().
+ *
+ * file - mapped GLMfile structure
+ */
+GLvoid
+glmUnmapFile(GLMfile* file);
+
+/* glmParserInit: Prepares a parser that fills in the given (empty)
+ * model, starting in the "default" group.
+ *
+ * parser - GLMparser structure to initialize
+ * model  - freshly allocated GLMmodel structure
+ */
+GLvoid
+glmParserInit(GLMparser* parser, GLMmodel* model);
+
+/* glmParseOBJ: Parses the Wavefront OBJ records between begin and
+ * end into the parser's model.  Returns a pointer just past the last
+ * line parsed.
+ *
+ * parser - initialized GLMparser structure
+ * begin  - first character of the first line to parse
+ * end    - end of the data ('\0' terminated)
+ */
+const char*
+glmParseOBJ(GLMparser* parser, const char* begin, const char* end);
+
+/* glmParseOBJThreaded: Parses a whole Wavefront OBJ file into the
+ * parser's model, split into newline aligned chunks that are parsed
+ * by separate threads and then merged.  Produces exactly the same
+ * model as glmParseOBJ().
+ *
+ * parser     - initialized GLMparser structure
+ * begin      - first character of the data
+ * end        - end of the data ('\0' terminated)
+ * numthreads - number of threads to use (0 for one per core)
+ */
+GLvoid
+glmParseOBJThreaded(GLMparser* parser, const char* begin, const char* end,
+    GLuint numthreads);
+
+/* glmParserFinish: Trims the arrays of the parser's model down to
+ * their final size.
+ *
+ * parser - GLMparser structure that is done parsing
+ */
+GLvoid
+glmParserFinish(GLMparser* parser);
+
+/* glmNewModel: Allocates an empty model (with its arena) for the given
+ * path.
+ *
+ * filename - name of the file the model comes from
+ */
+GLMmodel*
+glmNewModel(char* filename);
+
+char*
+glmDirName(char* path);
+
+GLMgroup*
+glmFindGroup(GLMmodel* model, char* name);
+
+GLMgroup*
+glmAddGroup(GLMmodel* model, char* name);
+
+GLuint
+glmFindMaterial(GLMmodel* model, char* name);
+
+GLvoid
+glmReadMTL(GLMmodel* model, char* name);
+
+/* glmCached: Returns GL_TRUE if p points into the cache mapping that
+ * backs the model (see glmReadCache()), and so must not be free'd.
+ *
+ * model - GLMmodel structure
+ * p     - pointer to check
+ */
+GLboolean
+glmCached(GLMmodel* model, const GLvoid* p);
+
+/* glmReleaseCache: Unmaps the cache backing a model, if any.
+ *
+ * model - GLMmodel structure
+ */
+GLvoid
+glmReleaseCache(GLMmodel* model);
+
+/* glmArenaCreate: Creates an empty arena (see glmarena.cpp).
+ */
+GLMarena*
+glmArenaCreate(GLvoid);
+
+/* glmArenaAlloc: Allocates size bytes, aligned to a cache line, from
+ * an arena.
+ *
+ * arena - arena to allocate from
+ * size  - number of bytes
+ */
+GLvoid*
+glmArenaAlloc(GLMarena* arena, size_t size);
+
+/* glmArenaStrdup: strdup() into an arena.
+ *
+ * arena - arena to allocate from
+ * s     - string to copy
+ */
+char*
+glmArenaStrdup(GLMarena* arena, const char* s);
+
+/* glmArenaOwns: Returns GL_TRUE if p was allocated from the arena.
+ *
+ * arena - arena to check (may be NULL)
+ * p     - pointer to check
+ */
+GLboolean
+glmArenaOwns(GLMarena* arena, const GLvoid* p);
+
+/* glmArenaRelease: Gives memory back to an arena (it is only reused
+ * if it was the most recent allocation).
+ *
+ * arena - arena p was allocated from
+ * p     - pointer returned by glmArenaAlloc()
+ */
+GLvoid
+glmArenaRelease(GLMarena* arena, GLvoid* p);
+
+/* glmArenaReset: Makes all of an arena free again, keeping only its
+ * largest block.
+ *
+ * arena - arena to reset
+ */
+GLvoid
+glmArenaReset(GLMarena* arena);
+
+/* glmArenaDelete: Releases an arena and everything allocated from it.
+ *
+ * arena - arena to delete (may be NULL)
+ */
+GLvoid
+glmArenaDelete(GLMarena* arena);
+
+/* glmAlloc: malloc() for memory owned by a model.  The memory comes
+ * from the model's arena and is released by glmDelete(), so it is for
+ * what a model is loaded with; arrays that are computed again later
+ * should be malloc()'d instead.
+ *
+ * model - GLMmodel structure the memory belongs to
+ * size  - number of bytes
+ */
+GLvoid*
+glmAlloc(GLMmodel* model, size_t size);
+
+/* glmStrdup: strdup() for strings owned by a model.
+ *
+ * model - GLMmodel structure the string belongs to
+ * s     - string to copy
+ */
+char*
+glmStrdup(GLMmodel* model, const char* s);
+
+/* glmFree: free() for memory owned by a model.  Does nothing for
+ * NULL or for arrays that live in the model's cache mapping, hands
+ * arena memory back to the arena and free()s anything else.
+ *
+ * model - GLMmodel structure the memory belongs to
+ * p     - pointer to release
+ */
+GLvoid
+glmFree(GLMmodel* model, GLvoid* p);
+
+/* glmFacetNormalsRange: Computes the facet normals of the triangles
+ * in [begin, end) into facetnorms[3 * (i+1)] and points their findex
+ * at them, with the widest SIMD kernel the CPU supports (see
+ * glmsimd.cpp).
+ *
+ * model - GLMmodel structure with room for the facet normals
+ * begin - first triangle
+ * end   - one past the last triangle
+ */
+GLvoid
+glmFacetNormalsRange(GLMmodel* model, GLuint begin, GLuint end);
+
+/* glmBoundsRange: Grows a bounding box to take in the vertices in
+ * [begin, end) (see glmsimd.cpp).
+ *
+ * vertices - packed xyz vertex array
+ * begin    - first vertex
+ * end      - one past the last vertex
+ * min      - minimum x, y and z so far (updated)
+ * max      - maximum x, y and z so far (updated)
+ */
+GLvoid
+glmBoundsRange(const GLfloat* vertices, GLuint begin, GLuint end,
+               GLfloat* min, GLfloat* max);
+
+/* glmTransformRange: Translates and scales the vertices in [begin,
+ * end), v = (v - translate) * scale, and in the same sweep finds their
+ * largest squared distance from a center (see glmsimd.cpp).
+ *
+ * vertices  - packed xyz vertex array
+ * begin     - first vertex
+ * end       - one past the last vertex
+ * translate - translation (NULL to leave the vertices alone)
+ * scale     - scalefactor
+ * center    - center to measure from (NULL not to measure)
+ * radius2   - largest squared distance so far (updated)
+ */
+GLvoid
+glmTransformRange(GLfloat* vertices, GLuint begin, GLuint end,
+                  const GLfloat* translate, GLfloat scale,
+                  const GLfloat* center, GLfloat* radius2);
+
+/* glmBoundsSoA: glmBoundsRange() for the separate x, y and z arrays
+ * of the GLM_SOA layout (see glmsimd.cpp).
+ *
+ * soa   - x, y and z arrays (aligned to GLM_ARENA_ALIGN, from index 0)
+ * begin - first vertex (a multiple of 8)
+ * end   - one past the last vertex
+ * min   - minimum x, y and z so far (updated)
+ * max   - maximum x, y and z so far (updated)
+ */
+GLvoid
+glmBoundsSoA(GLfloat* const* soa, GLuint begin, GLuint end,
+             GLfloat* min, GLfloat* max);
+
+/* glmTransformSoA: glmTransformRange() for the separate x, y and z
+ * arrays of the GLM_SOA layout (see glmsimd.cpp).
+ *
+ * soa       - x, y and z arrays (aligned to GLM_ARENA_ALIGN, from index 0)
+ * begin     - first vertex (a multiple of 8)
+ * end       - one past the last vertex
+ * translate - translation (NULL to leave the vertices alone)
+ * scale     - scalefactor
+ * center    - center to measure from (NULL not to measure)
+ * radius2   - largest squared distance so far (updated)
+ */
+GLvoid
+glmTransformSoA(GLfloat* const* soa, GLuint begin, GLuint end,
+                const GLfloat* translate, GLfloat scale,
+                const GLfloat* center, GLfloat* radius2);
+
+/* glmCheckMode: Returns a draw or output mode without the attributes
+ * the model doesn't have, warning about each one the first time it
+ * is asked for on the model (see glm.cpp).
+ *
+ * model  - initialized GLMmodel structure
+ * mode   - a bitwise OR of GLM_* values
+ * caller - name of the function to warn as
+ * output - GL_TRUE to word the warnings for output (glmWriteOBJ())
+ */
+GLuint
+glmCheckMode(GLMmodel* model, GLuint mode, const char* caller,
+             GLboolean output);
+
+/* glmCullBegin: Sets up the culling of the meshlets of a model against
+ * the current OpenGL matrices (see glmmeshlet.cpp).  Returns GL_FALSE
+ * if the model has no up to date meshlets.
+ *
+ * model - initialized GLMmodel structure
+ * cull  - GLMcull structure to fill in
+ */
+GLboolean
+glmCullBegin(GLMmodel* model, GLMcull* cull);
+
+/* glmCullMeshlet: Returns GL_TRUE if a meshlet is outside the view
+ * frustum or all its triangles face away from the eye.
+ *
+ * cull    - GLMcull structure set up by glmCullBegin()
+ * meshlet - meshlet to test
+ */
+GLboolean
+glmCullMeshlet(const GLMcull* cull, const GLMmeshlet* meshlet);
+
+/* glmPixelsPerUnit: Returns how many pixels a unit covers, with the
+ * current OpenGL matrices and viewport, at a point (in object
+ * coordinates), or 0.0 if the eye is in (or near) the sphere around it
+ * (see glmlod.cpp).
+ *
+ * center - point
+ * radius - radius of the sphere around it
+ */
+GLfloat
+glmPixelsPerUnit(const GLfloat* center, GLfloat radius);
+
+/* glmBindMesh: Makes the buffers of a mesh the vertex and index arrays,
+ * or goes back to no buffers and arrays for NULL (see glmmesh.cpp).
+ *
+ * mesh - mesh made by glmNewMesh(), or NULL
+ */
+GLvoid
+glmBindMesh(GLMmesh* mesh);
+
+/* glmDrawRange: Draws one range (group) of a mesh bound by
+ * glmBindMesh(), without the meshlets cull rejects.
+ *
+ * mesh  - bound mesh
+ * range - index of the range
+ * cull  - culling set up by glmCullBegin() for the mesh's model (or
+ *         NULL)
+ */
+GLvoid
+glmDrawRange(GLMmesh* mesh, GLuint range, const GLMcull* cull);
+
+#endif
@@ -0,0 +1,152 @@
+/*
+      glmlist.cpp
+
+      Display list cache for the GLM library.
+
+      glmList() compiles a model into a display list, but the list has
+      to be kept and thrown away by hand when the vertices change.  A
+      GLMlistcache does that: it keys each list by the model, the mode
+      and the model version it was compiled from, compiles a list the
+      first time it is asked for (or again once the version moves on),
+      and deletes the least recently used list when it is full.  It
+      counts hits, misses, evictions and the time spent compiling.
+
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <chrono>
+#include "glm.h"
+#include "glmint.h"
+
+
+/* glmNewListCache: Makes an empty cache of display lists.
+ *
+ * maxlists - most lists to keep (e.g. GLM_LIST_CACHE)
+ */
+GLMlistcache*
+glmNewListCache(GLuint maxlists)
+{
+    GLMlistcache* cache;
+
+    assert(maxlists);
+
+    cache = (GLMlistcache*)malloc(sizeof(GLMlistcache));
+    cache->maxlists = maxlists;
+    cache->numlists = 0;
+    cache->lists = (GLMlist*)malloc(sizeof(GLMlist) * maxlists);
+    cache->clock = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    cache->compiletime = 0.0;
+
+    return cache;
+}
+
+/* glmCallList: Renders a model with the cached display list for it
+ * and a mode, compiling the list if it isn't there or is out of date.
+ *
+ * cache - list cache made by glmNewListCache()
+ * model - initialized GLMmodel structure (not still streaming)
+ * mode  - a bitwise OR of values describing what is to be rendered
+ */
+GLvoid
+glmCallList(GLMlistcache* cache, GLMmodel* model, GLuint mode)
+{
+    GLMlist* entry;
+    GLuint i;
+    std::chrono::steady_clock::time_point start;
+
+    assert(cache);
+    assert(model);
+    assert(!model->stream);
+
+    /* a list is drawn from every viewpoint, so it never culls */
+    mode &= ~GLM_CULL;
+    cache->clock++;
+
+    entry = NULL;
+    for (i = 0; i < cache->numlists; i++) {
+        if (cache->lists[i].model == model && cache->lists[i].mode == mode) {
+            entry = &cache->lists[i];
+            break;
+        }
+    }
+
+    if (entry && entry->version == model->version) {
+        cache->hits++;
+    } else {
+        cache->misses++;
+        if (entry) {
+            /* the vertices changed, compile the list again */
+            glDeleteLists(entry->list, 1);
+        } else if (cache->numlists < cache->maxlists) {
+            entry = &cache->lists[cache->numlists++];
+        } else {
+            /* make room by deleting the least recently used list */
+            entry = &cache->lists[0];
+            for (i = 1; i < cache->numlists; i++)
+                if (cache->lists[i].used < entry->used)
+                    entry = &cache->lists[i];
+            glDeleteLists(entry->list, 1);
+            cache->evictions++;
+        }
+
+        start = std::chrono::steady_clock::now();
+        entry->model = model;
+        entry->mode = mode;
+        entry->version = model->version;
+        entry->list = glmList(model, mode);
+        cache->compiletime += std::chrono::duration<GLdouble>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+    entry->used = cache->clock;
+
+    /* the list sets the color material, materials and colors behind the
+       state cache's back */
+    glCallList(entry->list);
+    glmForgetState(GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_CURRENT_BIT);
+}
+
+/* glmForgetLists: Deletes the lists a cache has for a model.
+ *
+ * cache - list cache made by glmNewListCache()
+ * model - model whose lists to delete
+ */
+GLvoid
+glmForgetLists(GLMlistcache* cache, GLMmodel* model)
+{
+    GLuint i;
+
+    assert(cache);
+
+    for (i = 0; i < cache->numlists; ) {
+        if (cache->lists[i].model == model) {
+            glDeleteLists(cache->lists[i].list, 1);
+            cache->lists[i] = cache->lists[--cache->numlists];
+        } else {
+            i++;
+        }
+    }
+}
+
+/* glmDeleteListCache: Deletes a list cache and its display lists.
+ *
+ * cache - list cache made by glmNewListCache()
+ */
+GLvoid
+glmDeleteListCache(GLMlistcache* cache)
+{
+    GLuint i;
+
+    assert(cache);
+
+    for (i = 0; i < cache->numlists; i++)
+        glDeleteLists(cache->lists[i].list, 1);
+    free(cache->lists);
+    free(cache);
+}
@@ -0,0 +1,826 @@
+/*
+      glmlod.cpp
+
+      Mesh simplification and levels of detail for the GLM library.
+
+      glmBuildLODs() makes a chain of ever coarser copies of a model by
+      quadric error edge collapses (Garland and Heckbert, "Surface
+      Simplification Using Quadric Error Metrics", 1997).  Collapses
+      are half edge collapses, u onto its neighbour v, so no new
+      vertices are made and the normals and texture coordinates of v
+      carry over to the triangles of u.  To keep that valid, and to keep
+      the materials where they were:
+
+        - vertices on an attribute seam (whose corners don't all share
+          one normal and one texture coordinate), on the boundary between
+          two groups or on a non-manifold edge never move;
+        - vertices on a border only move along the border, which is
+          also held in place by extra quadric planes;
+        - a collapse may not flip a triangle, pinch the surface (the
+          link condition), or turn a normal much further than the
+          position error alone would say.
+
+      Collapses are done in passes: every movable vertex picks its
+      cheapest collapse, the candidates are sorted, and the cheapest
+      ones that don't touch each other are done (as in meshoptimizer's
+      simplifier).
+
+      glmLOD() then picks the level to draw from the current OpenGL
+      matrices, by how many pixels the simplification error of each
+      level would cover on the screen.
+
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "glm.h"
+#include "glmint.h"
+
+
+#define T(x) (model->triangles[(x)])
+
+#define GLM_LOD_BORDER_WEIGHT 10.0      /* weight of the border planes */
+#define GLM_LOD_MIN_GAIN      0.9       /* a level must have fewer triangles */
+#define GLM_LOD_PASS_BOUND    1.5       /* cost a pass may go past its goal */
+
+/* kinds of vertices */
+#define GLM_LOD_FREE   0                /* interior of a manifold patch */
+#define GLM_LOD_BORDER 1                /* on a border edge */
+#define GLM_LOD_LOCKED 2                /* never moves */
+#define GLM_LOD_UNUSED 3                /* in no triangle */
+
+
+/* GLMquadric: symmetric 4x4 error quadric of a vertex, the sum of
+ * squared distances to a set of (weighted) planes.
+ */
+typedef struct _GLMquadric {
+  double a2, b2, c2, d2;        /* diagonal */
+  double ab, ac, ad, bc, bd, cd; /* upper triangle */
+  double w;                     /* total weight of the planes */
+} GLMquadric;
+
+/* GLMcollapse: a candidate collapse of vertex u onto vertex v */
+typedef struct _GLMcollapse {
+  GLuint u;
+  GLuint v;
+  double cost;                  /* quadric error of u at v, per weight */
+} GLMcollapse;
+
+/* GLMsimplify: state of a simplification in progress.  The triangles
+ * are a working copy of the model's, with their original numbering;
+ * collapsed ones are flagged as removed.
+ */
+typedef struct _GLMsimplify {
+  GLMmodel*    model;           /* model being simplified */
+  GLMtriangle* triangles;       /* working copy of the triangles */
+  GLMgroup**   groups;          /* group of each triangle */
+  GLubyte*     removed;         /* triangle collapsed away */
+  GLuint       numtriangles;    /* triangles left */
+  GLMquadric*  quadrics;        /* quadric of each vertex */
+  GLubyte*     kinds;           /* GLM_LOD_* kind of each vertex */
+  GLubyte*     locked;          /* vertex touched in this pass */
+  GLuint*      offsets;         /* first entry of each vertex in adjacency */
+  GLuint*      adjacency;       /* triangles around each vertex */
+  GLfloat      error;           /* largest collapse error so far */
+} GLMsimplify;
+
+
+/* glmQuadricPlane: add the plane n.x + d = 0 (n of unit length) with
+ * the given weight to a quadric */
+static GLvoid
+glmQuadricPlane(GLMquadric* q, const double* n, double d, double weight)
+{
+    q->a2 += weight * n[0] * n[0];
+    q->b2 += weight * n[1] * n[1];
+    q->c2 += weight * n[2] * n[2];
+    q->d2 += weight * d * d;
+    q->ab += weight * n[0] * n[1];
+    q->ac += weight * n[0] * n[2];
+    q->ad += weight * n[0] * d;
+    q->bc += weight * n[1] * n[2];
+    q->bd += weight * n[1] * d;
+    q->cd += weight * n[2] * d;
+    q->w  += weight;
+}
+
+/* glmQuadricAdd: add quadric s to quadric q */
+static GLvoid
+glmQuadricAdd(GLMquadric* q, const GLMquadric* s)
+{
+    q->a2 += s->a2; q->b2 += s->b2; q->c2 += s->c2; q->d2 += s->d2;
+    q->ab += s->ab; q->ac += s->ac; q->ad += s->ad;
+    q->bc += s->bc; q->bd += s->bd; q->cd += s->cd;
+    q->w  += s->w;
+}
+
+/* glmQuadricError: the error of a quadric at a point */
+static double
+glmQuadricError(const GLMquadric* q, const GLfloat* p)
+{
+    double x = p[0], y = p[1], z = p[2];
+    double e;
+
+    e = q->a2*x*x + q->b2*y*y + q->c2*z*z + q->d2 +
+        2.0 * (q->ab*x*y + q->ac*x*z + q->ad*x + q->bc*y*z + q->bd*y + q->cd*z);
+    return e > 0.0 ? e : 0.0;
+}
+
+/* glmLODNormal: the (area weighted) normal of a triangle, with vertex
+ * u moved to p (pass u = 0 for the triangle as it is) */
+static GLvoid
+glmLODNormal(GLMmodel* model, const GLMtriangle* triangle, GLuint u,
+             const GLfloat* p, double* n)
+{
+    const GLfloat* v[3];
+    double e1[3], e2[3];
+    GLuint j;
+
+    for (j = 0; j < 3; j++)
+        v[j] = triangle->vindices[j] == u ? p :
+            &model->vertices[3 * triangle->vindices[j]];
+    for (j = 0; j < 3; j++) {
+        e1[j] = v[1][j] - v[0][j];
+        e2[j] = v[2][j] - v[0][j];
+    }
+    n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+    n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+    n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+}
+
+/* glmLODAdjacency: (re)build the lists of the triangles left around
+ * each vertex */
+static GLvoid
+glmLODAdjacency(GLMsimplify* s)
+{
+    GLMmodel* model = s->model;
+    GLuint i, j, v;
+
+    memset(s->offsets, 0, sizeof(GLuint) * (model->numvertices + 2));
+    for (i = 0; i < model->numtriangles; i++)
+        if (!s->removed[i])
+            for (j = 0; j < 3; j++)
+                s->offsets[s->triangles[i].vindices[j] + 1]++;
+    for (v = 1; v <= model->numvertices + 1; v++)
+        s->offsets[v] += s->offsets[v - 1];
+    for (i = 0; i < model->numtriangles; i++)
+        if (!s->removed[i])
+            for (j = 0; j < 3; j++)
+                s->adjacency[s->offsets[s->triangles[i].vindices[j]]++] = i;
+    for (v = model->numvertices + 1; v > 0; v--)
+        s->offsets[v] = s->offsets[v - 1];
+    s->offsets[0] = 0;
+}
+
+/* glmLODEdge: how many triangles left share the edge u-v */
+static GLuint
+glmLODEdge(GLMsimplify* s, GLuint u, GLuint v)
+{
+    GLMtriangle* triangle;
+    GLuint i, count;
+
+    count = 0;
+    for (i = s->offsets[u]; i < s->offsets[u + 1]; i++) {
+        triangle = &s->triangles[s->adjacency[i]];
+        if (triangle->vindices[0] == v || triangle->vindices[1] == v ||
+            triangle->vindices[2] == v)
+            count++;
+    }
+    return count;
+}
+
+/* glmLODInit: copy the triangles, sort the vertices into kinds and
+ * build their quadrics */
+static GLvoid
+glmLODInit(GLMsimplify* s, GLMmodel* model)
+{
+    GLMgroup* group;
+    GLMtriangle* triangle;
+    GLuint* nindex;
+    GLuint* tindex;
+    GLMgroup** vgroup;
+    double n[3], e[3], p[3], length, area;
+    GLfloat* a;
+    GLfloat* b;
+    GLuint i, j, k, u, v, count;
+
+    s->model = model;
+    s->triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) *
+        model->numtriangles);
+    memcpy(s->triangles, model->triangles,
+        sizeof(GLMtriangle) * model->numtriangles);
+    s->groups = (GLMgroup**)calloc(model->numtriangles, sizeof(GLMgroup*));
+    s->removed = (GLubyte*)calloc(model->numtriangles, sizeof(GLubyte));
+    s->quadrics = (GLMquadric*)calloc(model->numvertices + 1,
+        sizeof(GLMquadric));
+    s->kinds = (GLubyte*)malloc(model->numvertices + 1);
+    s->locked = (GLubyte*)malloc(model->numvertices + 1);
+    s->offsets = (GLuint*)malloc(sizeof(GLuint) * (model->numvertices + 2));
+    s->adjacency = (GLuint*)malloc(sizeof(GLuint) * 3 * model->numtriangles);
+    s->error = 0.0;
+
+    /* triangles that are in no group aren't drawn: drop them */
+    for (group = model->groups; group; group = group->next)
+        for (i = 0; i < group->numtriangles; i++)
+            s->groups[group->triangles[i]] = group;
+    s->numtriangles = 0;
+    for (i = 0; i < model->numtriangles; i++) {
+        s->removed[i] = !s->groups[i];
+        s->numtriangles += !s->removed[i];
+    }
+
+    /* vertices whose corners differ in normal, texture coordinate or
+       group are locked */
+    nindex = (GLuint*)malloc(sizeof(GLuint) * (model->numvertices + 1));
+    tindex = (GLuint*)malloc(sizeof(GLuint) * (model->numvertices + 1));
+    vgroup = (GLMgroup**)calloc(model->numvertices + 1, sizeof(GLMgroup*));
+    memset(s->kinds, GLM_LOD_UNUSED, model->numvertices + 1);
+    for (i = 0; i < model->numtriangles; i++) {
+        if (s->removed[i])
+            continue;
+        triangle = &s->triangles[i];
+        for (j = 0; j < 3; j++) {
+            v = triangle->vindices[j];
+            if (s->kinds[v] == GLM_LOD_UNUSED) {
+                s->kinds[v] = GLM_LOD_FREE;
+                nindex[v] = triangle->nindices[j];
+                tindex[v] = triangle->tindices[j];
+                vgroup[v] = s->groups[i];
+            } else if (nindex[v] != triangle->nindices[j] ||
+                tindex[v] != triangle->tindices[j] ||
+                vgroup[v] != s->groups[i]) {
+                s->kinds[v] = GLM_LOD_LOCKED;
+            }
+        }
+    }
+    free(vgroup);
+    free(tindex);
+    free(nindex);
+
+    /* the planes of the triangles, weighted by area */
+    for (i = 0; i < model->numtriangles; i++) {
+        if (s->removed[i])
+            continue;
+        triangle = &s->triangles[i];
+        glmLODNormal(model, triangle, 0, NULL, n);
+        length = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if (length == 0.0)
+            continue;
+        area = length / 2.0;
+        for (j = 0; j < 3; j++)
+            n[j] /= length;
+        a = &model->vertices[3 * triangle->vindices[0]];
+        for (j = 0; j < 3; j++)
+            glmQuadricPlane(&s->quadrics[triangle->vindices[j]], n,
+                -(n[0]*a[0] + n[1]*a[1] + n[2]*a[2]), area);
+    }
+
+    /* border and non-manifold edges: an edge of a triangle that no
+       other triangle has is a border, one that more than two have is
+       non-manifold */
+    glmLODAdjacency(s);
+    for (i = 0; i < model->numtriangles; i++) {
+        if (s->removed[i])
+            continue;
+        triangle = &s->triangles[i];
+        for (j = 0; j < 3; j++) {
+            u = triangle->vindices[j];
+            v = triangle->vindices[(j + 1) % 3];
+            if (u == v)
+                continue;
+            count = glmLODEdge(s, u, v);
+            if (count > 2) {
+                s->kinds[u] = s->kinds[v] = GLM_LOD_LOCKED;
+                continue;
+            }
+            if (count != 1)
+                continue;
+            for (k = 0; k < 2; k++) {
+                if (s->kinds[k ? v : u] == GLM_LOD_FREE)
+                    s->kinds[k ? v : u] = GLM_LOD_BORDER;
+            }
+
+            /* hold the border in place with a plane through the edge,
+               at right angles to the triangle */
+            glmLODNormal(model, triangle, 0, NULL, n);
+            a = &model->vertices[3 * u];
+            b = &model->vertices[3 * v];
+            for (k = 0; k < 3; k++)
+                e[k] = b[k] - a[k];
+            p[0] = e[1]*n[2] - e[2]*n[1];
+            p[1] = e[2]*n[0] - e[0]*n[2];
+            p[2] = e[0]*n[1] - e[1]*n[0];
+            length = sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+            if (length == 0.0)
+                continue;
+            for (k = 0; k < 3; k++)
+                p[k] /= length;
+            area = GLM_LOD_BORDER_WEIGHT * (e[0]*e[0] + e[1]*e[1] + e[2]*e[2]);
+            glmQuadricPlane(&s->quadrics[u], p,
+                -(p[0]*a[0] + p[1]*a[1] + p[2]*a[2]), area);
+            glmQuadricPlane(&s->quadrics[v], p,
+                -(p[0]*a[0] + p[1]*a[1] + p[2]*a[2]), area);
+        }
+    }
+}
+
+/* glmLODFree: release the state of a simplification */
+static GLvoid
+glmLODFree(GLMsimplify* s)
+{
+    free(s->triangles);
+    free(s->groups);
+    free(s->removed);
+    free(s->quadrics);
+    free(s->kinds);
+    free(s->locked);
+    free(s->offsets);
+    free(s->adjacency);
+}
+
+/* glmLODCorner: the corner of v in a triangle left that has both u and
+ * v, or -1 if there isn't one (the edge is gone) */
+static GLint
+glmLODCorner(GLMsimplify* s, GLuint u, GLuint v, GLMtriangle** shared)
+{
+    GLMtriangle* triangle;
+    GLuint i, j;
+
+    for (i = s->offsets[u]; i < s->offsets[u + 1]; i++) {
+        triangle = &s->triangles[s->adjacency[i]];
+        for (j = 0; j < 3; j++) {
+            if (triangle->vindices[j] == v) {
+                *shared = triangle;
+                return j;
+            }
+        }
+    }
+    return -1;
+}
+
+/* glmLODCost: the cost of collapsing u onto v: the quadric error of u
+ * at v plus how far the normal of u would turn (as a distance along the
+ * edge), squared, per unit of weight (so a squared distance) */
+static double
+glmLODCost(GLMsimplify* s, GLuint u, GLuint v)
+{
+    GLMmodel* model = s->model;
+    GLMtriangle* shared;
+    GLfloat* pu;
+    GLfloat* pv;
+    GLfloat* nu;
+    GLfloat* nv;
+    double cost, turn, length2;
+    GLint corner;
+    GLuint i, j;
+
+    pu = &model->vertices[3 * u];
+    pv = &model->vertices[3 * v];
+    if (s->quadrics[u].w == 0.0)
+        return 0.0;             /* only degenerate triangles around u */
+    cost = glmQuadricError(&s->quadrics[u], pv) / s->quadrics[u].w;
+
+    corner = glmLODCorner(s, u, v, &shared);
+    if (corner < 0 || !model->normals)
+        return cost;
+    for (i = s->offsets[u]; i < s->offsets[u + 1]; i++)
+        for (j = 0; j < 3; j++)
+            if (s->triangles[s->adjacency[i]].vindices[j] == u)
+                goto found;
+    return cost;
+found:
+    nu = &model->normals[3 * s->triangles[s->adjacency[i]].nindices[j]];
+    nv = &model->normals[3 * shared->nindices[corner]];
+    turn = 1.0 - (nu[0]*nv[0] + nu[1]*nv[1] + nu[2]*nv[2]);
+    length2 = (pv[0] - pu[0]) * (pv[0] - pu[0]) +
+        (pv[1] - pu[1]) * (pv[1] - pu[1]) + (pv[2] - pu[2]) * (pv[2] - pu[2]);
+    return cost + turn * turn * length2;
+}
+
+/* glmLODAllowed: whether u may collapse onto v without flipping a
+ * triangle or making the surface non-manifold */
+static GLboolean
+glmLODAllowed(GLMsimplify* s, GLuint u, GLuint v)
+{
+    GLMmodel* model = s->model;
+    GLMtriangle* triangle;
+    double n0[3], n1[3];
+    GLuint i, j, k, w, x, common, shared;
+    GLboolean seen;
+
+    /* borders only move along the border */
+    shared = glmLODEdge(s, u, v);
+    if (s->kinds[u] == GLM_LOD_BORDER && shared != 1)
+        return GL_FALSE;
+    if (shared == 0 || shared > 2)
+        return GL_FALSE;
+
+    /* nor may the last triangles of a piece go */
+    if (s->offsets[u + 1] - s->offsets[u] == shared &&
+        s->offsets[v + 1] - s->offsets[v] == shared)
+        return GL_FALSE;
+
+    /* link condition: u and v may only have the neighbours in common
+       that the triangles on their edge give them */
+    common = 0;
+    for (i = s->offsets[u]; i < s->offsets[u + 1]; i++) {
+        triangle = &s->triangles[s->adjacency[i]];
+        for (j = 0; j < 3; j++) {
+            w = triangle->vindices[j];
+            if (w == u || w == v)
+                continue;
+            /* count each neighbour of u once */
+            seen = GL_FALSE;
+            for (k = s->offsets[u]; k < i && !seen; k++)
+                for (x = 0; x < 3; x++)
+                    if (s->triangles[s->adjacency[k]].vindices[x] == w)
+                        seen = GL_TRUE;
+            for (x = 0; x < j && !seen; x++)
+                if (triangle->vindices[x] == w)
+                    seen = GL_TRUE;
+            if (!seen && glmLODEdge(s, v, w))
+                common++;
+        }
+    }
+    if (common != shared)
+        return GL_FALSE;
+
+    /* no triangle that stays may turn over */
+    for (i = s->offsets[u]; i < s->offsets[u + 1]; i++) {
+        triangle = &s->triangles[s->adjacency[i]];
+        if (triangle->vindices[0] == v || triangle->vindices[1] == v ||
+            triangle->vindices[2] == v)
+            continue;
+        glmLODNormal(model, triangle, 0, NULL, n0);
+        glmLODNormal(model, triangle, u, &model->vertices[3 * v], n1);
+        if (n0[0]*n1[0] + n0[1]*n1[1] + n0[2]*n1[2] <= 0.0)
+            return GL_FALSE;
+    }
+
+    return GL_TRUE;
+}
+
+/* glmLODCollapse: move u onto v, giving the corners of u the normal and
+ * texture coordinate v has on their side of the edge */
+static GLvoid
+glmLODCollapse(GLMsimplify* s, GLuint u, GLuint v)
+{
+    GLMtriangle* triangle;
+    GLMtriangle* shared;
+    GLuint i, j, nindex, tindex;
+    GLint corner;
+
+    corner = glmLODCorner(s, u, v, &shared);
+    assert(corner >= 0);
+    nindex = shared->nindices[corner];
+    tindex = shared->tindices[corner];
+
+    for (i = s->offsets[u]; i < s->offsets[u + 1]; i++) {
+        triangle = &s->triangles[s->adjacency[i]];
+        for (j = 0; j < 3; j++) {
+            s->locked[triangle->vindices[j]] = 1;
+            if (triangle->vindices[j] == u) {
+                triangle->vindices[j] = v;
+                triangle->nindices[j] = nindex;
+                triangle->tindices[j] = tindex;
+            }
+        }
+        if (triangle->vindices[0] == triangle->vindices[1] ||
+            triangle->vindices[1] == triangle->vindices[2] ||
+            triangle->vindices[2] == triangle->vindices[0]) {
+            s->removed[s->adjacency[i]] = 1;
+            s->numtriangles--;
+        }
+    }
+
+    glmQuadricAdd(&s->quadrics[v], &s->quadrics[u]);
+    s->kinds[u] = GLM_LOD_UNUSED;
+}
+
+/* glmCollapseCompare: qsort() order of collapses, cheapest first */
+static int
+glmCollapseCompare(const void* a, const void* b)
+{
+    const GLMcollapse* ca = (const GLMcollapse*)a;
+    const GLMcollapse* cb = (const GLMcollapse*)b;
+
+    if (ca->cost != cb->cost)
+        return ca->cost < cb->cost ? -1 : 1;
+    return ca->u < cb->u ? -1 : ca->u > cb->u;
+}
+
+/* glmLODReduce: collapse edges until at most target triangles are
+ * left, or nothing more can be collapsed */
+static GLvoid
+glmLODReduce(GLMsimplify* s, GLuint target)
+{
+    GLMmodel* model = s->model;
+    GLMcollapse* collapses;
+    GLMtriangle* triangle;
+    GLuint i, j, u, v, numcollapses, goal, done;
+    double cost, bound;
+
+    collapses = (GLMcollapse*)malloc(sizeof(GLMcollapse) *
+        (model->numvertices + 1));
+    while (s->numtriangles > target) {
+        glmLODAdjacency(s);
+
+        /* the cheapest collapse of every vertex that can move */
+        numcollapses = 0;
+        for (u = 1; u <= model->numvertices; u++) {
+            if (s->kinds[u] != GLM_LOD_FREE && s->kinds[u] != GLM_LOD_BORDER)
+                continue;
+            collapses[numcollapses].u = u;
+            collapses[numcollapses].v = 0;
+            for (i = s->offsets[u]; i < s->offsets[u + 1]; i++) {
+                triangle = &s->triangles[s->adjacency[i]];
+                for (j = 0; j < 3; j++) {
+                    v = triangle->vindices[j];
+                    if (v == u)
+                        continue;
+                    if (s->kinds[u] == GLM_LOD_BORDER &&
+                        glmLODEdge(s, u, v) != 1)
+                        continue;
+                    cost = glmLODCost(s, u, v);
+                    if (!collapses[numcollapses].v ||
+                        cost < collapses[numcollapses].cost) {
+                        collapses[numcollapses].v = v;
+                        collapses[numcollapses].cost = cost;
+                    }
+                }
+            }
+            if (collapses[numcollapses].v)
+                numcollapses++;
+        }
+        if (!numcollapses)
+            break;
+        qsort(collapses, numcollapses, sizeof(GLMcollapse), glmCollapseCompare);
+
+        /* do the cheapest ones that don't touch each other, about as
+           many as it takes to get to the target (each removes one or
+           two triangles), but none much dearer than the goal'th: those
+           are better left for the next pass to look at again */
+        goal = (s->numtriangles - target + 1) / 2;
+        bound = collapses[goal < numcollapses ? goal : numcollapses - 1].cost *
+            GLM_LOD_PASS_BOUND;
+        memset(s->locked, 0, model->numvertices + 1);
+        done = 0;
+        for (i = 0; i < numcollapses && done < goal; i++) {
+            u = collapses[i].u;
+            v = collapses[i].v;
+            if (collapses[i].cost > bound)
+                break;
+            if (s->locked[u] || s->locked[v] || !glmLODAllowed(s, u, v))
+                continue;
+            if (sqrt(collapses[i].cost) > s->error)
+                s->error = sqrt(collapses[i].cost);
+            glmLODCollapse(s, u, v);
+            done++;
+        }
+        if (!done)
+            break;
+    }
+    free(collapses);
+}
+
+/* glmLODCompact: copy the vectors a level uses into its own array, and
+ * renumber the indices (of the given field of its triangles) */
+static GLuint
+glmLODCompact(GLMmodel* lod, const GLfloat* vectors, GLuint size,
+              size_t field, GLuint numvectors, GLfloat** result)
+{
+    GLuint* remap;
+    GLuint* index;
+    GLuint i, j, count;
+
+    *result = NULL;
+    if (!vectors)
+        return 0;
+
+    remap = (GLuint*)calloc(numvectors + 1, sizeof(GLuint));
+    count = 0;
+    for (i = 0; i < lod->numtriangles; i++) {
+        index = (GLuint*)((char*)&lod->triangles[i] + field);
+        for (j = 0; j < 3; j++)
+            if (index[j] && !remap[index[j]])
+                remap[index[j]] = ++count;
+    }
+
+    *result = (GLfloat*)glmAlloc(lod, sizeof(GLfloat) * size * (count + 1));
+    memset(*result, 0, sizeof(GLfloat) * size);
+    for (i = 1; i <= numvectors; i++)
+        if (remap[i])
+            memcpy(&(*result)[size * remap[i]], &vectors[size * i],
+                sizeof(GLfloat) * size);
+    for (i = 0; i < lod->numtriangles; i++) {
+        index = (GLuint*)((char*)&lod->triangles[i] + field);
+        for (j = 0; j < 3; j++)
+            index[j] = remap[index[j]];
+    }
+
+    free(remap);
+    return count;
+}
+
+/* glmLODModel: make a model out of the triangles left */
+static GLMmodel*
+glmLODModel(GLMsimplify* s)
+{
+    GLMmodel* model = s->model;
+    GLMmodel* lod;
+    GLMgroup* group;
+    GLMgroup* copy;
+    GLMgroup** tail;
+    GLuint* number;
+    GLuint i, n;
+
+    lod = glmNewModel(model->pathname);
+    if (model->mtllibname)
+        lod->mtllibname = glmStrdup(lod, model->mtllibname);
+    lod->nummaterials = model->nummaterials;
+    if (model->materials) {
+        lod->materials = (GLMmaterial*)glmAlloc(lod,
+            sizeof(GLMmaterial) * model->nummaterials);
+        memcpy(lod->materials, model->materials,
+            sizeof(GLMmaterial) * model->nummaterials);
+        for (i = 0; i < model->nummaterials; i++)
+            lod->materials[i].name = glmStrdup(lod, model->materials[i].name);
+    }
+
+    /* the triangles left, renumbered */
+    number = (GLuint*)malloc(sizeof(GLuint) * model->numtriangles);
+    lod->triangles = (GLMtriangle*)glmAlloc(lod,
+        sizeof(GLMtriangle) * s->numtriangles);
+    n = 0;
+    for (i = 0; i < model->numtriangles; i++) {
+        if (s->removed[i])
+            continue;
+        number[i] = n;
+        lod->triangles[n] = s->triangles[i];
+        lod->triangles[n].findex = 0;
+        n++;
+    }
+    lod->numtriangles = n;
+
+    /* the groups, in the same order, with the triangles they have left */
+    tail = &lod->groups;
+    for (group = model->groups; group; group = group->next) {
+        copy = (GLMgroup*)glmAlloc(lod, sizeof(GLMgroup));
+        copy->name = glmStrdup(lod, group->name);
+        copy->material = group->material;
+        copy->triangles = (GLuint*)glmAlloc(lod,
+            sizeof(GLuint) * (group->numtriangles ? group->numtriangles : 1));
+        copy->numtriangles = 0;
+        for (i = 0; i < group->numtriangles; i++)
+            if (!s->removed[group->triangles[i]])
+                copy->triangles[copy->numtriangles++] =
+                    number[group->triangles[i]];
+        copy->nummeshlets = 0;
+        copy->meshlets = NULL;
+        copy->indices = NULL;
+        copy->next = NULL;
+        *tail = copy;
+        tail = &copy->next;
+        lod->numgroups++;
+    }
+    free(number);
+
+    lod->numvertices = glmLODCompact(lod, model->vertices, 3,
+        offsetof(GLMtriangle, vindices), model->numvertices, &lod->vertices);
+    lod->numnormals = glmLODCompact(lod, model->normals, 3,
+        offsetof(GLMtriangle, nindices), model->numnormals, &lod->normals);
+    lod->numtexcoords = glmLODCompact(lod, model->texcoords, 2,
+        offsetof(GLMtriangle, tindices), model->numtexcoords, &lod->texcoords);
+
+    /* the vertex normals carried over are still good */
+    glmFacetNormals(lod);
+    if (lod->normals)
+        lod->dirty &= ~GLM_DIRTY_NORMALS;
+    glmOptimizeVertexCache(lod, GLM_VERTEX_CACHE);
+    glmOptimizeOverdraw(lod, GLM_VERTEX_CACHE, GLM_OVERDRAW_THRESHOLD);
+
+    lod->error = s->error;
+    return lod;
+}
+
+
+/* glmBuildLODs: Builds a chain of simplified copies of a model, one for
+ * each ratio (of the triangles of the model) in turn.  Returns the
+ * number of levels built.
+ *
+ * model     - initialized GLMmodel structure (not still streaming)
+ * numlevels - number of ratios
+ * ratios    - fraction of the triangles to keep in each level, largest
+ *             first (e.g. 0.5, 0.25, 0.1)
+ */
+GLuint
+glmBuildLODs(GLMmodel* model, GLuint numlevels, const GLfloat* ratios)
+{
+    GLMsimplify s;
+    GLMmodel** tail;
+    GLuint i, last, built;
+
+    assert(model);
+    assert(!model->stream);
+
+    if (model->lod) {
+        glmDelete(model->lod);
+        model->lod = NULL;
+    }
+    glmVertices(model);
+    if (!model->numtriangles)
+        return 0;
+
+    /* each level goes on from where the last one stopped */
+    glmLODInit(&s, model);
+    tail = &model->lod;
+    last = s.numtriangles;
+    built = 0;
+    for (i = 0; i < numlevels; i++) {
+        glmLODReduce(&s, (GLuint)(ratios[i] * model->numtriangles));
+        if (s.numtriangles > GLM_LOD_MIN_GAIN * last)
+            break;
+        *tail = glmLODModel(&s);
+        tail = &(*tail)->lod;
+        last = s.numtriangles;
+        built++;
+    }
+    glmLODFree(&s);
+
+    model->lodversion = model->version;
+    return built;
+}
+
+/* glmPixelsPerUnit: Returns how many pixels a unit covers, with the
+ * current OpenGL matrices and viewport, at a point (in object
+ * coordinates), or 0.0 if the eye is in (or near) the sphere around it.
+ *
+ * center - point
+ * radius - radius of the sphere around it
+ */
+GLfloat
+glmPixelsPerUnit(const GLfloat* center, GLfloat radius)
+{
+    GLfloat modelview[16], projection[16];
+    GLfloat scale, length, depth, perpixel;
+    GLint viewport[4];
+    GLuint i;
+
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    /* the distance of the point from the eye, and the scale the
+       modelview matrix applies (its longest axis) */
+    depth = -(modelview[2] * center[0] + modelview[6] * center[1] +
+        modelview[10] * center[2] + modelview[14]);
+    scale = 0.0;
+    for (i = 0; i < 3; i++) {
+        length = sqrt(modelview[4*i] * modelview[4*i] +
+            modelview[4*i + 1] * modelview[4*i + 1] +
+            modelview[4*i + 2] * modelview[4*i + 2]);
+        if (length > scale)
+            scale = length;
+    }
+
+    /* pixels per unit at that distance */
+    perpixel = scale * projection[5] * viewport[3] / 2.0;
+    if (projection[15] == 0.0) {
+        if (depth <= radius * scale)
+            return 0.0;
+        perpixel /= depth;
+    }
+    return perpixel;
+}
+
+/* glmLOD: Returns the level of detail of a model to draw with the
+ * current OpenGL matrices and viewport.
+ *
+ * model  - initialized GLMmodel structure
+ * pixels - largest error allowed, in pixels (GLM_LOD_PIXELS)
+ */
+GLMmodel*
+glmLOD(GLMmodel* model, GLfloat pixels)
+{
+    GLMmodel* lod;
+    GLfloat center[3], radius, perpixel;
+
+    assert(model);
+
+    /* levels made before the vertices last changed are no good */
+    if (!model->lod || model->lodversion != model->version)
+        return model;
+
+    glmBoundingSphere(model, center, &radius);
+    perpixel = glmPixelsPerUnit(center, radius);
+    if (perpixel == 0.0)
+        return model;           /* the eye is in (or near) the model */
+
+    lod = model;
+    while (lod->lod && lod->lod->error * perpixel <= pixels)
+        lod = lod->lod;
+    return lod;
+}
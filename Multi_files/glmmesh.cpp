@@ -0,0 +1,300 @@
+/*
+      glmmesh.cpp
+
+      Retained mode rendering for the GLM library.
+
+      glmDraw() sends every corner of every triangle through glNormal*()
+      and glVertex*() calls, every frame.  A GLMmesh instead keeps the
+      vertex and index arrays of glmBuildIndexed() in OpenGL buffer
+      objects, so a frame only costs a glDrawElements() and a material
+      per group (or per run of visible meshlets, with GLM_CULL).  The
+      model has to stay around: its groups give the materials and the
+      meshlets, and it is drawn with glmDraw() instead if its vertices
+      change after the mesh is made.
+
+ */
+
+
+#define GL_GLEXT_PROTOTYPES             /* buffer objects (OpenGL 1.5) */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "glm.h"
+#include "glmint.h"
+
+
+/* glmIndexSize: bytes per index of a type */
+static GLuint
+glmIndexSize(GLenum type)
+{
+    return type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+/* glmInterleavedSize: floats per vertex of a glInterleavedArrays()
+ * format */
+static GLuint
+glmInterleavedSize(GLenum format)
+{
+    switch (format) {
+    case GL_N3F_V3F:
+        return 6;
+    case GL_T2F_V3F:
+        return 5;
+    case GL_T2F_N3F_V3F:
+        return 8;
+    default:
+        return 3;
+    }
+}
+
+/* glmUploadMesh: make a mesh for one model (level) whose vertex and
+ * index arrays are built */
+static GLMmesh*
+glmUploadMesh(GLMmodel* model)
+{
+    GLMmesh* mesh;
+    GLMgroup* group;
+    GLuint i, first, size;
+
+    mesh = (GLMmesh*)malloc(sizeof(GLMmesh));
+    mesh->model = model;
+    mesh->format = model->interleavedformat;
+    mesh->indextype = model->indextype;
+    mesh->mode = model->interleavedmode;
+    mesh->version = model->version;
+    mesh->numranges = model->numgroups;
+    mesh->ranges = (GLMrange*)malloc(sizeof(GLMrange) *
+        (model->numgroups + 1));
+    mesh->lod = NULL;
+
+    glGenBuffers(1, &mesh->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) *
+        glmInterleavedSize(mesh->format) * model->numinterleaved,
+        model->interleaved, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    /* the groups' indices one after another, each group a range */
+    size = glmIndexSize(mesh->indextype);
+    first = 0;
+    for (i = 0, group = model->groups; group; group = group->next, i++) {
+        mesh->ranges[i].group = group;
+        mesh->ranges[i].first = first;
+        mesh->ranges[i].count = 3 * group->numtriangles;
+        first += mesh->ranges[i].count;
+    }
+    glGenBuffers(1, &mesh->ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size * first, NULL, GL_STATIC_DRAW);
+    for (i = 0; i < mesh->numranges; i++)
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, size * mesh->ranges[i].first,
+            size * mesh->ranges[i].count, mesh->ranges[i].group->indices);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    return mesh;
+}
+
+/* glmNewMesh: Makes a mesh that draws a model (and its levels of
+ * detail) from buffer objects.
+ *
+ * model - initialized GLMmodel structure (not still streaming)
+ * mode  - attributes to put in the vertices
+ *             GLM_NONE     -  only vertices
+ *             GLM_FLAT     -  facet normals
+ *             GLM_SMOOTH   -  vertex normals
+ *             GLM_TEXTURE  -  texture coords
+ */
+GLMmesh*
+glmNewMesh(GLMmodel* model, GLuint mode)
+{
+    GLMmesh* mesh;
+    GLMmesh** tail;
+    GLMmodel* level;
+    GLMgroup* group;
+    GLboolean built;
+
+    assert(model);
+    assert(!model->stream);
+
+    /* the vertex and index arrays, unless they are there already */
+    built = model->indexedversion == model->version &&
+        model->interleaved &&
+        model->interleavedmode == (mode & (GLM_FLAT | GLM_SMOOTH | GLM_TEXTURE));
+    for (group = model->groups; group && built; group = group->next)
+        if (group->numtriangles && !group->indices)
+            built = GL_FALSE;
+    if (!built)
+        glmBuildIndexed(model, mode);
+
+    mesh = NULL;
+    tail = &mesh;
+    for (level = model; level; level = level->lod) {
+        *tail = glmUploadMesh(level);
+        tail = &(*tail)->lod;
+    }
+
+    return mesh;
+}
+
+/* glmBindMesh: Makes the buffers of a mesh the vertex and index arrays
+ * (or, for NULL, goes back to no buffers and no arrays).
+ *
+ * mesh - mesh made by glmNewMesh(), or NULL
+ */
+GLvoid
+glmBindMesh(GLMmesh* mesh)
+{
+    if (!mesh) {
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glDisableClientState(GL_NORMAL_ARRAY);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+    glInterleavedArrays(mesh->format, 0, NULL);
+}
+
+/* glmDrawRange: Draws one range (group) of a bound mesh.
+ *
+ * mesh  - mesh bound by glmBindMesh()
+ * range - index of the range
+ * cull  - culling set up by glmCullBegin() for the mesh's model, or
+ *         NULL to draw every meshlet
+ */
+GLvoid
+glmDrawRange(GLMmesh* mesh, GLuint range, const GLMcull* cull)
+{
+    GLMgroup* group;
+    GLMmeshlet* meshlet;
+    GLuint j, begin, end, size;
+
+    group = mesh->ranges[range].group;
+    size = glmIndexSize(mesh->indextype);
+
+    if (!cull || !group->meshlets) {
+        glDrawElements(GL_TRIANGLES, mesh->ranges[range].count,
+            mesh->indextype,
+            (GLvoid*)(size_t)(size * mesh->ranges[range].first));
+        return;
+    }
+
+    /* one draw per run of meshlets that can be seen (the one that
+       ends a run was culled, so it is skipped) */
+    for (j = 0; j < group->nummeshlets; j = end + 1) {
+        while (j < group->nummeshlets &&
+               glmCullMeshlet(cull, &group->meshlets[j]))
+            j++;
+        if (j == group->nummeshlets)
+            break;
+        begin = group->meshlets[j].begin;
+        for (end = j + 1; end < group->nummeshlets; end++)
+            if (glmCullMeshlet(cull, &group->meshlets[end]))
+                break;
+        meshlet = &group->meshlets[end - 1];
+        glDrawElements(GL_TRIANGLES,
+            3 * (meshlet->begin + meshlet->numtriangles - begin),
+            mesh->indextype, (GLvoid*)(size_t)(size *
+            (mesh->ranges[range].first + 3 * begin)));
+    }
+}
+
+/* glmDrawMesh: Renders a mesh to the current OpenGL context.
+ *
+ * mesh - mesh made by glmNewMesh()
+ * mode - a bitwise OR of values describing what is to be rendered.
+ *            GLM_COLOR    -  render with colors (color material)
+ *            GLM_MATERIAL -  render with materials
+ *            GLM_CULL     -  skip meshlets that can't be seen
+ */
+GLvoid
+glmDrawMesh(GLMmesh* mesh, GLuint mode)
+{
+    GLMmodel* model;
+    GLMmaterial* material;
+    GLMcull cull;
+    GLboolean culling;
+    GLuint i;
+
+    assert(mesh);
+    model = mesh->model;
+
+    /* the buffers are out of date once the vertices change */
+    if (mesh->version != model->version) {
+        glmDraw(model, mesh->mode | (mode & (GLM_COLOR | GLM_MATERIAL | GLM_CULL)));
+        return;
+    }
+
+    mode = glmCheckMode(model, mode & (GLM_COLOR | GLM_MATERIAL | GLM_CULL),
+        "glmDrawMesh", GL_FALSE);
+    if (mode & GLM_COLOR)
+        glmEnable(GL_COLOR_MATERIAL);
+    else if (mode & GLM_MATERIAL)
+        glmDisable(GL_COLOR_MATERIAL);
+
+    glmBindMesh(mesh);
+    culling = mode & GLM_CULL && glmCullBegin(model, &cull);
+
+    for (i = 0; i < mesh->numranges; i++) {
+        if (!mesh->ranges[i].count)
+            continue;
+
+        material = mode & (GLM_COLOR | GLM_MATERIAL) ?
+            &model->materials[mesh->ranges[i].group->material] : NULL;
+        if (mode & GLM_MATERIAL) {
+            glmMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, material->ambient);
+            glmMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, material->diffuse);
+            glmMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, material->specular);
+            glmMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, material->shininess);
+        }
+        if (mode & GLM_COLOR)
+            glmColor3fv(material->diffuse);
+
+        glmDrawRange(mesh, i, culling ? &cull : NULL);
+    }
+
+    glmBindMesh(NULL);
+}
+
+/* glmMeshLOD: Returns the mesh of the level of detail glmLOD() picks
+ * for the model of a mesh.
+ *
+ * mesh   - mesh made by glmNewMesh()
+ * pixels - largest error allowed, in pixels (GLM_LOD_PIXELS)
+ */
+GLMmesh*
+glmMeshLOD(GLMmesh* mesh, GLfloat pixels)
+{
+    GLMmodel* level;
+    GLMmesh* lod;
+
+    assert(mesh);
+
+    level = glmLOD(mesh->model, pixels);
+    for (lod = mesh; lod; lod = lod->lod)
+        if (lod->model == level)
+            return lod;
+    return mesh;
+}
+
+/* glmDeleteMesh: Deletes a mesh and its buffer objects.
+ *
+ * mesh - mesh made by glmNewMesh()
+ */
+GLvoid
+glmDeleteMesh(GLMmesh* mesh)
+{
+    assert(mesh);
+
+    if (mesh->lod)
+        glmDeleteMesh(mesh->lod);
+    glDeleteBuffers(1, &mesh->vbo);
+    glDeleteBuffers(1, &mesh->ibo);
+    free(mesh->ranges);
+    free(mesh);
+}
@@ -0,0 +1,545 @@
+/*
+      glmmeshlet.cpp
+
+      Meshlets (small clusters of triangles) and their culling for the
+      GLM library.
+
+      glmBuildMeshlets() cuts the triangles of each group into meshlets
+      of neighbouring triangles, grown greedily from the first free
+      triangle in draw order, and then puts the triangles of each
+      meshlet together (keeping their vertex cache order).  Each meshlet
+      keeps a bounding sphere and, if it is part of a closed surface, a
+      cone that holds the facet normals of its triangles, with its apex
+      behind all of them (as in meshoptimizer's
+      meshopt_computeMeshletBounds()).  A cone only rejects anything if
+      it is narrow, so on a closed surface a meshlet stops growing when
+      the next triangle would turn too far from the average normal.
+
+      glmDraw() with GLM_CULL then skips a meshlet before any of its
+      vertices are sent if its sphere is outside the view frustum, or if
+      the eye is inside the back side of its cone, that is every one of
+      its triangles faces away from the eye.  Back faces of a closed
+      surface are hidden by its front faces anyway, so the picture only
+      changes by a pixel here and there along silhouettes (and not at
+      all with GL_CULL_FACE).
+
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "glm.h"
+#include "glmint.h"
+
+
+#define T(x) (model->triangles[(x)])
+
+#define GLM_MESHLET_NONE ((GLuint)-1)   /* triangle not in a meshlet yet */
+
+
+/* glmFindRoot: union-find root of a vertex, halving the path */
+static GLuint
+glmFindRoot(GLuint* parent, GLuint v)
+{
+    while (parent[v] != v) {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+/* glmClosedTriangles: flag the triangles of the model that are part of
+ * a closed surface, a connected piece in which every edge is shared by
+ * exactly two triangles.  The back faces of those can't be seen from
+ * outside, so only they may be culled by their cone.
+ */
+static GLubyte*
+glmClosedTriangles(GLMmodel* model)
+{
+    GLubyte* closed;
+    GLubyte* open;
+    GLuint* parent;
+    GLuint* offsets;
+    GLuint* adjacency;
+    GLuint i, j, k, u, v, shared;
+
+    /* the triangles of each vertex */
+    offsets = (GLuint*)calloc(model->numvertices + 2, sizeof(GLuint));
+    adjacency = (GLuint*)malloc(sizeof(GLuint) * 3 * model->numtriangles + 1);
+    for (i = 0; i < model->numtriangles; i++)
+        for (j = 0; j < 3; j++)
+            offsets[T(i).vindices[j] + 1]++;
+    for (v = 0; v <= model->numvertices; v++)
+        offsets[v + 1] += offsets[v];
+    for (i = 0; i < model->numtriangles; i++)
+        for (j = 0; j < 3; j++)
+            adjacency[offsets[T(i).vindices[j]]++] = i;
+    for (v = model->numvertices + 1; v > 0; v--)
+        offsets[v] = offsets[v - 1];
+    offsets[0] = 0;
+
+    /* connect the pieces, and mark the ones with an edge that isn't
+       shared by exactly two triangles */
+    parent = (GLuint*)malloc(sizeof(GLuint) * (model->numvertices + 1));
+    open = (GLubyte*)calloc(model->numvertices + 1, sizeof(GLubyte));
+    for (v = 0; v <= model->numvertices; v++)
+        parent[v] = v;
+    for (i = 0; i < model->numtriangles; i++)
+        for (j = 1; j < 3; j++)
+            parent[glmFindRoot(parent, T(i).vindices[j])] =
+                glmFindRoot(parent, T(i).vindices[0]);
+    for (i = 0; i < model->numtriangles; i++)
+        for (j = 0; j < 3; j++) {
+            u = T(i).vindices[j];
+            v = T(i).vindices[(j + 1) % 3];
+            shared = 0;
+            for (k = offsets[u]; k < offsets[u + 1]; k++)
+                if (T(adjacency[k]).vindices[0] == v ||
+                    T(adjacency[k]).vindices[1] == v ||
+                    T(adjacency[k]).vindices[2] == v)
+                    shared++;
+            if (shared != 2)
+                open[glmFindRoot(parent, u)] = GL_TRUE;
+        }
+
+    closed = (GLubyte*)malloc(model->numtriangles + 1);
+    for (i = 0; i < model->numtriangles; i++)
+        closed[i] = !open[glmFindRoot(parent, T(i).vindices[0])];
+
+    free(offsets);
+    free(adjacency);
+    free(parent);
+    free(open);
+
+    return closed;
+}
+
+/* glmMeshletBounds: fill in the bounding sphere and normal cone of the
+ * triangles of a meshlet */
+static GLvoid
+glmMeshletBounds(GLMmodel* model, GLMgroup* group, const GLubyte* closed,
+                 GLMmeshlet* meshlet)
+{
+    GLMtriangle* triangle;
+    GLfloat min[3], max[3], axis[3];
+    GLfloat* v;
+    GLfloat* n;
+    GLfloat d, length, mindot, apex;
+    GLuint i, j, k;
+
+    /* the sphere is centered on the bounding box */
+    for (k = 0; k < 3; k++) {
+        min[k] = 1e30f;
+        max[k] = -1e30f;
+    }
+    axis[0] = axis[1] = axis[2] = 0.0;
+    for (i = 0; i < meshlet->numtriangles; i++) {
+        triangle = &T(group->triangles[meshlet->begin + i]);
+        for (j = 0; j < 3; j++) {
+            v = &model->vertices[3 * triangle->vindices[j]];
+            for (k = 0; k < 3; k++) {
+                if (v[k] < min[k]) min[k] = v[k];
+                if (v[k] > max[k]) max[k] = v[k];
+            }
+        }
+        n = &model->facetnorms[3 * triangle->findex];
+        for (k = 0; k < 3; k++)
+            axis[k] += n[k];
+    }
+    for (k = 0; k < 3; k++)
+        meshlet->center[k] = (min[k] + max[k]) / 2.0;
+    meshlet->radius = 0.0;
+    for (i = 0; i < meshlet->numtriangles; i++) {
+        triangle = &T(group->triangles[meshlet->begin + i]);
+        for (j = 0; j < 3; j++) {
+            v = &model->vertices[3 * triangle->vindices[j]];
+            d = (v[0] - meshlet->center[0]) * (v[0] - meshlet->center[0]) +
+                (v[1] - meshlet->center[1]) * (v[1] - meshlet->center[1]) +
+                (v[2] - meshlet->center[2]) * (v[2] - meshlet->center[2]);
+            if (d > meshlet->radius)
+                meshlet->radius = d;
+        }
+    }
+    meshlet->radius = sqrt(meshlet->radius);
+
+    /* the cone is around the average normal, as wide as the normal
+       furthest from it; one of 90 degrees or more, or one on an open
+       surface, can never be culled */
+    length = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    meshlet->cutoff = 1.0;
+    for (k = 0; k < 3; k++)
+        meshlet->axis[k] = length > 0.0 ? axis[k] / length : 0.0;
+    if (length <= 0.0)
+        return;
+    for (i = 0; i < meshlet->numtriangles; i++)
+        if (!closed[group->triangles[meshlet->begin + i]])
+            return;
+    mindot = 1.0;
+    for (i = 0; i < meshlet->numtriangles; i++) {
+        n = &model->facetnorms[3 * T(group->triangles[meshlet->begin + i]).findex];
+        d = n[0] * meshlet->axis[0] + n[1] * meshlet->axis[1] +
+            n[2] * meshlet->axis[2];
+        if (d < mindot)
+            mindot = d;
+    }
+    if (mindot <= 0.0)
+        return;
+    meshlet->cutoff = sqrt(1.0 - mindot * mindot);
+
+    /* the apex of the cone is behind the center, far enough along the
+       axis to be behind the planes of all the triangles, so the test
+       is exact for a flat meshlet */
+    apex = 0.0;
+    for (i = 0; i < meshlet->numtriangles; i++) {
+        triangle = &T(group->triangles[meshlet->begin + i]);
+        v = &model->vertices[3 * triangle->vindices[0]];
+        n = &model->facetnorms[3 * triangle->findex];
+        d = ((meshlet->center[0] - v[0]) * n[0] +
+             (meshlet->center[1] - v[1]) * n[1] +
+             (meshlet->center[2] - v[2]) * n[2]) /
+            (n[0] * meshlet->axis[0] + n[1] * meshlet->axis[1] +
+             n[2] * meshlet->axis[2]);
+        if (d > apex)
+            apex = d;
+    }
+    for (k = 0; k < 3; k++)
+        meshlet->apex[k] = meshlet->center[k] - meshlet->axis[k] * apex;
+}
+
+/* GLMgrow: state of cutting one group into meshlets.  Triangles are
+ * known by their position in the group's triangles array.
+ */
+typedef struct _GLMgrow {
+  GLuint*  offsets;             /* triangles of each group vertex ... */
+  GLuint*  adjacency;           /* ... are adjacency[offsets[v]..] */
+  GLuint*  corners;             /* group vertex of each corner */
+  GLuint*  meshlet;             /* meshlet of each triangle (or none) */
+  GLuint*  seen;                /* meshlet that last listed a triangle */
+  GLuint*  candidates;          /* triangles next to the meshlet */
+  GLuint*  order;               /* new triangles array */
+} GLMgrow;
+
+/* glmPositionCompare: qsort() comparison of triangle positions */
+static int
+glmPositionCompare(const void* a, const void* b)
+{
+    GLuint u = *(const GLuint*)a;
+    GLuint v = *(const GLuint*)b;
+
+    return u < v ? -1 : u > v;
+}
+
+/* glmMeshletsGroup: cut a group into meshlets of at most maxtriangles
+ * triangles whose facet normals stay within mindot of their average,
+ * and put the triangles of each meshlet together */
+static GLuint
+glmMeshletsGroup(GLMmodel* model, GLMgroup* group, GLuint* local,
+                 const GLubyte* closed, GLuint maxtriangles, GLfloat mindot)
+{
+    GLMgrow grow;
+    GLMmeshlet* meshlet;
+    GLfloat axis[3], length, dot, best;
+    GLfloat* n;
+    GLuint i, j, k, v, seed, numvertices, numcandidates, numorder;
+    GLuint numtriangles, pick, scan, t;
+
+    glmFree(model, group->meshlets);
+    group->nummeshlets = 0;
+    group->meshlets = NULL;
+    if (!group->numtriangles)
+        return 0;
+
+    numtriangles = group->numtriangles;
+    grow.offsets    = (GLuint*)calloc(3 * numtriangles + 1, sizeof(GLuint));
+    grow.adjacency  = (GLuint*)malloc(sizeof(GLuint) * 3 * numtriangles);
+    grow.corners    = (GLuint*)malloc(sizeof(GLuint) * 3 * numtriangles);
+    grow.meshlet    = (GLuint*)malloc(sizeof(GLuint) * numtriangles);
+    grow.seen       = (GLuint*)malloc(sizeof(GLuint) * numtriangles);
+    grow.candidates = (GLuint*)malloc(sizeof(GLuint) * numtriangles);
+    grow.order      = (GLuint*)malloc(sizeof(GLuint) * numtriangles);
+
+    /* number the vertices of the group and list the triangles of each */
+    numvertices = 0;
+    for (i = 0; i < numtriangles; i++)
+        for (j = 0; j < 3; j++) {
+            v = T(group->triangles[i]).vindices[j];
+            if (local[v] == GLM_MESHLET_NONE)
+                local[v] = numvertices++;
+            grow.corners[3 * i + j] = local[v];
+            grow.offsets[local[v] + 1]++;
+        }
+    for (i = 0; i < numtriangles; i++)
+        for (j = 0; j < 3; j++)
+            local[T(group->triangles[i]).vindices[j]] = GLM_MESHLET_NONE;
+    for (v = 0; v < numvertices; v++)
+        grow.offsets[v + 1] += grow.offsets[v];
+    for (i = 0; i < 3 * numtriangles; i++)
+        grow.adjacency[grow.offsets[grow.corners[i]]++] = i / 3;
+    for (v = numvertices; v > 0; v--)
+        grow.offsets[v] = grow.offsets[v - 1];
+    grow.offsets[0] = 0;
+
+    for (i = 0; i < numtriangles; i++)
+        grow.meshlet[i] = grow.seen[i] = GLM_MESHLET_NONE;
+
+    /* grow each meshlet from the first triangle (in draw order) that
+       isn't in one yet, always taking the neighbour whose normal is
+       closest to the average so far.  Only meshlets on a closed surface
+       get a cone, so on open ones they just grow to full size, going on
+       to the next open piece in draw order when one runs out */
+    numorder = 0;
+    scan = 0;
+    for (seed = 0; seed < numtriangles; seed++) {
+        if (grow.meshlet[seed] != GLM_MESHLET_NONE)
+            continue;
+
+        numcandidates = 0;
+        grow.candidates[numcandidates++] = seed;
+        grow.seen[seed] = group->nummeshlets;
+        if (scan < seed)
+            scan = seed;
+        axis[0] = axis[1] = axis[2] = 0.0;
+        k = numorder;
+        while (numorder - k < maxtriangles) {
+            /* a piece of open surface runs on into the next one */
+            while (!numcandidates && !closed[group->triangles[seed]] &&
+                   ++scan < numtriangles)
+                if (grow.meshlet[scan] == GLM_MESHLET_NONE &&
+                    grow.seen[scan] != group->nummeshlets &&
+                    !closed[group->triangles[scan]]) {
+                    grow.seen[scan] = group->nummeshlets;
+                    grow.candidates[numcandidates++] = scan;
+                }
+            if (!numcandidates)
+                break;
+
+            pick = 0;
+            best = -2.0;
+            length = sqrt(axis[0] * axis[0] + axis[1] * axis[1] +
+                axis[2] * axis[2]);
+            for (i = 0; i < numcandidates; i++) {
+                n = &model->facetnorms[3 *
+                    T(group->triangles[grow.candidates[i]]).findex];
+                dot = length > 0.0 ? (n[0] * axis[0] + n[1] * axis[1] +
+                    n[2] * axis[2]) / length : 1.0;
+                if (dot > best) {
+                    best = dot;
+                    pick = i;
+                }
+            }
+            if (best < mindot && closed[group->triangles[seed]])
+                break;
+
+            t = grow.candidates[pick];
+            grow.candidates[pick] = grow.candidates[--numcandidates];
+            grow.meshlet[t] = group->nummeshlets;
+            grow.order[numorder++] = t;
+            n = &model->facetnorms[3 * T(group->triangles[t]).findex];
+            for (j = 0; j < 3; j++)
+                axis[j] += n[j];
+
+            for (j = 0; j < 3; j++) {
+                v = grow.corners[3 * t + j];
+                for (i = grow.offsets[v]; i < grow.offsets[v + 1]; i++) {
+                    if (grow.meshlet[grow.adjacency[i]] != GLM_MESHLET_NONE ||
+                        grow.seen[grow.adjacency[i]] == group->nummeshlets)
+                        continue;
+                    grow.seen[grow.adjacency[i]] = group->nummeshlets;
+                    grow.candidates[numcandidates++] = grow.adjacency[i];
+                }
+            }
+        }
+
+        /* inside a meshlet the triangles keep their vertex cache order */
+        qsort(&grow.order[k], numorder - k, sizeof(GLuint),
+            glmPositionCompare);
+        group->nummeshlets++;
+    }
+
+    /* the triangles meshlet by meshlet, and the meshlets' bounds */
+    group->meshlets = (GLMmeshlet*)malloc(sizeof(GLMmeshlet) *
+        group->nummeshlets);
+    for (i = 0; i < group->nummeshlets; i++)
+        group->meshlets[i].numtriangles = 0;
+    for (i = 0; i < numtriangles; i++) {
+        meshlet = &group->meshlets[grow.meshlet[grow.order[i]]];
+        if (!meshlet->numtriangles)
+            meshlet->begin = i;
+        meshlet->numtriangles++;
+        grow.order[i] = group->triangles[grow.order[i]];
+    }
+    memcpy(group->triangles, grow.order, sizeof(GLuint) * numtriangles);
+    glmFree(model, group->indices);
+    group->indices = NULL;
+    for (i = 0; i < group->nummeshlets; i++)
+        glmMeshletBounds(model, group, closed, &group->meshlets[i]);
+
+    free(grow.offsets);
+    free(grow.adjacency);
+    free(grow.corners);
+    free(grow.meshlet);
+    free(grow.seen);
+    free(grow.candidates);
+    free(grow.order);
+
+    return group->nummeshlets;
+}
+
+/* glmBuildMeshlets: Cuts the groups of a model and of its levels of
+ * detail into meshlets of at most maxtriangles triangles.  Returns the
+ * number of meshlets of the model.
+ *
+ * model        - initialized GLMmodel structure (not still streaming)
+ * maxtriangles - largest number of triangles in a meshlet
+ *                (GLM_MESHLET_TRIANGLES)
+ * angle        - largest angle (in degrees) between a facet normal and
+ *                the average one, on a closed surface (GLM_MESHLET_ANGLE)
+ */
+GLuint
+glmBuildMeshlets(GLMmodel* model, GLuint maxtriangles, GLfloat angle)
+{
+    GLMgroup* group;
+    GLubyte* closed;
+    GLuint* local;
+    GLuint nummeshlets;
+
+    assert(model);
+    assert(!model->stream);
+    assert(maxtriangles > 0);
+
+    glmVertices(model);
+    if (!model->facetnorms || model->dirty & GLM_DIRTY_NORMALS)
+        glmFacetNormals(model);
+
+    closed = glmClosedTriangles(model);
+    local = (GLuint*)malloc(sizeof(GLuint) * (model->numvertices + 1));
+    memset(local, 0xff, sizeof(GLuint) * (model->numvertices + 1));
+    nummeshlets = 0;
+    for (group = model->groups; group; group = group->next)
+        nummeshlets += glmMeshletsGroup(model, group, local, closed,
+            maxtriangles, cos(angle * M_PI / 180.0));
+    free(local);
+    free(closed);
+    model->meshletversion = model->version;
+
+    if (model->lod)
+        glmBuildMeshlets(model->lod, maxtriangles, angle);
+
+    return nummeshlets;
+}
+
+/* glmCullBegin: Sets up the culling of the meshlets of a model against
+ * the current OpenGL matrices.
+ *
+ * model - initialized GLMmodel structure
+ * cull  - GLMcull structure to fill in
+ */
+GLboolean
+glmCullBegin(GLMmodel* model, GLMcull* cull)
+{
+    GLfloat modelview[16], projection[16], clip[16];
+    GLfloat a[9], inverse[9], det, length;
+    GLuint i, j, k;
+
+    if (model->stream || model->meshletversion != model->version)
+        return GL_FALSE;
+
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+
+    /* frustum planes in model space, from the rows of projection *
+       modelview (Gribb and Hartmann), normalized so they give
+       distances */
+    for (i = 0; i < 4; i++)
+        for (j = 0; j < 4; j++) {
+            clip[4 * i + j] = 0.0;
+            for (k = 0; k < 4; k++)
+                clip[4 * i + j] += projection[4 * k + j] * modelview[4 * i + k];
+        }
+    for (i = 0; i < 6; i++) {
+        for (k = 0; k < 4; k++)
+            cull->planes[i][k] = clip[4 * k + 3] +
+                (i & 1 ? -clip[4 * k + i / 2] : clip[4 * k + i / 2]);
+        length = sqrt(cull->planes[i][0] * cull->planes[i][0] +
+            cull->planes[i][1] * cull->planes[i][1] +
+            cull->planes[i][2] * cull->planes[i][2]);
+        if (length > 0.0)
+            for (k = 0; k < 4; k++)
+                cull->planes[i][k] /= length;
+    }
+
+    /* the eye (or for a parallel projection the direction of view) in
+       model space, through the inverse of the upper 3x3 of the
+       modelview matrix */
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 3; j++)
+            a[3 * i + j] = modelview[4 * i + j];
+    inverse[0] = a[4] * a[8] - a[5] * a[7];
+    inverse[1] = a[2] * a[7] - a[1] * a[8];
+    inverse[2] = a[1] * a[5] - a[2] * a[4];
+    inverse[3] = a[5] * a[6] - a[3] * a[8];
+    inverse[4] = a[0] * a[8] - a[2] * a[6];
+    inverse[5] = a[2] * a[3] - a[0] * a[5];
+    inverse[6] = a[3] * a[7] - a[4] * a[6];
+    inverse[7] = a[1] * a[6] - a[0] * a[7];
+    inverse[8] = a[0] * a[4] - a[1] * a[3];
+    det = a[0] * inverse[0] + a[3] * inverse[1] + a[6] * inverse[2];
+    cull->perspective = projection[15] == 0.0;
+    cull->backfaces = det != 0.0;
+    if (!cull->backfaces)
+        return GL_TRUE;
+    for (k = 0; k < 3; k++) {
+        if (cull->perspective)
+            cull->eye[k] = -(inverse[k] * modelview[12] +
+                inverse[3 + k] * modelview[13] +
+                inverse[6 + k] * modelview[14]) / det;
+        else
+            cull->eye[k] = -inverse[6 + k] / det;
+    }
+    if (!cull->perspective) {
+        length = sqrt(cull->eye[0] * cull->eye[0] +
+            cull->eye[1] * cull->eye[1] + cull->eye[2] * cull->eye[2]);
+        for (k = 0; k < 3; k++)
+            cull->eye[k] /= length;
+    }
+
+    return GL_TRUE;
+}
+
+/* glmCullMeshlet: Returns GL_TRUE if a meshlet can't be seen (see
+ * glmCullBegin()).
+ *
+ * cull    - GLMcull structure set up by glmCullBegin()
+ * meshlet - meshlet to test
+ */
+GLboolean
+glmCullMeshlet(const GLMcull* cull, const GLMmeshlet* meshlet)
+{
+    GLfloat d[3], distance;
+    GLuint i;
+
+    for (i = 0; i < 6; i++)
+        if (cull->planes[i][0] * meshlet->center[0] +
+            cull->planes[i][1] * meshlet->center[1] +
+            cull->planes[i][2] * meshlet->center[2] +
+            cull->planes[i][3] < -meshlet->radius)
+            return GL_TRUE;
+
+    if (!cull->backfaces || meshlet->cutoff >= 1.0)
+        return GL_FALSE;
+
+    /* the eye is in the cone opposite the normals, behind the apex,
+       so it is behind every triangle */
+    if (!cull->perspective)
+        return cull->eye[0] * meshlet->axis[0] +
+            cull->eye[1] * meshlet->axis[1] +
+            cull->eye[2] * meshlet->axis[2] >= meshlet->cutoff;
+    for (i = 0; i < 3; i++)
+        d[i] = meshlet->apex[i] - cull->eye[i];
+    distance = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    return d[0] * meshlet->axis[0] + d[1] * meshlet->axis[1] +
+        d[2] * meshlet->axis[2] >= meshlet->cutoff * distance;
+}
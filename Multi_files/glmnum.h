@@ -0,0 +1,234 @@
+/*
+      glmnum.h
+
+      Numeric field parsers for the GLM OBJ/MTL readers.
+
+      glmParseFloat() is exact: it returns the same float strtof()
+      would for the same text, but never consults the locale and
+      handles the common case (up to 19 significant digits and a
+      small exponent) without strtof().  Runs of up to eight digits are
+      converted at once with SWAR (SIMD within a register) arithmetic
+      on a 64 bit word instead of one multiply-add per character.
+
+      glmParseInt() is the matching parser for the (possibly
+      negative) indices of face records.
+
+      Both may read up to 8 bytes past the end of the number, so the
+      text must be followed by at least GLM_NUM_PADDING readable bytes
+      (GLMfile data always is).
+
+ */
+
+#ifndef GLMNUM_H_INCLUDED
+#define GLMNUM_H_INCLUDED
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#if defined(__GLIBC__)
+#include <locale.h>
+#elif defined(__APPLE__)
+#include <xlocale.h>
+#endif
+
+#define GLM_NUM_PADDING 8       /* readable bytes needed after a number */
+
+/* powers of ten for scaling by the number of digits converted */
+static const unsigned long long glmTens[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL
+};
+
+
+/* glmDigits8: convert the leading decimal digits of the 8 characters
+ * at p in one go.  Returns the number of leading digits (0 to 8) and
+ * stores their value in *value.
+ */
+static inline unsigned
+glmDigits8(const char* p, unsigned long long* value)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    unsigned long long v, nondigit;
+    unsigned n;
+
+    memcpy(&v, p, 8);
+    v -= 0x3030303030303030ULL;
+
+    /* a byte is not a digit if it wrapped below '0' (high bit set) or
+       is above '9' (adding 0x76 carries into the high bit) */
+    nondigit = (v | (v + 0x7676767676767676ULL)) & 0x8080808080808080ULL;
+    n = nondigit ? __builtin_ctzll(nondigit) >> 3 : 8;
+    if (!n) {
+        *value = 0;
+        return 0;
+    }
+
+    /* move the digits to the top so the bytes below act as leading
+       zeros, then fold pairs, quads and octets of digits together */
+    v <<= 8 * (8 - n);
+    v = v * 10 + (v >> 8);
+    v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+         (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    *value = v;
+    return n;
+#else
+    unsigned long long v = 0;
+    unsigned n;
+
+    for (n = 0; n < 8 && (unsigned)(p[n] - '0') < 10; n++)
+        v = v * 10 + (p[n] - '0');
+    *value = v;
+    return n;
+#endif
+}
+
+/* glmParseFloatSlow: strtof() in the "C" locale, for the rare numbers
+ * the fast path can't round exactly.
+ */
+static inline float
+glmParseFloatSlow(const char* p, const char** end)
+{
+    char* after;
+    float f;
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+    static locale_t c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+    f = strtof_l(p, &after, c_locale);
+#else
+    f = strtof(p, &after);
+#endif
+    *end = after;
+    return f;
+}
+
+/* glmParseFloat: parse a decimal float at p.  Returns 0 and sets *end
+ * to p if there is no number there, exactly like strtof().
+ *
+ * p   - text of the number (no leading blanks)
+ * end - set to the first character after the number
+ */
+static inline float
+glmParseFloat(const char* p, const char** end)
+{
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* s = p;
+    unsigned long long mantissa, chunk, bits;
+    unsigned digits, n;
+    int exponent, e, esign;
+    int negative, any;
+    double d;
+    float f;
+
+    negative = *s == '-';
+    if (*s == '-' || *s == '+')
+        s++;
+
+    /* integer digits, then fraction digits */
+    mantissa = 0;
+    digits = 0;
+    exponent = 0;
+    any = 0;
+    while ((n = glmDigits8(s, &chunk))) {
+        mantissa = mantissa * glmTens[n] + chunk;
+        digits += n;
+        s += n;
+        any = 1;
+        if (n < 8)
+            break;
+    }
+    if (*s == '.') {
+        s++;
+        while ((n = glmDigits8(s, &chunk))) {
+            mantissa = mantissa * glmTens[n] + chunk;
+            digits += n;
+            exponent -= n;
+            s += n;
+            any = 1;
+            if (n < 8)
+                break;
+        }
+    }
+
+    /* no number, inf, nan, hex floats and too many digits to hold */
+    if (!any || digits > 19 || (!mantissa && (*s == 'x' || *s == 'X')))
+        return glmParseFloatSlow(p, end);
+
+    if (*s == 'e' || *s == 'E') {
+        const char* x = s + 1;
+        esign = 1;
+        if (*x == '-' || *x == '+') {
+            esign = *x == '-' ? -1 : 1;
+            x++;
+        }
+        if ((unsigned)(*x - '0') < 10) {
+            e = 0;
+            while ((unsigned)(*x - '0') < 10) {
+                if (e < 100000)
+                    e = e * 10 + (*x - '0');
+                x++;
+            }
+            exponent += esign * e;
+            s = x;
+        }
+    }
+    *end = s;
+
+    if (!mantissa)
+        return negative ? -0.0f : 0.0f;
+
+    /* m and 10^e are exact doubles, so one multiply or divide gives
+       the correctly rounded double.  Rounding that to float again only
+       differs from rounding the exact value when the double landed
+       exactly on a float midpoint (low 29 mantissa bits 1000...0), and
+       only normal floats are handled so the midpoints are on the
+       double grid. */
+    if (mantissa > (1ULL << 53) || exponent < -22 || exponent > 22)
+        return glmParseFloatSlow(p, end);
+    d = (double)mantissa;
+    d = exponent < 0 ? d / powers[-exponent] : d * powers[exponent];
+    memcpy(&bits, &d, 8);
+    if ((bits & 0x1FFFFFFFULL) == 0x10000000ULL || d < FLT_MIN || d > FLT_MAX)
+        return glmParseFloatSlow(p, end);
+    f = (float)d;
+    return negative ? -f : f;
+}
+
+/* glmParseInt: parse a (possibly negative) decimal integer at p.
+ * Returns 0 and sets *end to p if there is no number there.
+ *
+ * p   - text of the number (no leading blanks)
+ * end - set to the first character after the number
+ */
+static inline int
+glmParseInt(const char* p, const char** end)
+{
+    const char* s = p;
+    unsigned long long value, chunk;
+    unsigned n;
+    int negative;
+
+    negative = *s == '-';
+    if (*s == '-' || *s == '+')
+        s++;
+
+    /* indices have fewer than 8 digits unless the mesh is huge, so
+       this is normally a single conversion */
+    n = glmDigits8(s, &value);
+    s += n;
+    if (!n) {
+        *end = p;
+        return 0;
+    }
+    while (n == 8) {
+        n = glmDigits8(s, &chunk);
+        value = value * glmTens[n] + chunk;
+        s += n;
+    }
+    *end = s;
+    return negative ? -(int)value : (int)value;
+}
+
+#endif
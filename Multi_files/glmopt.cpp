@@ -0,0 +1,534 @@
+/*
+      glmopt.cpp
+
+      Mesh optimization passes for the GLM library.
+
+      glmOptimizeVertexCache() reorders the triangles of each group so
+      that consecutive triangles share vertices, using the Tipsify
+      algorithm (Sander, Nehab and Barczak, "Fast Triangle Reordering
+      for Vertex Locality and Reduced Overdraw", 2007).  It runs in time
+      linear in the number of triangles and is tuned for a FIFO post
+      transform cache of a given size, the kind glmCacheMissRatio()
+      simulates.  Only the draw order (the triangles array of each
+      group) changes; the triangles themselves, their vertices and
+      their normals keep their indices.
+
+      glmOptimizeOverdraw() then cuts each group into clusters of
+      triangles, at points where the cache starts over anyway, and
+      sorts the clusters so the ones facing away from the middle of the
+      group are drawn first.  From most viewpoints those are in front,
+      so fewer hidden fragments get shaded (the same paper; the
+      clustering follows meshoptimizer's optimizeOverdraw).
+
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "glm.h"
+#include "glmint.h"
+
+
+#define T(x) (model->triangles[(x)])
+
+#define GLM_OPT_NONE ((GLuint)-1)       /* model vertex not in the group */
+
+
+/* GLMtipsify: state of the Tipsify pass over one group.  The vertices
+ * of the group are numbered from 0 in order of first use, so all the
+ * arrays are sized by the group, not by the model.
+ */
+typedef struct _GLMtipsify {
+  GLuint  numvertices;          /* vertices used by the group */
+  GLuint* vertices;             /* group vertex -> model vertex */
+  GLuint* corners;              /* group vertex of each triangle corner */
+  GLuint* live;                 /* triangles still to emit, per vertex */
+  GLuint* stamps;               /* time each vertex last entered the cache */
+  GLuint* offsets;              /* first entry of each vertex in adjacency */
+  GLuint* adjacency;            /* triangles (group positions) per vertex */
+  GLuint* deadends;             /* stack of recently used vertices */
+  GLuint  numdeadends;
+  GLubyte* emitted;             /* triangle already in the new order */
+} GLMtipsify;
+
+
+/* GLMcluster: a run of consecutive triangles of a group that
+ * glmOptimizeOverdraw() keeps together.
+ */
+typedef struct _GLMcluster {
+  GLuint  begin;                /* first triangle (position in the group) */
+  GLuint  end;                  /* one past the last */
+  GLfloat key;                  /* larger keys are drawn first */
+} GLMcluster;
+
+
+/* glmCacheUpdate: run the corners of a triangle through a simulated
+ * FIFO cache of cachesize entries and return how many missed.  time
+ * only advances on misses, so a vertex is in the cache while
+ * time - stamps[vertex] <= cachesize; adding cachesize + 1 to time
+ * empties the cache.
+ */
+static GLuint
+glmCacheUpdate(GLMmodel* model, GLuint triangle, GLuint* stamps,
+               GLuint* time, GLuint cachesize)
+{
+    GLuint j, v, misses;
+
+    misses = 0;
+    for (j = 0; j < 3; j++) {
+        v = T(triangle).vindices[j];
+        if (*time - stamps[v] > cachesize) {
+            stamps[v] = (*time)++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+/* glmTipsifyBuild: number the vertices of a group and build the list
+ * of triangles each one is in.  local maps model vertices to group
+ * vertices and must be all GLM_OPT_NONE; it is left that way.
+ */
+static GLvoid
+glmTipsifyBuild(GLMmodel* model, GLMgroup* group, GLuint* local,
+                GLMtipsify* tip)
+{
+    GLuint i, j, v, numcorners;
+
+    numcorners = 3 * group->numtriangles;
+    tip->vertices  = (GLuint*)malloc(sizeof(GLuint) * numcorners);
+    tip->corners   = (GLuint*)malloc(sizeof(GLuint) * numcorners);
+    tip->live      = (GLuint*)calloc(numcorners, sizeof(GLuint));
+    tip->stamps    = (GLuint*)calloc(numcorners, sizeof(GLuint));
+    tip->offsets   = (GLuint*)malloc(sizeof(GLuint) * (numcorners + 1));
+    tip->adjacency = (GLuint*)malloc(sizeof(GLuint) * numcorners);
+    tip->deadends  = (GLuint*)malloc(sizeof(GLuint) * numcorners);
+    tip->emitted   = (GLubyte*)calloc(group->numtriangles, sizeof(GLubyte));
+    tip->numvertices = 0;
+    tip->numdeadends = 0;
+
+    /* number the vertices in order of first use, and count how many
+       triangles each one is in */
+    for (i = 0; i < group->numtriangles; i++) {
+        for (j = 0; j < 3; j++) {
+            v = T(group->triangles[i]).vindices[j];
+            if (local[v] == GLM_OPT_NONE) {
+                local[v] = tip->numvertices;
+                tip->vertices[tip->numvertices++] = v;
+            }
+            tip->corners[3 * i + j] = local[v];
+            tip->live[local[v]]++;
+        }
+    }
+
+    /* then list the triangles of each vertex (a triangle that uses a
+       vertex twice is listed twice, which is harmless) */
+    tip->offsets[0] = 0;
+    for (v = 0; v < tip->numvertices; v++)
+        tip->offsets[v + 1] = tip->offsets[v] + tip->live[v];
+    for (i = 0; i < numcorners; i++)
+        tip->adjacency[tip->offsets[tip->corners[i]]++] = i / 3;
+    for (v = tip->numvertices; v > 0; v--)
+        tip->offsets[v] = tip->offsets[v - 1];
+    tip->offsets[0] = 0;
+
+    for (v = 0; v < tip->numvertices; v++)
+        local[tip->vertices[v]] = GLM_OPT_NONE;
+}
+
+/* glmTipsifyFree: release the arrays of a Tipsify pass */
+static GLvoid
+glmTipsifyFree(GLMtipsify* tip)
+{
+    free(tip->vertices);
+    free(tip->corners);
+    free(tip->live);
+    free(tip->stamps);
+    free(tip->offsets);
+    free(tip->adjacency);
+    free(tip->deadends);
+    free(tip->emitted);
+}
+
+/* glmTipsifyGroup: reorder the triangles of a group for a FIFO vertex
+ * cache of cachesize entries.
+ */
+static GLvoid
+glmTipsifyGroup(GLMmodel* model, GLMgroup* group, GLuint* local,
+                GLuint cachesize)
+{
+    GLMtipsify tip;
+    GLuint* order;
+    GLuint i, j, t, v, time, next, first, cursor, numordered;
+    GLuint priority, best;
+    GLint fan;
+
+    if (group->numtriangles < 2)
+        return;
+
+    /* if all the vertices fit in the cache, every order misses each
+       of them once: keep the order the file has */
+    glmTipsifyBuild(model, group, local, &tip);
+    if (tip.numvertices <= cachesize) {
+        glmTipsifyFree(&tip);
+        return;
+    }
+    order = (GLuint*)malloc(sizeof(GLuint) * group->numtriangles);
+    numordered = 0;
+
+    /* time only advances on cache misses, so a vertex is still in the
+       cache while time - stamp <= cachesize */
+    time = cachesize + 1;
+    cursor = 0;
+    fan = 0;
+    while (fan >= 0) {
+        /* emit every triangle left around the fanning vertex */
+        first = tip.numdeadends;
+        for (i = tip.offsets[fan]; i < tip.offsets[fan + 1]; i++) {
+            t = tip.adjacency[i];
+            if (tip.emitted[t])
+                continue;
+            tip.emitted[t] = 1;
+            order[numordered++] = group->triangles[t];
+            for (j = 0; j < 3; j++) {
+                v = tip.corners[3 * t + j];
+                tip.deadends[tip.numdeadends++] = v;
+                tip.live[v]--;
+                if (time - tip.stamps[v] > cachesize)
+                    tip.stamps[v] = time++;
+            }
+        }
+
+        /* fan around the neighbour that will still be in the cache
+           after its remaining triangles are emitted, preferring the
+           one that entered the cache first */
+        fan = -1;
+        best = 0;
+        for (i = first; i < tip.numdeadends; i++) {
+            v = tip.deadends[i];
+            if (!tip.live[v])
+                continue;
+            priority = 0;
+            if (time - tip.stamps[v] + 2 * tip.live[v] <= cachesize)
+                priority = time - tip.stamps[v];
+            if (fan < 0 || priority > best) {
+                fan = v;
+                best = priority;
+            }
+        }
+        if (fan >= 0)
+            continue;
+
+        /* dead end: go back to a recently used vertex, or failing that
+           to the next one in input order */
+        while (tip.numdeadends) {
+            next = tip.deadends[--tip.numdeadends];
+            if (tip.live[next]) {
+                fan = next;
+                break;
+            }
+        }
+        while (fan < 0 && cursor < tip.numvertices) {
+            if (tip.live[cursor])
+                fan = cursor;
+            cursor++;
+        }
+    }
+
+    assert(numordered == group->numtriangles);
+    memcpy(group->triangles, order, sizeof(GLuint) * numordered);
+
+    free(order);
+    glmTipsifyFree(&tip);
+}
+
+
+/* glmTriangleArea: add the area weighted center and the (area
+ * weighted) normal of a triangle to center and normal, and return
+ * the weight (twice its area).
+ */
+static GLfloat
+glmTriangleArea(GLMmodel* model, GLuint triangle, GLfloat* center,
+                GLfloat* normal)
+{
+    GLfloat* a;
+    GLfloat* b;
+    GLfloat* c;
+    GLfloat u[3], v[3], n[3];
+    GLfloat area;
+    GLuint j;
+
+    a = &model->vertices[3 * T(triangle).vindices[0]];
+    b = &model->vertices[3 * T(triangle).vindices[1]];
+    c = &model->vertices[3 * T(triangle).vindices[2]];
+    for (j = 0; j < 3; j++) {
+        u[j] = b[j] - a[j];
+        v[j] = c[j] - a[j];
+    }
+    n[0] = u[1]*v[2] - u[2]*v[1];
+    n[1] = u[2]*v[0] - u[0]*v[2];
+    n[2] = u[0]*v[1] - u[1]*v[0];
+    area = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    for (j = 0; j < 3; j++) {
+        center[j] += (a[j] + b[j] + c[j]) / 3.0 * area;
+        normal[j] += n[j];
+    }
+    return area;
+}
+
+/* glmClusterKey: the outside-in sort key of a cluster, the distance
+ * of its centroid from the centroid of the group along its average
+ * normal (both weighted by area).
+ */
+static GLfloat
+glmClusterKey(GLMmodel* model, GLMgroup* group, GLMcluster* cluster,
+              const GLfloat* centroid)
+{
+    GLfloat center[3], normal[3];
+    GLfloat total, length, key;
+    GLuint i, j;
+
+    total = 0.0;
+    for (j = 0; j < 3; j++)
+        center[j] = normal[j] = 0.0;
+    for (i = cluster->begin; i < cluster->end; i++)
+        total += glmTriangleArea(model, group->triangles[i], center, normal);
+
+    length = sqrt(normal[0]*normal[0] + normal[1]*normal[1] +
+        normal[2]*normal[2]);
+    if (total == 0.0 || length == 0.0)
+        return 0.0;
+    key = 0.0;
+    for (j = 0; j < 3; j++)
+        key += (center[j] / total - centroid[j]) * normal[j] / length;
+
+    /* NaN's would upset the sort */
+    return key == key ? key : 0.0;
+}
+
+/* glmClusterCompare: qsort() order of clusters, larger keys first and
+ * otherwise in their original order */
+static int
+glmClusterCompare(const void* a, const void* b)
+{
+    const GLMcluster* ca = (const GLMcluster*)a;
+    const GLMcluster* cb = (const GLMcluster*)b;
+
+    if (ca->key != cb->key)
+        return ca->key > cb->key ? -1 : 1;
+    return ca->begin < cb->begin ? -1 : ca->begin > cb->begin;
+}
+
+/* glmOverdrawGroup: cut a group into clusters and sort them
+ * outside-in.  A new hard cluster starts wherever a triangle misses
+ * the cache with all three vertices (the vertex cache order jumped to
+ * another part of the mesh); those are cut further wherever the miss
+ * ratio so far gets down to threshold times that of the whole hard
+ * cluster, starting with an empty cache each time, so the cuts cost
+ * at most about that much cache efficiency.
+ */
+static GLvoid
+glmOverdrawGroup(GLMmodel* model, GLMgroup* group, GLuint* stamps,
+                 GLuint* time, GLuint cachesize, GLfloat threshold)
+{
+    GLMcluster* clusters;
+    GLuint* hard;
+    GLuint* order;
+    GLuint i, h, k, start, misses, numhard, numclusters, first;
+    GLfloat centroid[3], normal[3];
+    GLfloat limit, total;
+
+    if (group->numtriangles < 2)
+        return;
+
+    /* hard boundaries */
+    hard = (GLuint*)malloc(sizeof(GLuint) * (group->numtriangles + 1));
+    numhard = 0;
+    *time += cachesize + 1;
+    for (i = 0; i < group->numtriangles; i++)
+        if (glmCacheUpdate(model, group->triangles[i], stamps, time,
+                cachesize) == 3 || i == 0)
+            hard[numhard++] = i;
+    hard[numhard] = group->numtriangles;
+
+    /* soft boundaries inside each hard cluster */
+    clusters = (GLMcluster*)malloc(sizeof(GLMcluster) * group->numtriangles);
+    numclusters = 0;
+    for (h = 0; h < numhard; h++) {
+        *time += cachesize + 1;
+        misses = 0;
+        for (i = hard[h]; i < hard[h + 1]; i++)
+            misses += glmCacheUpdate(model, group->triangles[i], stamps,
+                time, cachesize);
+        limit = threshold * misses / (hard[h + 1] - hard[h]);
+
+        *time += cachesize + 1;
+        first = numclusters;
+        start = hard[h];
+        misses = 0;
+        for (i = hard[h]; i < hard[h + 1]; i++) {
+            misses += glmCacheUpdate(model, group->triangles[i], stamps,
+                time, cachesize);
+            if ((GLfloat)misses / (i - start + 1) <= limit) {
+                clusters[numclusters].begin = start;
+                clusters[numclusters].end = i + 1;
+                numclusters++;
+                start = i + 1;
+                misses = 0;
+                *time += cachesize + 1;
+            }
+        }
+
+        /* the tail never got down to the limit: fold it into the
+           cluster before it */
+        if (start < hard[h + 1]) {
+            if (numclusters > first) {
+                clusters[numclusters - 1].end = hard[h + 1];
+            } else {
+                clusters[numclusters].begin = start;
+                clusters[numclusters].end = hard[h + 1];
+                numclusters++;
+            }
+        }
+    }
+
+    /* sort them outside-in, from the centroid of the surface of the
+       group (each group is drawn on its own) */
+    total = 0.0;
+    for (k = 0; k < 3; k++)
+        centroid[k] = normal[k] = 0.0;
+    for (i = 0; i < group->numtriangles; i++)
+        total += glmTriangleArea(model, group->triangles[i], centroid, normal);
+    if (total > 0.0)
+        for (k = 0; k < 3; k++)
+            centroid[k] /= total;
+    for (k = 0; k < numclusters; k++)
+        clusters[k].key = glmClusterKey(model, group, &clusters[k], centroid);
+    qsort(clusters, numclusters, sizeof(GLMcluster), glmClusterCompare);
+
+    order = (GLuint*)malloc(sizeof(GLuint) * group->numtriangles);
+    i = 0;
+    for (k = 0; k < numclusters; k++)
+        for (h = clusters[k].begin; h < clusters[k].end; h++)
+            order[i++] = group->triangles[h];
+    assert(i == group->numtriangles);
+    memcpy(group->triangles, order, sizeof(GLuint) * group->numtriangles);
+
+    free(order);
+    free(clusters);
+    free(hard);
+}
+
+/* glmReordered: free the meshlets and index array of a group whose
+ * triangles were reordered, since they no longer match the order */
+static GLvoid
+glmReordered(GLMmodel* model, GLMgroup* group)
+{
+    glmFree(model, group->meshlets);
+    group->nummeshlets = 0;
+    group->meshlets = NULL;
+    glmFree(model, group->indices);
+    group->indices = NULL;
+}
+
+
+/* glmCacheMissRatio: Returns the average cache miss ratio (ACMR) of
+ * drawing a model: the number of vertices a FIFO post transform cache
+ * of cachesize entries misses, per triangle.
+ *
+ * model     - initialized GLMmodel structure
+ * cachesize - number of entries in the cache
+ */
+GLfloat
+glmCacheMissRatio(GLMmodel* model, GLuint cachesize)
+{
+    GLMgroup* group;
+    GLuint* stamps;
+    GLuint i, time, misses, numtriangles;
+
+    assert(model);
+    assert(cachesize > 0);
+
+    /* each group is a separate draw and starts with an empty cache */
+    stamps = (GLuint*)calloc(model->numvertices + 1, sizeof(GLuint));
+    time = 0;
+    misses = 0;
+    numtriangles = 0;
+    for (group = model->groups; group; group = group->next) {
+        time += cachesize + 1;
+        for (i = 0; i < group->numtriangles; i++)
+            misses += glmCacheUpdate(model, group->triangles[i], stamps,
+                &time, cachesize);
+        numtriangles += group->numtriangles;
+    }
+    free(stamps);
+
+    return numtriangles ? (GLfloat)misses / numtriangles : 0.0;
+}
+
+/* glmOptimizeVertexCache: Reorders the triangles of each group of a
+ * model for a post transform vertex cache of cachesize entries.
+ * Returns the average cache miss ratio afterwards.
+ *
+ * model     - initialized GLMmodel structure (not still streaming)
+ * cachesize - number of entries in the cache (GLM_VERTEX_CACHE)
+ */
+GLfloat
+glmOptimizeVertexCache(GLMmodel* model, GLuint cachesize)
+{
+    GLMgroup* group;
+    GLuint* local;
+
+    assert(model);
+    assert(!model->stream);
+    assert(cachesize > 0);
+
+    local = (GLuint*)malloc(sizeof(GLuint) * (model->numvertices + 1));
+    memset(local, 0xff, sizeof(GLuint) * (model->numvertices + 1));
+    for (group = model->groups; group; group = group->next) {
+        glmTipsifyGroup(model, group, local, cachesize);
+        glmReordered(model, group);
+    }
+    model->indexedversion = 0;          /* the index arrays are gone */
+    free(local);
+
+    return glmCacheMissRatio(model, cachesize);
+}
+
+/* glmOptimizeOverdraw: Sorts clusters of the triangles of each group
+ * of a model outside-in, to cut overdraw, while keeping the vertex
+ * cache order inside each cluster.  Returns the average cache miss
+ * ratio afterwards.
+ *
+ * model     - initialized GLMmodel structure (not still streaming)
+ * cachesize - number of entries in the cache (GLM_VERTEX_CACHE)
+ * threshold - cache miss ratio the clusters may cost, as a factor
+ *             (GLM_OVERDRAW_THRESHOLD)
+ */
+GLfloat
+glmOptimizeOverdraw(GLMmodel* model, GLuint cachesize, GLfloat threshold)
+{
+    GLMgroup* group;
+    GLuint* stamps;
+    GLuint time;
+
+    assert(model);
+    assert(!model->stream);
+    assert(cachesize > 0);
+
+    glmVertices(model);
+
+    stamps = (GLuint*)calloc(model->numvertices + 1, sizeof(GLuint));
+    time = 0;
+    for (group = model->groups; group; group = group->next) {
+        glmOverdrawGroup(model, group, stamps, &time, cachesize, threshold);
+        glmReordered(model, group);
+    }
+    model->indexedversion = 0;          /* the index arrays are gone */
+    free(stamps);
+
+    return glmCacheMissRatio(model, cachesize);
+}
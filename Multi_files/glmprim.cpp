@@ -0,0 +1,271 @@
+/*
+      glmprim.cpp
+
+      Primitive shapes for the GLM library.
+
+      glutSolidSphere() works out its sines and cosines and sends every
+      vertex through immediate mode each time it is called, and
+      glutSolidCube() isn't much better.  glmPrimitive() instead makes
+      each shape once, the first time it is asked for, and keeps it in
+      buffer objects: a unit cube (a box is the cube under glScalef())
+      and a unit sphere at a few tessellations.  glmDrawPrimitive()
+      draws the coarsest tessellation that is within a number of pixels
+      of the true shape where it is on screen, the way glmLOD() picks a
+      level of a model.
+
+ */
+
+
+#define GL_GLEXT_PROTOTYPES             /* buffer objects (OpenGL 1.5) */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "glm.h"
+#include "glmint.h"
+
+
+/* slices (and stacks) of each level of the sphere, finest first; the
+   finest is what glutSolidSphere(1.0, 20, 20) was drawn with */
+static const GLuint glm_sphere_slices[GLM_PRIMITIVE_LEVELS] = { 20, 14, 10, 6 };
+
+/* the primitives made so far, by shape */
+static GLMprimitive* glm_primitives[GLM_NUMPRIMITIVES];
+
+
+/* glmPrimitiveVertex: append a vertex, its normal and position */
+static GLvoid
+glmPrimitiveVertex(GLMprimitive* primitive, const GLfloat* normal,
+    const GLfloat* position)
+{
+    GLfloat* v;
+
+    v = &primitive->vertices[6 * primitive->numvertices++];
+    v[0] = normal[0];
+    v[1] = normal[1];
+    v[2] = normal[2];
+    v[3] = position[0];
+    v[4] = position[1];
+    v[5] = position[2];
+}
+
+/* glmPrimitiveTriangle: append a triangle */
+static GLvoid
+glmPrimitiveTriangle(GLMprimitive* primitive, GLuint a, GLuint b, GLuint c)
+{
+    primitive->indices[primitive->numindices++] = a;
+    primitive->indices[primitive->numindices++] = b;
+    primitive->indices[primitive->numindices++] = c;
+}
+
+/* glmPrimitiveCube: the cube glutSolidCube(1.0) draws, four vertices
+ * and two triangles a face */
+static GLvoid
+glmPrimitiveCube(GLMprimitive* primitive)
+{
+    GLfloat corner[3], n[3], u[3], w[3];
+    GLuint axis, side, i, j, first;
+    static const GLfloat su[4] = { -1, 1, 1, -1 };
+    static const GLfloat sw[4] = { -1, -1, 1, 1 };
+
+    primitive->vertices = (GLfloat*)malloc(sizeof(GLfloat) * 6 * 24);
+    primitive->indices = (GLushort*)malloc(sizeof(GLushort) * 36);
+
+    /* counterclockwise seen from outside: the corners go around u and
+       w, with u x w the face normal */
+    for (axis = 0; axis < 3; axis++) {
+        for (side = 0; side < 2; side++) {
+            memset(n, 0, sizeof(n));
+            memset(u, 0, sizeof(u));
+            memset(w, 0, sizeof(w));
+            n[axis] = side ? -1.0 : 1.0;
+            u[(axis + (side ? 2 : 1)) % 3] = 1.0;
+            w[(axis + (side ? 1 : 2)) % 3] = 1.0;
+            first = primitive->numvertices;
+            for (i = 0; i < 4; i++) {
+                for (j = 0; j < 3; j++)
+                    corner[j] = 0.5 * (n[j] + su[i] * u[j] + sw[i] * w[j]);
+                glmPrimitiveVertex(primitive, n, corner);
+            }
+            glmPrimitiveTriangle(primitive, first, first + 1, first + 2);
+            glmPrimitiveTriangle(primitive, first, first + 2, first + 3);
+        }
+    }
+
+    primitive->numlevels = 1;
+    primitive->first[0] = 0;
+    primitive->count[0] = 36;
+    primitive->error[0] = 0.0;
+    primitive->radius = sqrt(0.75);
+}
+
+/* glmPrimitiveSphere: the unit sphere at each tessellation, with its
+ * poles on the z axis like glutSolidSphere() */
+static GLvoid
+glmPrimitiveSphere(GLMprimitive* primitive)
+{
+    GLfloat p[3], phi, theta;
+    GLuint level, n, i, j, a, b, numvertices, numindices;
+
+    numvertices = numindices = 0;
+    for (level = 0; level < GLM_PRIMITIVE_LEVELS; level++) {
+        n = glm_sphere_slices[level];
+        numvertices += (n + 1) * (n + 1);
+        numindices += 6 * n * (n - 1);
+    }
+    assert(numvertices <= 65536);
+    primitive->vertices = (GLfloat*)malloc(sizeof(GLfloat) * 6 * numvertices);
+    primitive->indices = (GLushort*)malloc(sizeof(GLushort) * numindices);
+
+    for (level = 0; level < GLM_PRIMITIVE_LEVELS; level++) {
+        n = glm_sphere_slices[level];
+        primitive->first[level] = primitive->numindices;
+
+        /* n stacks from the +z pole down, n slices around; the normal
+           of a point of the unit sphere is the point */
+        a = primitive->numvertices;
+        for (i = 0; i <= n; i++) {
+            phi = M_PI * i / n;
+            for (j = 0; j <= n; j++) {
+                theta = 2.0 * M_PI * j / n;
+                p[0] = sin(phi) * cos(theta);
+                p[1] = sin(phi) * sin(theta);
+                p[2] = cos(phi);
+                glmPrimitiveVertex(primitive, p, p);
+            }
+        }
+
+        /* two triangles a quad, less the ones that would have no area
+           at the poles */
+        for (i = 0; i < n; i++) {
+            for (j = 0; j < n; j++) {
+                b = a + i * (n + 1) + j;
+                if (i != n - 1)
+                    glmPrimitiveTriangle(primitive, b, b + n + 1, b + n + 2);
+                if (i != 0)
+                    glmPrimitiveTriangle(primitive, b, b + n + 2, b + 1);
+            }
+        }
+
+        primitive->count[level] = primitive->numindices - primitive->first[level];
+        /* the middle of a face is the farthest from the sphere */
+        primitive->error[level] = 1.0 - cos(M_PI / n) * cos(M_PI / (2 * n));
+    }
+
+    primitive->numlevels = GLM_PRIMITIVE_LEVELS;
+    primitive->radius = 1.0;
+}
+
+/* glmPrimitive: Returns a primitive shape, making it (and its buffers)
+ * the first time it is asked for.
+ *
+ * shape - GLM_CUBE or GLM_SPHERE
+ */
+GLMprimitive*
+glmPrimitive(GLuint shape)
+{
+    GLMprimitive* primitive;
+
+    assert(shape < GLM_NUMPRIMITIVES);
+
+    if (glm_primitives[shape])
+        return glm_primitives[shape];
+
+    primitive = (GLMprimitive*)malloc(sizeof(GLMprimitive));
+    memset(primitive, 0, sizeof(GLMprimitive));
+    if (shape == GLM_CUBE)
+        glmPrimitiveCube(primitive);
+    else
+        glmPrimitiveSphere(primitive);
+
+    glGenBuffers(1, &primitive->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, primitive->vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 *
+        primitive->numvertices, primitive->vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glGenBuffers(1, &primitive->ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, primitive->ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) *
+        primitive->numindices, primitive->indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glm_primitives[shape] = primitive;
+    return primitive;
+}
+
+/* glmPrimitiveLevel: Returns the level of a primitive to draw with the
+ * current OpenGL matrices and viewport.
+ *
+ * primitive - primitive returned by glmPrimitive()
+ * pixels    - largest error allowed, in pixels (GLM_LOD_PIXELS)
+ */
+GLuint
+glmPrimitiveLevel(GLMprimitive* primitive, GLfloat pixels)
+{
+    static const GLfloat origin[3] = { 0.0, 0.0, 0.0 };
+    GLfloat perpixel;
+    GLuint level;
+
+    assert(primitive);
+
+    if (primitive->numlevels == 1)
+        return 0;
+    perpixel = glmPixelsPerUnit(origin, primitive->radius);
+    if (perpixel == 0.0)
+        return 0;               /* the eye is in (or near) it */
+
+    level = 0;
+    while (level + 1 < primitive->numlevels &&
+           primitive->error[level + 1] * perpixel <= pixels)
+        level++;
+    return level;
+}
+
+/* glmDrawPrimitive: Draws a primitive, at the level glmPrimitiveLevel()
+ * picks.
+ *
+ * shape  - GLM_CUBE or GLM_SPHERE
+ * pixels - largest error allowed, in pixels (GLM_LOD_PIXELS)
+ */
+GLvoid
+glmDrawPrimitive(GLuint shape, GLfloat pixels)
+{
+    GLMprimitive* primitive;
+    GLuint level;
+
+    primitive = glmPrimitive(shape);
+    level = glmPrimitiveLevel(primitive, pixels);
+
+    glBindBuffer(GL_ARRAY_BUFFER, primitive->vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, primitive->ibo);
+    glInterleavedArrays(GL_N3F_V3F, 0, NULL);
+    glDrawElements(GL_TRIANGLES, primitive->count[level], GL_UNSIGNED_SHORT,
+        (const GLvoid*)(sizeof(GLushort) * primitive->first[level]));
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/* glmDeletePrimitives: Deletes the primitives made so far (and their
+ * buffers), say before the OpenGL context goes away.
+ */
+GLvoid
+glmDeletePrimitives(GLvoid)
+{
+    GLMprimitive* primitive;
+    GLuint i;
+
+    for (i = 0; i < GLM_NUMPRIMITIVES; i++) {
+        primitive = glm_primitives[i];
+        if (!primitive)
+            continue;
+        glDeleteBuffers(1, &primitive->vbo);
+        glDeleteBuffers(1, &primitive->ibo);
+        free(primitive->vertices);
+        free(primitive->indices);
+        free(primitive);
+        glm_primitives[i] = NULL;
+    }
+}
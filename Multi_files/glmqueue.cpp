@@ -0,0 +1,394 @@
+/*
+      glmqueue.cpp
+
+      Render queue for the GLM library.
+
+      Instead of drawing things in the order the program walks its
+      scene, it can queue them: each group of a mesh, or anything else
+      drawn by a callback, becomes an item that remembers the modelview
+      matrix it was queued with and the state it needs (texture,
+      material, color).  glmQueueFlush() sorts the items on a 64 bit
+      key and draws them in that order, so items that share state are
+      drawn one after another and opaque ones front to back, which lets
+      the depth test reject more of the later ones.
+
+      The key, from the most significant bit down:
+
+          pass      2 bits   GLM_QUEUE_OPAQUE, then GLM_QUEUE_BLEND
+          texture   8 bits   2D texture (0 for none)
+          state    14 bits   (material, color) pair, numbered afresh each
+                             frame (past 0x3fff they all share the last)
+          depth    16 bits   eye distance (the top bits of its float),
+                             reversed in the blend pass
+          item     24 bits   index of the item
+
+      and it is sorted with a radix sort on the top 40 bits (the item
+      bits are already in order).  The items and keys of a frame come
+      from an arena that glmQueueBegin() resets, so once the queue has
+      seen its biggest frame it doesn't allocate any more.
+
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "glm.h"
+#include "glmint.h"
+
+
+#define GLM_QUEUE_ITEMS 256     /* items a queue has room for at first */
+
+#define GLM_KEY_PASS    62      /* shift of each field of the sort key */
+#define GLM_KEY_TEXTURE 54
+#define GLM_KEY_STATE   40
+#define GLM_KEY_DEPTH   24
+#define GLM_KEY_ITEM    0xffffffull
+#define GLM_KEY_STATES  0x3fff  /* states numbered apart in a frame */
+
+
+/* glmQueueState: the number of the (material, color) pair of an item,
+ * numbering it if it is new (GLM_KEY_STATES for any after the first
+ * GLM_KEY_STATES of a frame) */
+static GLuint
+glmQueueState(GLMqueue* queue, const GLMitem* item)
+{
+    GLMqueuestate* state;
+    GLuint i;
+
+    for (i = 0; i < queue->numstates; i++) {
+        state = &queue->states[i];
+        if (state->material == item->material &&
+            state->colored == item->colored &&
+            (!item->colored ||
+             !memcmp(state->color, item->color, sizeof(GLfloat) * 4)))
+            return i;
+    }
+
+    if (queue->numstates == GLM_KEY_STATES)
+        return GLM_KEY_STATES;
+    if (queue->numstates == queue->maxstates) {
+        queue->maxstates = queue->maxstates ? 2 * queue->maxstates : 64;
+        queue->states = (GLMqueuestate*)realloc(queue->states,
+            sizeof(GLMqueuestate) * queue->maxstates);
+    }
+    state = &queue->states[queue->numstates];
+    state->material = item->material;
+    state->colored = item->colored;
+    memcpy(state->color, item->color, sizeof(GLfloat) * 4);
+    return queue->numstates++;
+}
+
+/* glmQueueItem: a new item of the current frame, with the current
+ * modelview matrix */
+static GLMitem*
+glmQueueItem(GLMqueue* queue)
+{
+    GLMitem* items;
+    unsigned long long* keys;
+
+    /* out of room: move to arrays twice as big (the old ones go when
+       the arena is reset) */
+    if (queue->numitems == queue->maxitems) {
+        assert(queue->maxitems < GLM_KEY_ITEM);
+        queue->maxitems *= 2;
+        items = (GLMitem*)glmArenaAlloc(queue->arena,
+            sizeof(GLMitem) * queue->maxitems);
+        keys = (unsigned long long*)glmArenaAlloc(queue->arena,
+            sizeof(unsigned long long) * queue->maxitems);
+        memcpy(items, queue->items, sizeof(GLMitem) * queue->numitems);
+        memcpy(keys, queue->keys,
+            sizeof(unsigned long long) * queue->numitems);
+        queue->items = items;
+        queue->keys = keys;
+    }
+
+    glGetFloatv(GL_MODELVIEW_MATRIX, queue->items[queue->numitems].matrix);
+    return &queue->items[queue->numitems];
+}
+
+/* glmQueueKey: give the newest item its sort key and count it */
+static GLvoid
+glmQueueKey(GLMqueue* queue, GLuint pass, const GLfloat* center)
+{
+    GLMitem* item;
+    GLfloat depth;
+    GLuint bits, texture, state;
+
+    item = &queue->items[queue->numitems];
+
+    /* the top 16 bits of a positive float sort like the float */
+    depth = -item->matrix[14];
+    if (center)
+        depth -= item->matrix[2] * center[0] + item->matrix[6] * center[1] +
+            item->matrix[10] * center[2];
+    if (depth < 0.0)
+        depth = 0.0;
+    memcpy(&bits, &depth, sizeof(bits));
+    bits >>= 16;
+    if (pass == GLM_QUEUE_BLEND)
+        bits = 0xffff - bits;
+
+    texture = item->texture < 0xff ? item->texture : 0xff;
+    state = glmQueueState(queue, item);
+
+    queue->keys[queue->numitems] =
+        (unsigned long long)pass << GLM_KEY_PASS |
+        (unsigned long long)texture << GLM_KEY_TEXTURE |
+        (unsigned long long)state << GLM_KEY_STATE |
+        (unsigned long long)bits << GLM_KEY_DEPTH |
+        queue->numitems;
+    queue->numitems++;
+}
+
+/* glmQueueSort: radix sort the keys of the items on their top 40 bits,
+ * a byte at a time, skipping the bytes all keys share */
+static unsigned long long*
+glmQueueSort(unsigned long long* keys, unsigned long long* temp, GLuint n)
+{
+    unsigned long long* swap;
+    GLuint counts[256], shift, i, sum, count;
+
+    for (shift = GLM_KEY_DEPTH; shift < 64; shift += 8) {
+        memset(counts, 0, sizeof(counts));
+        for (i = 0; i < n; i++)
+            counts[(keys[i] >> shift) & 0xff]++;
+        if (counts[(keys[0] >> shift) & 0xff] == n)
+            continue;
+
+        for (i = 0, sum = 0; i < 256; i++) {
+            count = counts[i];
+            counts[i] = sum;
+            sum += count;
+        }
+        for (i = 0; i < n; i++)
+            temp[counts[(keys[i] >> shift) & 0xff]++] = keys[i];
+        swap = keys;
+        keys = temp;
+        temp = swap;
+    }
+
+    return keys;
+}
+
+/* glmNewQueue: Makes an empty render queue.
+ */
+GLMqueue*
+glmNewQueue(GLvoid)
+{
+    GLMqueue* queue;
+
+    queue = (GLMqueue*)malloc(sizeof(GLMqueue));
+    queue->arena = glmArenaCreate();
+    queue->items = NULL;
+    queue->keys = NULL;
+    queue->numitems = 0;
+    queue->maxitems = GLM_QUEUE_ITEMS;
+    queue->numstates = 0;
+    queue->maxstates = 0;
+    queue->states = NULL;
+
+    return queue;
+}
+
+/* glmQueueBegin: Empties a render queue for a new frame.
+ *
+ * queue - render queue made by glmNewQueue()
+ */
+GLvoid
+glmQueueBegin(GLMqueue* queue)
+{
+    assert(queue);
+
+    glmArenaReset(queue->arena);
+    queue->items = (GLMitem*)glmArenaAlloc(queue->arena,
+        sizeof(GLMitem) * queue->maxitems);
+    queue->keys = (unsigned long long*)glmArenaAlloc(queue->arena,
+        sizeof(unsigned long long) * queue->maxitems);
+    queue->numitems = 0;
+    queue->numstates = 0;
+}
+
+/* glmQueueMesh: Queues the groups of a mesh, drawn with the current
+ * modelview matrix, in the opaque pass.
+ *
+ * queue - render queue made by glmNewQueue()
+ * mesh  - mesh made by glmNewMesh()
+ * mode  - a bitwise OR of values describing what is to be rendered.
+ *             GLM_MATERIAL -  render with materials
+ *             GLM_CULL     -  skip meshlets that can't be seen
+ */
+GLvoid
+glmQueueMesh(GLMqueue* queue, GLMmesh* mesh, GLuint mode)
+{
+    GLMmodel* model;
+    GLMitem* item;
+    GLfloat center[3], radius;
+    GLuint i;
+
+    assert(queue);
+    assert(mesh);
+    model = mesh->model;
+
+    /* out of date buffers are drawn right away, with glmDraw() */
+    if (mesh->version != model->version) {
+        glmDrawMesh(mesh, mode);
+        return;
+    }
+
+    mode = glmCheckMode(model, mode & (GLM_MATERIAL | GLM_CULL),
+        "glmQueueMesh", GL_FALSE);
+    glmBoundingSphere(model, center, &radius);
+
+    for (i = 0; i < mesh->numranges; i++) {
+        if (!mesh->ranges[i].count)
+            continue;
+        item = glmQueueItem(queue);
+        item->mesh = mesh;
+        item->range = i;
+        item->mode = mode;
+        item->draw = NULL;
+        item->data = NULL;
+        item->texture = 0;
+        item->material = mode & GLM_MATERIAL ?
+            &model->materials[mesh->ranges[i].group->material] : NULL;
+        item->colored = GL_FALSE;
+        glmQueueKey(queue, GLM_QUEUE_OPAQUE, center);
+    }
+}
+
+/* glmQueueCall: Queues a callback that draws something with the
+ * current modelview matrix.
+ *
+ * queue    - render queue made by glmNewQueue()
+ * pass     - GLM_QUEUE_OPAQUE or GLM_QUEUE_BLEND
+ * texture  - 2D texture to draw with (0 for none)
+ * material - material to draw with (NULL to leave the material alone)
+ * color    - color material (diffuse) color (NULL for none)
+ * center   - point to measure the eye distance to (NULL for the origin)
+ * draw     - function that draws it
+ * data     - argument to pass to draw
+ */
+GLvoid
+glmQueueCall(GLMqueue* queue, GLuint pass, GLuint texture,
+    GLMmaterial* material, const GLfloat* color, const GLfloat* center,
+    GLMdrawfunc draw, GLvoid* data)
+{
+    GLMitem* item;
+
+    assert(queue);
+    assert(draw);
+
+    item = glmQueueItem(queue);
+    item->mesh = NULL;
+    item->range = 0;
+    item->mode = 0;
+    item->draw = draw;
+    item->data = data;
+    item->texture = texture;
+    item->material = material;
+    item->colored = color != NULL;
+    if (color)
+        memcpy(item->color, color, sizeof(GLfloat) * 4);
+    glmQueueKey(queue, pass, center);
+}
+
+/* glmQueueFlush: Draws the items of a render queue in key order.
+ *
+ * queue - render queue made by glmNewQueue()
+ */
+GLvoid
+glmQueueFlush(GLMqueue* queue)
+{
+    GLMitem* item;
+    GLMmesh* bound;
+    GLMcull cull;
+    GLMitem* culled;
+    GLboolean culling;
+    unsigned long long* keys;
+    GLuint i;
+
+    assert(queue);
+    if (!queue->numitems)
+        return;
+
+    keys = glmQueueSort(queue->keys, (unsigned long long*)glmArenaAlloc(
+        queue->arena, sizeof(unsigned long long) * queue->numitems),
+        queue->numitems);
+
+    glPushMatrix();
+    bound = NULL;
+    culled = NULL;
+    culling = GL_FALSE;
+    for (i = 0; i < queue->numitems; i++) {
+        item = &queue->items[keys[i] & GLM_KEY_ITEM];
+        glLoadMatrixf(item->matrix);
+
+        if (item->texture) {
+            glmEnable(GL_TEXTURE_2D);
+            glmBindTexture(GL_TEXTURE_2D, item->texture);
+        } else {
+            glmDisable(GL_TEXTURE_2D);
+        }
+        if (item->colored) {
+            glmColorMaterial(GL_FRONT_AND_BACK, GL_DIFFUSE);
+            glmEnable(GL_COLOR_MATERIAL);
+        } else if (item->material) {
+            glmDisable(GL_COLOR_MATERIAL);
+        }
+        if (item->material) {
+            glmMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT,
+                item->material->ambient);
+            if (!item->colored)
+                glmMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE,
+                    item->material->diffuse);
+            glmMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR,
+                item->material->specular);
+            glmMaterialf(GL_FRONT_AND_BACK, GL_SHININESS,
+                item->material->shininess);
+        }
+        if (item->colored)
+            glmColor4fv(item->color);
+
+        if (!item->mesh) {
+            if (bound) {
+                glmBindMesh(NULL);
+                bound = NULL;
+            }
+            item->draw(item->data);
+            continue;
+        }
+
+        if (bound != item->mesh) {
+            glmBindMesh(item->mesh);
+            bound = item->mesh;
+        }
+        /* the groups of a mesh share the culling set up for the first */
+        if (!culled || culled->mesh != item->mesh ||
+            memcmp(culled->matrix, item->matrix, sizeof(item->matrix))) {
+            culled = item;
+            culling = item->mode & GLM_CULL &&
+                glmCullBegin(item->mesh->model, &cull);
+        }
+        glmDrawRange(item->mesh, item->range, culling ? &cull : NULL);
+    }
+    if (bound)
+        glmBindMesh(NULL);
+    glmDisable(GL_TEXTURE_2D);
+    glPopMatrix();
+}
+
+/* glmDeleteQueue: Deletes a render queue.
+ *
+ * queue - render queue made by glmNewQueue()
+ */
+GLvoid
+glmDeleteQueue(GLMqueue* queue)
+{
+    assert(queue);
+
+    glmArenaDelete(queue->arena);
+    free(queue->states);
+    free(queue);
+}
@@ -0,0 +1,835 @@
+/*
+      glmread.cpp
+
+      Single pass Wavefront OBJ reader for the GLM library.
+
+      The file is memory mapped and tokenized line by line straight
+      into growable model arrays, so it is only read once and no stdio
+      scanning is involved.  The resulting GLMmodel has the same layout
+      as the one the old two pass fscanf reader produced.
+
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "glm.h"
+#include "glmint.h"
+#include "glmnum.h"
+
+
+#define T(x) (model->triangles[(x)])
+
+
+/* GLMop: a group, material or material library record met while
+ * parsing a chunk, replayed in file order when the chunks are merged.
+ */
+typedef struct _GLMop {
+    char   type;                /* 'g', 'u' or 'm' */
+    GLuint triangle;            /* triangles in the chunk before the op */
+    char*  name;                /* argument of the record */
+    GLMgroup* group;            /* group current after the op (merge) */
+    GLuint offset;              /* where its triangles go in the group */
+} GLMop;
+
+/* GLMchunk: a newline aligned slice of an OBJ file parsed by one
+ * thread.  Vertices, normals, texcoords and triangles go into a
+ * scratch model with chunk local numbering; indices that were
+ * negative (relative) in the file are flagged so the merge can add the
+ * counts from all the chunks before this one.
+ */
+typedef struct _GLMchunk {
+    const char* begin;          /* first line of the chunk */
+    const char* end;            /* end of the last line of the chunk */
+    GLMmodel    scratch;        /* chunk local arrays */
+    GLushort*   relative;       /* per triangle: bit 3*corner+(v,t,n) */
+    GLMop*      ops;            /* group/material records */
+    GLuint      numops;
+    GLMgroup*   group;          /* group current at the start (merge) */
+    GLuint      offset;         /* where its triangles go in the group */
+    GLuint      base[4];        /* vertices, texcoords, normals and
+                                   triangles in all the chunks before */
+} GLMchunk;
+
+
+/* glmGrow: make sure there is room for one more element in an array
+ * that currently holds used elements.  The capacity is implied by the
+ * count (16, then every power of two), so it doesn't need to be stored
+ * next to every growable array.
+ *
+ * array    - pointer to the (malloc'd or NULL) array
+ * used     - number of elements currently in the array
+ * elemsize - size of one element in bytes
+ */
+static GLvoid
+glmGrow(GLvoid** array, GLuint used, size_t elemsize)
+{
+    GLuint capacity;
+
+    if (*array && (used < 16 || (used & (used - 1))))
+        return;
+
+    capacity = used < 16 ? 16 : 2 * used;
+    *array = realloc(*array, elemsize * capacity);
+    if (!*array) {
+        fprintf(stderr, "glmGrow() failed: out of memory.\n");
+        exit(1);
+    }
+}
+
+/* GLMsettle: an array grown with glmGrow() and its final size */
+typedef struct _GLMsettle {
+  GLvoid** array;               /* where the model keeps the array */
+  size_t   size;                /* bytes in use */
+} GLMsettle;
+
+/* glmSettle: add an array to the list glmParserFinish() moves into
+ * the model's arena, unless it is empty or already there */
+static GLvoid
+glmSettle(GLMmodel* model, GLMsettle* arrays, GLuint* numarrays,
+    GLvoid** array, size_t size)
+{
+    if (!*array || !size || glmArenaOwns(model->arena, *array))
+        return;
+    arrays[*numarrays].array = array;
+    arrays[*numarrays].size = size;
+    (*numarrays)++;
+}
+
+/* glmSkipBlanks: skip spaces and tabs (but not line ends) */
+static inline const char*
+glmSkipBlanks(const char* p)
+{
+    while (*p == ' ' || *p == '\t')
+        p++;
+    return p;
+}
+
+/* glmSkipLine: skip to the first character of the next line */
+static inline const char*
+glmSkipLine(const char* p, const char* end)
+{
+    p = (const char*)memchr(p, '\n', end - p);
+    return p ? p + 1 : end;
+}
+
+/* glmFloat: parse a float on the current line (0 if there is none) */
+static inline GLfloat
+glmFloat(const char** p)
+{
+    *p = glmSkipBlanks(*p);
+    return glmParseFloat(*p, p);
+}
+
+/* glmIndex: parse a (possibly negative) index at p */
+static inline int
+glmIndex(const char** p)
+{
+    return glmParseInt(*p, p);
+}
+
+/* glmWord: copy the first word on the rest of the line into buf */
+static GLvoid
+glmWord(const char* p, char* buf, size_t size)
+{
+    size_t n;
+
+    p = glmSkipBlanks(p);
+    for (n = 0; n + 1 < size && (unsigned char)p[n] > ' '; n++)
+        buf[n] = p[n];
+    buf[n] = '\0';
+}
+
+
+/* glmMapFile: Maps a whole file into memory.
+ *
+ * file     - GLMfile structure to fill in
+ * filename - name of the file to map
+ */
+GLboolean
+glmMapFile(GLMfile* file, const char* filename)
+{
+#if defined(_WIN32)
+    FILE* fp;
+    long size;
+
+    fp = fopen(filename, "rb");
+    if (!fp)
+        return GL_FALSE;
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    file->data = (char*)malloc(size + GLM_NUM_PADDING + 1);
+    file->size = fread(file->data, 1, size, fp);
+    memset(file->data + file->size, 0, GLM_NUM_PADDING + 1);
+    file->mapped = GL_FALSE;
+    fclose(fp);
+    return GL_TRUE;
+#else
+    struct stat st;
+    long pagesize;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return GL_FALSE;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return GL_FALSE;
+    }
+    file->size = st.st_size;
+
+    /* the tail of the last page of a mapping reads as zeros, which
+       terminates the data for free -- unless the file (nearly) fills
+       its last page, then it has to be read into a buffer instead */
+    pagesize = sysconf(_SC_PAGESIZE);
+    file->data = NULL;
+    if (pagesize - file->size % pagesize > GLM_NUM_PADDING) {
+        file->data = (char*)mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (file->data == (char*)MAP_FAILED)
+            file->data = NULL;
+    }
+    if (file->data) {
+        file->mapped = GL_TRUE;
+#if defined(MADV_SEQUENTIAL)
+        madvise(file->data, file->size, MADV_SEQUENTIAL);
+#endif
+    } else {
+        file->data = (char*)malloc(file->size + GLM_NUM_PADDING + 1);
+        file->size = read(fd, file->data, file->size) > 0 ? file->size : 0;
+        memset(file->data + file->size, 0, GLM_NUM_PADDING + 1);
+        file->mapped = GL_FALSE;
+    }
+
+    close(fd);
+    return GL_TRUE;
+#endif
+}
+
+/* glmUnmapFile: Releases a file mapped with glmMapFile().
+ *
+ * file - mapped GLMfile structure
+ */
+GLvoid
+glmUnmapFile(GLMfile* file)
+{
+#if !defined(_WIN32)
+    if (file->mapped)
+        munmap(file->data, file->size);
+    else
+#endif
+        free(file->data);
+    file->data = NULL;
+    file->size = 0;
+}
+
+
+/* glmReadMTL: read a wavefront material library file
+ *
+ * model - properly initialized GLMmodel structure
+ * name  - name of the material library
+ */
+GLvoid
+glmReadMTL(GLMmodel* model, char* name)
+{
+    GLMmaterial* material;
+    GLMfile file;
+    const char* p;
+    const char* end;
+    char* dir;
+    char* filename;
+    char buf[128];
+    GLuint nummaterials, i;
+
+    dir = glmDirName(model->pathname);
+    filename = (char*)malloc(sizeof(char) * (strlen(dir) + strlen(name) + 1));
+    strcpy(filename, dir);
+    strcat(filename, name);
+    free(dir);
+
+    if (!glmMapFile(&file, filename)) {
+        fprintf(stderr, "glmReadMTL() failed: can't open material file \"%s\".\n",
+            filename);
+        exit(1);
+    }
+    free(filename);
+    end = file.data + file.size;
+
+    /* count the number of materials in the file */
+    nummaterials = 1;
+    for (p = file.data; p < end; p = glmSkipLine(p, end)) {
+        p = glmSkipBlanks(p);
+        if (*p == 'n')          /* newmtl */
+            nummaterials++;
+    }
+
+    model->materials = (GLMmaterial*)glmAlloc(model,
+        sizeof(GLMmaterial) * nummaterials);
+    model->nummaterials = nummaterials;
+
+    /* set the default material */
+    for (i = 0; i < nummaterials; i++) {
+        model->materials[i].name = NULL;
+        model->materials[i].shininess = 65.0;
+        model->materials[i].diffuse[0] = 0.8;
+        model->materials[i].diffuse[1] = 0.8;
+        model->materials[i].diffuse[2] = 0.8;
+        model->materials[i].diffuse[3] = 1.0;
+        model->materials[i].ambient[0] = 0.2;
+        model->materials[i].ambient[1] = 0.2;
+        model->materials[i].ambient[2] = 0.2;
+        model->materials[i].ambient[3] = 1.0;
+        model->materials[i].specular[0] = 0.0;
+        model->materials[i].specular[1] = 0.0;
+        model->materials[i].specular[2] = 0.0;
+        model->materials[i].specular[3] = 1.0;
+    }
+    model->materials[0].name = glmStrdup(model, "default");
+
+    /* now, read in the data */
+    nummaterials = 0;
+    for (p = file.data; p < end; p = glmSkipLine(p, end)) {
+        p = glmSkipBlanks(p);
+        material = &model->materials[nummaterials];
+        switch (*p) {
+        case 'n':               /* newmtl */
+            while ((unsigned char)*p > ' ')
+                p++;
+            glmWord(p, buf, sizeof(buf));
+            nummaterials++;
+            model->materials[nummaterials].name = glmStrdup(model, buf);
+            break;
+        case 'N':               /* Ns (and, as always, Ni) */
+            while ((unsigned char)*p > ' ')
+                p++;
+            material->shininess = glmFloat(&p);
+            /* wavefront shininess is from [0, 1000], so scale for OpenGL */
+            material->shininess /= 1000.0;
+            material->shininess *= 128.0;
+            break;
+        case 'K':
+            switch (p[1]) {
+            case 'd':
+                p += 2;
+                material->diffuse[0] = glmFloat(&p);
+                material->diffuse[1] = glmFloat(&p);
+                material->diffuse[2] = glmFloat(&p);
+                break;
+            case 's':
+                p += 2;
+                material->specular[0] = glmFloat(&p);
+                material->specular[1] = glmFloat(&p);
+                material->specular[2] = glmFloat(&p);
+                break;
+            case 'a':
+                p += 2;
+                material->ambient[0] = glmFloat(&p);
+                material->ambient[1] = glmFloat(&p);
+                material->ambient[2] = glmFloat(&p);
+                break;
+            }
+            break;
+        default:                /* comments, blank lines, d, illum, ... */
+            break;
+        }
+    }
+
+    glmUnmapFile(&file);
+}
+
+
+/* glmParserInit: Prepares a parser that fills in the given (empty)
+ * model, starting in the "default" group.
+ *
+ * parser - GLMparser structure to initialize
+ * model  - freshly allocated GLMmodel structure
+ */
+GLvoid
+glmParserInit(GLMparser* parser, GLMmodel* model)
+{
+    char name[] = "default";
+
+    parser->model = model;
+    parser->group = glmAddGroup(model, name);
+    parser->material = 0;
+    parser->chunk = NULL;
+}
+
+/* glmChunkOp: remember a group/material record of a chunk */
+static GLvoid
+glmChunkOp(GLMchunk* chunk, char type, char* name)
+{
+    GLMop* op;
+
+    glmGrow((GLvoid**)&chunk->ops, chunk->numops, sizeof(GLMop));
+    op = &chunk->ops[chunk->numops++];
+    op->type = type;
+    op->triangle = chunk->scratch.numtriangles;
+    op->name = strdup(name);
+}
+
+/* glmParseFace: parse the vertices of an 'f' record and add them to
+ * the model as a triangle fan.  The vertex format (v, v/t, v//n or
+ * v/t/n) is worked out once from the first vertex of the face.
+ */
+static const char*
+glmParseFace(GLMparser* parser, const char* p)
+{
+    GLMmodel* model = parser->model;
+    GLMgroup* group = parser->group;
+    GLMchunk* chunk = parser->chunk;
+    GLMtriangle* triangle;
+    GLuint first[3], prev[3], cur[3];   /* v, t, n of the corners */
+    GLuint firstrel, prevrel, currel;   /* relative flags of the corners */
+    GLboolean hast, hasn;
+    GLuint corner, slashes;
+    const char* s;
+    int v, t, n;
+
+    /* work out the format from the first vertex */
+    p = glmSkipBlanks(p);
+    slashes = 0;
+    hast = GL_FALSE;
+    for (s = p; (unsigned char)*s > ' '; s++) {
+        if (*s == '/') {
+            slashes++;
+            if (slashes == 1 && s[1] != '/')
+                hast = GL_TRUE;
+        }
+    }
+    hasn = slashes == 2;
+
+    for (corner = 0; (unsigned char)*p > ' '; corner++) {
+        s = p;
+        v = glmIndex(&p);
+        if (p == s)
+            break;              /* not an index, ignore the rest */
+        t = n = 0;
+        if (hast) {
+            p++;
+            t = glmIndex(&p);
+        }
+        if (hasn) {
+            p += hast ? 1 : 2;
+            n = glmIndex(&p);
+        }
+        p = glmSkipBlanks(p);
+
+        cur[0] = v < 0 ? v + model->numvertices + 1 : v;
+        cur[1] = t < 0 ? t + model->numtexcoords + 1 : t;
+        cur[2] = n < 0 ? n + model->numnormals + 1 : n;
+        currel = (v < 0) | (t < 0) << 1 | (n < 0) << 2;
+
+        /* fan triangulate: every corner from the third on makes a
+           triangle with the first and the previous corner */
+        if (corner == 0) {
+            first[0] = cur[0]; first[1] = cur[1]; first[2] = cur[2];
+            firstrel = currel;
+        } else if (corner >= 2) {
+            glmGrow((GLvoid**)&model->triangles, model->numtriangles,
+                sizeof(GLMtriangle));
+            triangle = &T(model->numtriangles);
+            triangle->vindices[0] = first[0];
+            triangle->tindices[0] = first[1];
+            triangle->nindices[0] = first[2];
+            triangle->vindices[1] = prev[0];
+            triangle->tindices[1] = prev[1];
+            triangle->nindices[1] = prev[2];
+            triangle->vindices[2] = cur[0];
+            triangle->tindices[2] = cur[1];
+            triangle->nindices[2] = cur[2];
+            triangle->findex = 0;
+            if (chunk) {
+                glmGrow((GLvoid**)&chunk->relative, model->numtriangles,
+                    sizeof(GLushort));
+                chunk->relative[model->numtriangles] =
+                    firstrel | prevrel << 3 | currel << 6;
+            } else {
+                glmGrow((GLvoid**)&group->triangles, group->numtriangles,
+                    sizeof(GLuint));
+                group->triangles[group->numtriangles++] = model->numtriangles;
+            }
+            model->numtriangles++;
+        }
+        prev[0] = cur[0]; prev[1] = cur[1]; prev[2] = cur[2];
+        prevrel = currel;
+    }
+
+    return p;
+}
+
+/* glmParseOBJ: Parses the Wavefront OBJ records between begin and
+ * end into the parser's model.
+ *
+ * parser - initialized GLMparser structure
+ * begin  - first character of the first line to parse
+ * end    - end of the data ('\0' terminated)
+ */
+const char*
+glmParseOBJ(GLMparser* parser, const char* begin, const char* end)
+{
+    GLMmodel* model = parser->model;
+    const char* p;
+    const char* s;
+    GLfloat* f;
+    char buf[128];
+    size_t n;
+
+    p = begin;
+    while (p < end) {
+        p = glmSkipBlanks(p);
+        switch (*p) {
+        case 'v':               /* v, vn, vt */
+            switch (p[1]) {
+            case ' ':           /* vertex */
+            case '\t':
+                glmGrow((GLvoid**)&model->vertices, model->numvertices + 1,
+                    3 * sizeof(GLfloat));
+                p += 1;
+                model->numvertices++;
+                f = &model->vertices[3 * model->numvertices];
+                f[0] = glmFloat(&p);
+                f[1] = glmFloat(&p);
+                f[2] = glmFloat(&p);
+                break;
+            case 'n':           /* normal */
+                glmGrow((GLvoid**)&model->normals, model->numnormals + 1,
+                    3 * sizeof(GLfloat));
+                p += 2;
+                model->numnormals++;
+                f = &model->normals[3 * model->numnormals];
+                f[0] = glmFloat(&p);
+                f[1] = glmFloat(&p);
+                f[2] = glmFloat(&p);
+                break;
+            case 't':           /* texcoord */
+                glmGrow((GLvoid**)&model->texcoords, model->numtexcoords + 1,
+                    2 * sizeof(GLfloat));
+                p += 2;
+                model->numtexcoords++;
+                f = &model->texcoords[2 * model->numtexcoords];
+                f[0] = glmFloat(&p);
+                f[1] = glmFloat(&p);
+                break;
+            default:
+                glmWord(p, buf, sizeof(buf));
+                printf("glmParseOBJ(): Unknown token \"%s\".\n", buf);
+                exit(1);
+                break;
+            }
+            break;
+        case 'f':               /* face */
+            p = glmParseFace(parser, p + 1);
+            break;
+        case 'm':               /* mtllib */
+            while ((unsigned char)*p > ' ')
+                p++;
+            glmWord(p, buf, sizeof(buf));
+            if (parser->chunk) {
+                glmChunkOp(parser->chunk, 'm', buf);
+                break;
+            }
+            model->mtllibname = glmStrdup(model, buf);
+            glmReadMTL(model, buf);
+            break;
+        case 'u':               /* usemtl */
+            while ((unsigned char)*p > ' ')
+                p++;
+            glmWord(p, buf, sizeof(buf));
+            if (parser->chunk) {
+                glmChunkOp(parser->chunk, 'u', buf);
+                break;
+            }
+            parser->group->material = parser->material =
+                glmFindMaterial(model, buf);
+            break;
+        case 'g':               /* group */
+            /* the name is the rest of the line (minus the '\n') */
+            while ((unsigned char)*p > ' ')
+                p++;
+            s = (const char*)memchr(p, '\n', end - p);
+            n = (s ? s : end) - p;
+            if (n > sizeof(buf) - 1)
+                n = sizeof(buf) - 1;
+            memcpy(buf, p, n);
+            buf[n] = '\0';
+#if SINGLE_STRING_GROUP_NAMES
+            glmWord(buf, buf, sizeof(buf));
+#endif
+            if (parser->chunk) {
+                glmChunkOp(parser->chunk, 'g', buf);
+                break;
+            }
+            parser->group = glmAddGroup(model, buf);
+            parser->group->material = parser->material;
+            break;
+        default:                /* comments, blank lines, o, s, ... */
+            break;
+        }
+        p = glmSkipLine(p, end);
+    }
+
+    return p;
+}
+
+/* glmParserFinish: Moves the arrays of the parser's model, trimmed
+ * to their final size, into one region of the model's arena.
+ *
+ * parser - GLMparser structure that is done parsing
+ */
+GLvoid
+glmParserFinish(GLMparser* parser)
+{
+    GLMmodel* model = parser->model;
+    GLMgroup* group;
+    GLMsettle* arrays;
+    GLuint numarrays, i;
+    size_t total, size;
+    char* region;
+
+    arrays = (GLMsettle*)malloc(sizeof(GLMsettle) * (model->numgroups + 4));
+    numarrays = 0;
+    glmSettle(model, arrays, &numarrays, (GLvoid**)&model->vertices,
+        3 * sizeof(GLfloat) * (model->numvertices + 1));
+    if (model->numnormals)
+        glmSettle(model, arrays, &numarrays, (GLvoid**)&model->normals,
+            3 * sizeof(GLfloat) * (model->numnormals + 1));
+    if (model->numtexcoords)
+        glmSettle(model, arrays, &numarrays, (GLvoid**)&model->texcoords,
+            2 * sizeof(GLfloat) * (model->numtexcoords + 1));
+    glmSettle(model, arrays, &numarrays, (GLvoid**)&model->triangles,
+        sizeof(GLMtriangle) * model->numtriangles);
+    for (group = model->groups; group; group = group->next)
+        glmSettle(model, arrays, &numarrays, (GLvoid**)&group->triangles,
+            sizeof(GLuint) * group->numtriangles);
+
+    /* one allocation for all of them, each on its own cache line */
+    total = 0;
+    for (i = 0; i < numarrays; i++)
+        total += (arrays[i].size + GLM_ARENA_ALIGN - 1) & ~(GLM_ARENA_ALIGN - 1);
+    if (total) {
+        region = (char*)glmAlloc(model, total);
+        for (i = 0; i < numarrays; i++) {
+            size = arrays[i].size;
+            memcpy(region, *arrays[i].array, size);
+            free(*arrays[i].array);
+            *arrays[i].array = region;
+            region += (size + GLM_ARENA_ALIGN - 1) & ~(GLM_ARENA_ALIGN - 1);
+        }
+    }
+    free(arrays);
+}
+
+
+/* glmParseChunk: thread body that parses one chunk into its scratch
+ * model.
+ */
+static GLvoid
+glmParseChunk(GLMchunk* chunk)
+{
+    GLMparser parser;
+
+    memset(&chunk->scratch, 0, sizeof(GLMmodel));
+    parser.model = &chunk->scratch;
+    parser.group = NULL;
+    parser.material = 0;
+    parser.chunk = chunk;
+    glmParseOBJ(&parser, chunk->begin, chunk->end);
+}
+
+/* glmMergeChunk: thread body that copies one parsed chunk into its
+ * place in the model, renumbering its relative indices and filling
+ * in its share of the group triangle lists.
+ */
+static GLvoid
+glmMergeChunk(GLMmodel* model, GLMchunk* chunk)
+{
+    GLMmodel* scratch = &chunk->scratch;
+    GLMtriangle* triangle;
+    GLMgroup* group;
+    GLuint i, j, k, op, offset;
+    GLushort relative;
+
+    if (scratch->numvertices)
+        memcpy(&model->vertices[3 * (chunk->base[0] + 1)], &scratch->vertices[3],
+            sizeof(GLfloat) * 3 * scratch->numvertices);
+    if (scratch->numtexcoords)
+        memcpy(&model->texcoords[2 * (chunk->base[1] + 1)], &scratch->texcoords[2],
+            sizeof(GLfloat) * 2 * scratch->numtexcoords);
+    if (scratch->numnormals)
+        memcpy(&model->normals[3 * (chunk->base[2] + 1)], &scratch->normals[3],
+            sizeof(GLfloat) * 3 * scratch->numnormals);
+
+    for (i = 0; i < scratch->numtriangles; i++) {
+        triangle = &T(chunk->base[3] + i);
+        *triangle = scratch->triangles[i];
+        relative = chunk->relative[i];
+        for (j = 0; j < 3; j++, relative >>= 3) {
+            if (relative & 1)
+                triangle->vindices[j] += chunk->base[0];
+            if (relative & 2)
+                triangle->tindices[j] += chunk->base[1];
+            if (relative & 4)
+                triangle->nindices[j] += chunk->base[2];
+        }
+    }
+
+    /* hand out the triangles to the groups that were current */
+    group = chunk->group;
+    offset = chunk->offset;
+    for (i = 0, op = 0; i < scratch->numtriangles; op++) {
+        k = op < chunk->numops ? chunk->ops[op].triangle : scratch->numtriangles;
+        for (; i < k; i++)
+            group->triangles[offset++] = chunk->base[3] + i;
+        if (op < chunk->numops) {
+            group = chunk->ops[op].group;
+            offset = chunk->ops[op].offset;
+        }
+    }
+}
+
+/* glmParseOBJThreaded: Parses a whole Wavefront OBJ file into the
+ * parser's model using several threads.  The data is split into one
+ * newline aligned chunk per thread, the chunks are parsed in parallel
+ * and then merged: a serial walk over the group/material records
+ * (replayed in file order) and a prefix sum of the record counts give
+ * every chunk its place in the model, after which the chunks are
+ * copied and renumbered in parallel.  The result is identical to
+ * glmParseOBJ() over the same data.
+ *
+ * parser     - initialized GLMparser structure
+ * begin      - first character of the data
+ * end        - end of the data ('\0' terminated)
+ * numthreads - number of threads to use (0 for one per core)
+ */
+GLvoid
+glmParseOBJThreaded(GLMparser* parser, const char* begin, const char* end,
+    GLuint numthreads)
+{
+    GLMmodel* model = parser->model;
+    GLMchunk* chunks;
+    GLMchunk* chunk;
+    GLMgroup* group;
+    GLMop* op;
+    GLuint i, j, size, counts[4];
+    std::vector<std::thread> threads;
+
+    if (!numthreads)
+        numthreads = std::thread::hardware_concurrency();
+    if (numthreads < 2 || (size_t)(end - begin) < 4096 * numthreads) {
+        glmParseOBJ(parser, begin, end);
+        return;
+    }
+
+    /* split at newlines */
+    chunks = (GLMchunk*)calloc(numthreads, sizeof(GLMchunk));
+    size = (end - begin) / numthreads;
+    for (i = 0; i < numthreads; i++) {
+        chunks[i].begin = i ? chunks[i - 1].end : begin;
+        chunks[i].end = chunks[i].begin + size;
+        if (i == numthreads - 1 || chunks[i].end >= end)
+            chunks[i].end = end;
+        else
+            chunks[i].end = glmSkipLine(chunks[i].end, end);
+    }
+
+    for (i = 0; i < numthreads; i++)
+        threads.push_back(std::thread(glmParseChunk, &chunks[i]));
+    for (i = 0; i < numthreads; i++)
+        threads[i].join();
+    threads.clear();
+
+    /* prefix sum of the counts and a replay of the records in file
+       order (material libraries are read here, groups are added in the
+       same order as a serial parse) */
+    counts[0] = counts[1] = counts[2] = counts[3] = 0;
+    for (i = 0; i < numthreads; i++) {
+        chunk = &chunks[i];
+        chunk->base[0] = counts[0];
+        chunk->base[1] = counts[1];
+        chunk->base[2] = counts[2];
+        chunk->base[3] = counts[3];
+        counts[0] += chunk->scratch.numvertices;
+        counts[1] += chunk->scratch.numtexcoords;
+        counts[2] += chunk->scratch.numnormals;
+        counts[3] += chunk->scratch.numtriangles;
+
+        chunk->group = parser->group;
+        chunk->offset = parser->group->numtriangles;
+        group = parser->group;
+        for (j = 0; j < chunk->numops; j++) {
+            op = &chunk->ops[j];
+            group->numtriangles += op->triangle -
+                (j ? chunk->ops[j - 1].triangle : 0);
+            switch (op->type) {
+            case 'm':
+                model->mtllibname = glmStrdup(model, op->name);
+                glmReadMTL(model, op->name);
+                break;
+            case 'u':
+                parser->group->material = parser->material =
+                    glmFindMaterial(model, op->name);
+                break;
+            case 'g':
+                parser->group = glmAddGroup(model, op->name);
+                parser->group->material = parser->material;
+                break;
+            }
+            group = parser->group;
+            op->group = group;
+            op->offset = group->numtriangles;
+        }
+        group->numtriangles += chunk->scratch.numtriangles -
+            (chunk->numops ? chunk->ops[chunk->numops - 1].triangle : 0);
+    }
+
+    model->numvertices = counts[0];
+    model->numtexcoords = counts[1];
+    model->numnormals = counts[2];
+    model->numtriangles = counts[3];
+    model->vertices = (GLfloat*)glmAlloc(model, sizeof(GLfloat) *
+        3 * (model->numvertices + 1));
+    if (model->numtexcoords)
+        model->texcoords = (GLfloat*)glmAlloc(model, sizeof(GLfloat) *
+            2 * (model->numtexcoords + 1));
+    if (model->numnormals)
+        model->normals = (GLfloat*)glmAlloc(model, sizeof(GLfloat) *
+            3 * (model->numnormals + 1));
+    if (model->numtriangles)
+        model->triangles = (GLMtriangle*)glmAlloc(model,
+            sizeof(GLMtriangle) * model->numtriangles);
+    for (group = model->groups; group; group = group->next)
+        if (group->numtriangles)
+            group->triangles = (GLuint*)glmAlloc(model, sizeof(GLuint) *
+                group->numtriangles);
+
+    for (i = 0; i < numthreads; i++)
+        threads.push_back(std::thread(glmMergeChunk, model, &chunks[i]));
+    for (i = 0; i < numthreads; i++)
+        threads[i].join();
+
+    for (i = 0; i < numthreads; i++) {
+        chunk = &chunks[i];
+        for (j = 0; j < chunk->numops; j++)
+            free(chunk->ops[j].name);
+        free(chunk->ops);
+        free(chunk->relative);
+        free(chunk->scratch.vertices);
+        free(chunk->scratch.texcoords);
+        free(chunk->scratch.normals);
+        free(chunk->scratch.triangles);
+    }
+    free(chunks);
+}
@@ -0,0 +1,812 @@
+/*
+      glmsimd.cpp
+
+      SIMD kernels for the GLM library.
+
+      Each kernel has a scalar version and, on x86, SSE (4 wide) and
+      mostly AVX2 (8 wide) versions; the widest one the CPU supports is
+      picked the first time a kernel runs.  Setting the environment variable
+      GLM_SIMD to "scalar", "sse" or "avx2" forces a narrower one, for
+      benchmarking.
+
+      The vector versions gather the triangle vertices into structure
+      of arrays registers (all x's, all y's, all z's) and do exactly
+      the same single precision operations, in the same order, as the
+      scalar code, so every version gives bit-identical results.
+
+ */
+
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "glm.h"
+#include "glmint.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define GLM_SIMD_X86 1
+#include <immintrin.h>
+#endif
+#if GLM_SIMD_X86 && defined(__GNUC__)
+#define GLM_SIMD_AVX2 1           /* needs per function target support */
+#endif
+
+
+#define T(x) (model->triangles[(x)])
+
+/* instruction sets, narrowest first */
+#define GLM_SIMD_SCALAR 0
+#define GLM_SIMD_SSE    1
+#define GLM_SIMD_AVX    2
+
+
+/* glmSimdLevel: the widest instruction set to use (see GLM_SIMD) */
+static int
+glmSimdLevel(GLvoid)
+{
+    const char* force;
+    int level = GLM_SIMD_SCALAR;
+
+#if GLM_SIMD_X86
+    level = GLM_SIMD_SSE;         /* SSE2 is part of x86-64 */
+#endif
+#if GLM_SIMD_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        level = GLM_SIMD_AVX;
+#endif
+
+    force = getenv("GLM_SIMD");
+    if (force && !strcmp(force, "scalar"))
+        level = GLM_SIMD_SCALAR;
+    else if (force && !strcmp(force, "sse") && level > GLM_SIMD_SSE)
+        level = GLM_SIMD_SSE;
+    return level;
+}
+
+/* glmSimd: the instruction set the kernels use, decided on first use */
+static int
+glmSimd(GLvoid)
+{
+    static const int level = glmSimdLevel();
+
+    return level;
+}
+
+
+/* glmFacetNormalsScalar: one triangle at a time */
+static GLvoid
+glmFacetNormalsScalar(GLMmodel* model, GLuint begin, GLuint end)
+{
+    const GLfloat* p0;
+    const GLfloat* p1;
+    const GLfloat* p2;
+    GLfloat u[3], v[3], l;
+    GLfloat* n;
+    GLuint i;
+
+    for (i = begin; i < end; i++) {
+        p0 = &model->vertices[3 * T(i).vindices[0]];
+        p1 = &model->vertices[3 * T(i).vindices[1]];
+        p2 = &model->vertices[3 * T(i).vindices[2]];
+        u[0] = p1[0] - p0[0]; u[1] = p1[1] - p0[1]; u[2] = p1[2] - p0[2];
+        v[0] = p2[0] - p0[0]; v[1] = p2[1] - p0[1]; v[2] = p2[2] - p0[2];
+
+        n = &model->facetnorms[3 * (i+1)];
+        n[0] = u[1]*v[2] - u[2]*v[1];
+        n[1] = u[2]*v[0] - u[0]*v[2];
+        n[2] = u[0]*v[1] - u[1]*v[0];
+
+        l = (GLfloat)sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        n[0] /= l;
+        n[1] /= l;
+        n[2] /= l;
+
+        T(i).findex = i+1;
+    }
+}
+
+#if GLM_SIMD_X86
+/* glmStoreNormals4: transpose 4 normals from x, y, z registers and
+ * store them as 12 consecutive floats.  Never writes past n[11].
+ */
+static inline GLvoid
+glmStoreNormals4(GLfloat* n, __m128 x, __m128 y, __m128 z)
+{
+    __m128 w = _mm_setzero_ps();
+
+    _MM_TRANSPOSE4_PS(x, y, z, w);      /* rows are now (x, y, z, 0) */
+    _mm_storeu_ps(n + 0, x);            /* 4th float overwritten next */
+    _mm_storeu_ps(n + 3, y);
+    _mm_storeu_ps(n + 6, z);
+    _mm_storel_pi((__m64*)(n + 9), w);
+    _mm_store_ss(n + 11, _mm_movehl_ps(w, w));
+}
+
+/* glmFacetNormalsSSE: four triangles at a time */
+static GLvoid
+glmFacetNormalsSSE(GLMmodel* model, GLuint begin, GLuint end)
+{
+    const GLfloat* vertices = model->vertices;
+    const GLfloat* p[3][4];
+    __m128 x[3], y[3], z[3];
+    __m128 ux, uy, uz, vx, vy, vz, nx, ny, nz, l;
+    GLuint i, j, c;
+
+    for (i = begin; i + 4 <= end; i += 4) {
+        /* gather the corners of the 4 triangles */
+        for (c = 0; c < 3; c++) {
+            for (j = 0; j < 4; j++)
+                p[c][j] = &vertices[3 * T(i + j).vindices[c]];
+            x[c] = _mm_setr_ps(p[c][0][0], p[c][1][0], p[c][2][0], p[c][3][0]);
+            y[c] = _mm_setr_ps(p[c][0][1], p[c][1][1], p[c][2][1], p[c][3][1]);
+            z[c] = _mm_setr_ps(p[c][0][2], p[c][1][2], p[c][2][2], p[c][3][2]);
+        }
+
+        ux = _mm_sub_ps(x[1], x[0]);
+        uy = _mm_sub_ps(y[1], y[0]);
+        uz = _mm_sub_ps(z[1], z[0]);
+        vx = _mm_sub_ps(x[2], x[0]);
+        vy = _mm_sub_ps(y[2], y[0]);
+        vz = _mm_sub_ps(z[2], z[0]);
+
+        nx = _mm_sub_ps(_mm_mul_ps(uy, vz), _mm_mul_ps(uz, vy));
+        ny = _mm_sub_ps(_mm_mul_ps(uz, vx), _mm_mul_ps(ux, vz));
+        nz = _mm_sub_ps(_mm_mul_ps(ux, vy), _mm_mul_ps(uy, vx));
+
+        l = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx),
+            _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+        glmStoreNormals4(&model->facetnorms[3 * (i+1)], _mm_div_ps(nx, l),
+            _mm_div_ps(ny, l), _mm_div_ps(nz, l));
+
+        for (j = 0; j < 4; j++)
+            T(i + j).findex = i + j + 1;
+    }
+    glmFacetNormalsScalar(model, i, end);
+}
+#endif
+
+#if GLM_SIMD_AVX2
+/* glmFacetNormalsAVX2: eight triangles at a time, with the vertex
+ * indices and coordinates fetched by gather instructions */
+__attribute__((target("avx2")))
+static GLvoid
+glmFacetNormalsAVX2(GLMmodel* model, GLuint begin, GLuint end)
+{
+    const GLfloat* vertices = model->vertices;
+    const int stride = sizeof(GLMtriangle) / sizeof(GLuint);
+    __m256i offsets, index;
+    __m256 x[3], y[3], z[3];
+    __m256 ux, uy, uz, vx, vy, vz, nx, ny, nz, l;
+    GLfloat* n;
+    GLuint i, j, c;
+
+    offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+        _mm256_set1_epi32(stride));
+
+    for (i = begin; i + 8 <= end; i += 8) {
+        /* gather the corners of the 8 triangles */
+        for (c = 0; c < 3; c++) {
+            index = _mm256_i32gather_epi32(
+                (const int*)&T(i).vindices[c], offsets, 4);
+            index = _mm256_add_epi32(index, _mm256_add_epi32(index, index));
+            x[c] = _mm256_i32gather_ps(vertices + 0, index, 4);
+            y[c] = _mm256_i32gather_ps(vertices + 1, index, 4);
+            z[c] = _mm256_i32gather_ps(vertices + 2, index, 4);
+        }
+
+        ux = _mm256_sub_ps(x[1], x[0]);
+        uy = _mm256_sub_ps(y[1], y[0]);
+        uz = _mm256_sub_ps(z[1], z[0]);
+        vx = _mm256_sub_ps(x[2], x[0]);
+        vy = _mm256_sub_ps(y[2], y[0]);
+        vz = _mm256_sub_ps(z[2], z[0]);
+
+        nx = _mm256_sub_ps(_mm256_mul_ps(uy, vz), _mm256_mul_ps(uz, vy));
+        ny = _mm256_sub_ps(_mm256_mul_ps(uz, vx), _mm256_mul_ps(ux, vz));
+        nz = _mm256_sub_ps(_mm256_mul_ps(ux, vy), _mm256_mul_ps(uy, vx));
+
+        l = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx),
+            _mm256_mul_ps(ny, ny)), _mm256_mul_ps(nz, nz)));
+        nx = _mm256_div_ps(nx, l);
+        ny = _mm256_div_ps(ny, l);
+        nz = _mm256_div_ps(nz, l);
+
+        n = &model->facetnorms[3 * (i+1)];
+        glmStoreNormals4(n, _mm256_castps256_ps128(nx),
+            _mm256_castps256_ps128(ny), _mm256_castps256_ps128(nz));
+        glmStoreNormals4(n + 12, _mm256_extractf128_ps(nx, 1),
+            _mm256_extractf128_ps(ny, 1), _mm256_extractf128_ps(nz, 1));
+
+        for (j = 0; j < 8; j++)
+            T(i + j).findex = i + j + 1;
+    }
+    glmFacetNormalsSSE(model, i, end);
+}
+#endif
+
+
+/* glmFacetNormalsRange: Computes the facet normals of the triangles
+ * in [begin, end) into facetnorms[3 * (i+1)] and sets their findex,
+ * with the widest SIMD kernel available.
+ *
+ * model - GLMmodel structure with room for the facet normals
+ * begin - first triangle
+ * end   - one past the last triangle
+ */
+GLvoid
+glmFacetNormalsRange(GLMmodel* model, GLuint begin, GLuint end)
+{
+    int level = glmSimd();
+
+    assert(model->facetnorms);
+
+#if GLM_SIMD_AVX2
+    if (level >= GLM_SIMD_AVX) {
+        glmFacetNormalsAVX2(model, begin, end);
+        return;
+    }
+#endif
+#if GLM_SIMD_X86
+    if (level >= GLM_SIMD_SSE) {
+        glmFacetNormalsSSE(model, begin, end);
+        return;
+    }
+#endif
+    glmFacetNormalsScalar(model, begin, end);
+}
+
+
+/* glmBoundsScalar: one vertex at a time, exactly like the old
+ * glmUnitize() loop */
+static GLvoid
+glmBoundsScalar(const GLfloat* vertices, GLuint begin, GLuint end,
+                GLfloat* min, GLfloat* max)
+{
+    GLfloat maxx, minx, maxy, miny, maxz, minz;
+    const GLfloat* v;
+    GLuint i;
+
+    maxx = max[0]; minx = min[0];
+    maxy = max[1]; miny = min[1];
+    maxz = max[2]; minz = min[2];
+    for (i = begin; i < end; i++) {
+        v = &vertices[3 * i];
+        if (maxx < v[0])
+            maxx = v[0];
+        if (minx > v[0])
+            minx = v[0];
+
+        if (maxy < v[1])
+            maxy = v[1];
+        if (miny > v[1])
+            miny = v[1];
+
+        if (maxz < v[2])
+            maxz = v[2];
+        if (minz > v[2])
+            minz = v[2];
+    }
+    max[0] = maxx; min[0] = minx;
+    max[1] = maxy; min[1] = miny;
+    max[2] = maxz; min[2] = minz;
+}
+
+/* glmBoundsFold: fold per lane minimums and maximums of n lanes of
+ * packed xyz vertices (lane k holds component k % 3) into min/max */
+static GLvoid
+glmBoundsFold(const GLfloat* lanemin, const GLfloat* lanemax, GLuint n,
+              GLfloat* min, GLfloat* max)
+{
+    GLuint k;
+
+    for (k = 0; k < n; k++) {
+        if (max[k % 3] < lanemax[k])
+            max[k % 3] = lanemax[k];
+        if (min[k % 3] > lanemin[k])
+            min[k % 3] = lanemin[k];
+    }
+}
+
+#if GLM_SIMD_X86
+/* glmBoundsSSE: four vertices (three registers) at a time.  The
+ * vertices stay packed; lane k of the 12 always holds component
+ * k % 3, so the lanes are only sorted out at the end. */
+static GLvoid
+glmBoundsSSE(const GLfloat* vertices, GLuint begin, GLuint end,
+             GLfloat* min, GLfloat* max)
+{
+    GLfloat lanemin[12], lanemax[12];
+    __m128 lo[3], hi[3], v;
+    GLuint i, r;
+
+    if (end - begin < 4) {
+        glmBoundsScalar(vertices, begin, end, min, max);
+        return;
+    }
+
+    for (r = 0; r < 3; r++) {
+        lo[r] = _mm_setr_ps(min[(4*r) % 3], min[(4*r + 1) % 3],
+            min[(4*r + 2) % 3], min[(4*r + 3) % 3]);
+        hi[r] = _mm_setr_ps(max[(4*r) % 3], max[(4*r + 1) % 3],
+            max[(4*r + 2) % 3], max[(4*r + 3) % 3]);
+    }
+    for (i = begin; i + 4 <= end; i += 4) {
+        for (r = 0; r < 3; r++) {
+            v = _mm_loadu_ps(&vertices[3 * i + 4 * r]);
+            lo[r] = _mm_min_ps(v, lo[r]);       /* v < lo ? v : lo */
+            hi[r] = _mm_max_ps(v, hi[r]);
+        }
+    }
+    for (r = 0; r < 3; r++) {
+        _mm_storeu_ps(&lanemin[4 * r], lo[r]);
+        _mm_storeu_ps(&lanemax[4 * r], hi[r]);
+    }
+    glmBoundsFold(lanemin, lanemax, 12, min, max);
+    glmBoundsScalar(vertices, i, end, min, max);
+}
+#endif
+
+#if GLM_SIMD_AVX2
+/* glmBoundsAVX2: eight vertices (three registers) at a time */
+__attribute__((target("avx2")))
+static GLvoid
+glmBoundsAVX2(const GLfloat* vertices, GLuint begin, GLuint end,
+              GLfloat* min, GLfloat* max)
+{
+    GLfloat lanemin[24], lanemax[24];
+    __m256 lo[3], hi[3], v;
+    GLuint i, r;
+
+    if (end - begin < 8) {
+        glmBoundsSSE(vertices, begin, end, min, max);
+        return;
+    }
+
+    for (r = 0; r < 24; r++) {
+        lanemin[r] = min[r % 3];
+        lanemax[r] = max[r % 3];
+    }
+    for (r = 0; r < 3; r++) {
+        lo[r] = _mm256_loadu_ps(&lanemin[8 * r]);
+        hi[r] = _mm256_loadu_ps(&lanemax[8 * r]);
+    }
+    for (i = begin; i + 8 <= end; i += 8) {
+        for (r = 0; r < 3; r++) {
+            v = _mm256_loadu_ps(&vertices[3 * i + 8 * r]);
+            lo[r] = _mm256_min_ps(v, lo[r]);
+            hi[r] = _mm256_max_ps(v, hi[r]);
+        }
+    }
+    for (r = 0; r < 3; r++) {
+        _mm256_storeu_ps(&lanemin[8 * r], lo[r]);
+        _mm256_storeu_ps(&lanemax[8 * r], hi[r]);
+    }
+    glmBoundsFold(lanemin, lanemax, 24, min, max);
+    glmBoundsSSE(vertices, i, end, min, max);
+}
+#endif
+
+/* glmBoundsRange: Grows a bounding box to take in the vertices in
+ * [begin, end).
+ *
+ * vertices - packed xyz vertex array
+ * begin    - first vertex
+ * end      - one past the last vertex
+ * min      - minimum x, y and z so far (updated)
+ * max      - maximum x, y and z so far (updated)
+ */
+GLvoid
+glmBoundsRange(const GLfloat* vertices, GLuint begin, GLuint end,
+               GLfloat* min, GLfloat* max)
+{
+    int level = glmSimd();
+
+#if GLM_SIMD_AVX2
+    if (level >= GLM_SIMD_AVX) {
+        glmBoundsAVX2(vertices, begin, end, min, max);
+        return;
+    }
+#endif
+#if GLM_SIMD_X86
+    if (level >= GLM_SIMD_SSE) {
+        glmBoundsSSE(vertices, begin, end, min, max);
+        return;
+    }
+#endif
+    glmBoundsScalar(vertices, begin, end, min, max);
+}
+
+
+/* glmTransformScalar: one vertex at a time */
+static GLvoid
+glmTransformScalar(GLfloat* vertices, GLuint begin, GLuint end,
+                   const GLfloat* translate, GLfloat scale,
+                   const GLfloat* center, GLfloat* radius2)
+{
+    GLfloat* v;
+    GLfloat d[3], r;
+    GLuint i;
+
+    for (i = begin; i < end; i++) {
+        v = &vertices[3 * i];
+        if (translate) {
+            v[0] = (v[0] - translate[0]) * scale;
+            v[1] = (v[1] - translate[1]) * scale;
+            v[2] = (v[2] - translate[2]) * scale;
+        }
+        if (center) {
+            d[0] = v[0] - center[0];
+            d[1] = v[1] - center[1];
+            d[2] = v[2] - center[2];
+            r = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+            if (*radius2 < r)
+                *radius2 = r;
+        }
+    }
+}
+
+#if GLM_SIMD_X86
+/* glmTransformSSE: four vertices at a time.  The transform is done on
+ * the packed vertices; for the distances they are shuffled into x, y
+ * and z registers. */
+static GLvoid
+glmTransformSSE(GLfloat* vertices, GLuint begin, GLuint end,
+                const GLfloat* translate, GLfloat scale,
+                const GLfloat* center, GLfloat* radius2)
+{
+    __m128 t[3], s, v[3], x, y, z, r, r2;
+    GLfloat lanes[4];
+    GLuint i, k;
+
+    if (translate) {
+        t[0] = _mm_setr_ps(translate[0], translate[1], translate[2],
+            translate[0]);
+        t[1] = _mm_setr_ps(translate[1], translate[2], translate[0],
+            translate[1]);
+        t[2] = _mm_setr_ps(translate[2], translate[0], translate[1],
+            translate[2]);
+    }
+    s = _mm_set1_ps(scale);
+    r2 = _mm_set1_ps(radius2 ? *radius2 : 0);
+
+    for (i = begin; i + 4 <= end; i += 4) {
+        /* (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3) */
+        for (k = 0; k < 3; k++) {
+            v[k] = _mm_loadu_ps(&vertices[3 * i + 4 * k]);
+            if (translate) {
+                v[k] = _mm_mul_ps(_mm_sub_ps(v[k], t[k]), s);
+                _mm_storeu_ps(&vertices[3 * i + 4 * k], v[k]);
+            }
+        }
+        if (!center)
+            continue;
+
+        x = _mm_shuffle_ps(_mm_shuffle_ps(v[0], v[0], _MM_SHUFFLE(0, 3, 0, 0)),
+            _mm_shuffle_ps(v[1], v[2], _MM_SHUFFLE(0, 1, 0, 2)),
+            _MM_SHUFFLE(2, 0, 2, 0));
+        y = _mm_shuffle_ps(_mm_shuffle_ps(v[0], v[1], _MM_SHUFFLE(0, 0, 0, 1)),
+            _mm_shuffle_ps(v[1], v[2], _MM_SHUFFLE(0, 2, 0, 3)),
+            _MM_SHUFFLE(2, 0, 2, 0));
+        z = _mm_shuffle_ps(_mm_shuffle_ps(v[0], v[1], _MM_SHUFFLE(0, 1, 0, 2)),
+            _mm_shuffle_ps(v[2], v[2], _MM_SHUFFLE(0, 3, 0, 0)),
+            _MM_SHUFFLE(2, 0, 2, 0));
+
+        x = _mm_sub_ps(x, _mm_set1_ps(center[0]));
+        y = _mm_sub_ps(y, _mm_set1_ps(center[1]));
+        z = _mm_sub_ps(z, _mm_set1_ps(center[2]));
+        r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+            _mm_mul_ps(z, z));
+        r2 = _mm_max_ps(r, r2);                 /* r > r2 ? r : r2 */
+    }
+
+    if (center) {
+        _mm_storeu_ps(lanes, r2);
+        for (k = 0; k < 4; k++)
+            if (*radius2 < lanes[k])
+                *radius2 = lanes[k];
+    }
+    glmTransformScalar(vertices, i, end, translate, scale, center, radius2);
+}
+#endif
+
+/* glmTransformRange: Translates and scales the vertices in [begin,
+ * end), v = (v - translate) * scale, and in the same sweep measures
+ * their largest squared distance from a center.  Gives exactly the
+ * same vertices as the scalar loop.
+ *
+ * vertices  - packed xyz vertex array
+ * begin     - first vertex
+ * end       - one past the last vertex
+ * translate - translation (NULL to leave the vertices alone)
+ * scale     - scalefactor
+ * center    - center to measure from (NULL not to measure)
+ * radius2   - largest squared distance so far (updated)
+ */
+GLvoid
+glmTransformRange(GLfloat* vertices, GLuint begin, GLuint end,
+                  const GLfloat* translate, GLfloat scale,
+                  const GLfloat* center, GLfloat* radius2)
+{
+#if GLM_SIMD_X86
+    if (glmSimd() >= GLM_SIMD_SSE) {
+        glmTransformSSE(vertices, begin, end, translate, scale, center,
+            radius2);
+        return;
+    }
+#endif
+    glmTransformScalar(vertices, begin, end, translate, scale, center,
+        radius2);
+}
+
+
+/* glmBoundsSoAScalar: one vertex at a time, from separate x, y and z
+ * arrays */
+static GLvoid
+glmBoundsSoAScalar(GLfloat* const* soa, GLuint begin, GLuint end,
+                   GLfloat* min, GLfloat* max)
+{
+    const GLfloat* a;
+    GLfloat lo, hi;
+    GLuint i, j;
+
+    for (j = 0; j < 3; j++) {
+        a = soa[j];
+        lo = min[j];
+        hi = max[j];
+        for (i = begin; i < end; i++) {
+            if (hi < a[i])
+                hi = a[i];
+            if (lo > a[i])
+                lo = a[i];
+        }
+        min[j] = lo;
+        max[j] = hi;
+    }
+}
+
+#if GLM_SIMD_X86
+/* glmBoundsSoASSE: four vertices per component at a time */
+static GLvoid
+glmBoundsSoASSE(GLfloat* const* soa, GLuint begin, GLuint end,
+                GLfloat* min, GLfloat* max)
+{
+    GLfloat lanemin[4], lanemax[4];
+    __m128 lo, hi, v;
+    GLuint i, j, k;
+
+    for (j = 0; j < 3; j++) {
+        lo = _mm_set1_ps(min[j]);
+        hi = _mm_set1_ps(max[j]);
+        for (i = begin; i + 4 <= end; i += 4) {
+            v = _mm_load_ps(&soa[j][i]);
+            lo = _mm_min_ps(v, lo);
+            hi = _mm_max_ps(v, hi);
+        }
+        _mm_storeu_ps(lanemin, lo);
+        _mm_storeu_ps(lanemax, hi);
+        for (k = 0; k < 4; k++) {
+            if (max[j] < lanemax[k])
+                max[j] = lanemax[k];
+            if (min[j] > lanemin[k])
+                min[j] = lanemin[k];
+        }
+    }
+    glmBoundsSoAScalar(soa, begin + ((end - begin) & ~3u), end, min, max);
+}
+#endif
+
+#if GLM_SIMD_AVX2
+/* glmBoundsSoAAVX2: eight vertices per component at a time */
+__attribute__((target("avx2")))
+static GLvoid
+glmBoundsSoAAVX2(GLfloat* const* soa, GLuint begin, GLuint end,
+                 GLfloat* min, GLfloat* max)
+{
+    GLfloat lanemin[8], lanemax[8];
+    __m256 lo, hi, v;
+    GLuint i, j, k;
+
+    for (j = 0; j < 3; j++) {
+        lo = _mm256_set1_ps(min[j]);
+        hi = _mm256_set1_ps(max[j]);
+        for (i = begin; i + 8 <= end; i += 8) {
+            v = _mm256_load_ps(&soa[j][i]);
+            lo = _mm256_min_ps(v, lo);
+            hi = _mm256_max_ps(v, hi);
+        }
+        _mm256_storeu_ps(lanemin, lo);
+        _mm256_storeu_ps(lanemax, hi);
+        for (k = 0; k < 8; k++) {
+            if (max[j] < lanemax[k])
+                max[j] = lanemax[k];
+            if (min[j] > lanemin[k])
+                min[j] = lanemin[k];
+        }
+    }
+    glmBoundsSoAScalar(soa, begin + ((end - begin) & ~7u), end, min, max);
+}
+#endif
+
+/* glmBoundsSoA: Grows a bounding box to take in the vertices in
+ * [begin, end) of separate x, y and z arrays.
+ *
+ * soa   - x, y and z arrays (aligned to GLM_ARENA_ALIGN, from index 0)
+ * begin - first vertex (a multiple of 8)
+ * end   - one past the last vertex
+ * min   - minimum x, y and z so far (updated)
+ * max   - maximum x, y and z so far (updated)
+ */
+GLvoid
+glmBoundsSoA(GLfloat* const* soa, GLuint begin, GLuint end,
+             GLfloat* min, GLfloat* max)
+{
+    int level = glmSimd();
+
+#if GLM_SIMD_AVX2
+    if (level >= GLM_SIMD_AVX) {
+        glmBoundsSoAAVX2(soa, begin, end, min, max);
+        return;
+    }
+#endif
+#if GLM_SIMD_X86
+    if (level >= GLM_SIMD_SSE) {
+        glmBoundsSoASSE(soa, begin, end, min, max);
+        return;
+    }
+#endif
+    glmBoundsSoAScalar(soa, begin, end, min, max);
+}
+
+
+/* glmTransformSoAScalar: one vertex at a time, from separate x, y and
+ * z arrays */
+static GLvoid
+glmTransformSoAScalar(GLfloat* const* soa, GLuint begin, GLuint end,
+                      const GLfloat* translate, GLfloat scale,
+                      const GLfloat* center, GLfloat* radius2)
+{
+    GLfloat d[3], r;
+    GLuint i, j;
+
+    for (i = begin; i < end; i++) {
+        for (j = 0; translate && j < 3; j++)
+            soa[j][i] = (soa[j][i] - translate[j]) * scale;
+        if (center) {
+            d[0] = soa[0][i] - center[0];
+            d[1] = soa[1][i] - center[1];
+            d[2] = soa[2][i] - center[2];
+            r = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+            if (*radius2 < r)
+                *radius2 = r;
+        }
+    }
+}
+
+#if GLM_SIMD_X86
+/* glmTransformSoASSE: four vertices at a time */
+static GLvoid
+glmTransformSoASSE(GLfloat* const* soa, GLuint begin, GLuint end,
+                   const GLfloat* translate, GLfloat scale,
+                   const GLfloat* center, GLfloat* radius2)
+{
+    __m128 v[3], d, r, r2, s;
+    GLfloat lanes[4];
+    GLuint i, j, k;
+
+    s = _mm_set1_ps(scale);
+    r2 = _mm_set1_ps(radius2 ? *radius2 : 0);
+
+    for (i = begin; i + 4 <= end; i += 4) {
+        for (j = 0; j < 3; j++) {
+            v[j] = _mm_load_ps(&soa[j][i]);
+            if (translate) {
+                v[j] = _mm_mul_ps(_mm_sub_ps(v[j],
+                    _mm_set1_ps(translate[j])), s);
+                _mm_store_ps(&soa[j][i], v[j]);
+            }
+        }
+        if (!center)
+            continue;
+
+        d = _mm_sub_ps(v[0], _mm_set1_ps(center[0]));
+        r = _mm_mul_ps(d, d);
+        d = _mm_sub_ps(v[1], _mm_set1_ps(center[1]));
+        r = _mm_add_ps(r, _mm_mul_ps(d, d));
+        d = _mm_sub_ps(v[2], _mm_set1_ps(center[2]));
+        r = _mm_add_ps(r, _mm_mul_ps(d, d));
+        r2 = _mm_max_ps(r, r2);
+    }
+
+    if (center) {
+        _mm_storeu_ps(lanes, r2);
+        for (k = 0; k < 4; k++)
+            if (*radius2 < lanes[k])
+                *radius2 = lanes[k];
+    }
+    glmTransformSoAScalar(soa, i, end, translate, scale, center, radius2);
+}
+#endif
+
+#if GLM_SIMD_AVX2
+/* glmTransformSoAAVX2: eight vertices at a time */
+__attribute__((target("avx2")))
+static GLvoid
+glmTransformSoAAVX2(GLfloat* const* soa, GLuint begin, GLuint end,
+                    const GLfloat* translate, GLfloat scale,
+                    const GLfloat* center, GLfloat* radius2)
+{
+    __m256 v[3], d, r, r2, s;
+    GLfloat lanes[8];
+    GLuint i, j, k;
+
+    s = _mm256_set1_ps(scale);
+    r2 = _mm256_set1_ps(radius2 ? *radius2 : 0);
+
+    for (i = begin; i + 8 <= end; i += 8) {
+        for (j = 0; j < 3; j++) {
+            v[j] = _mm256_load_ps(&soa[j][i]);
+            if (translate) {
+                v[j] = _mm256_mul_ps(_mm256_sub_ps(v[j],
+                    _mm256_set1_ps(translate[j])), s);
+                _mm256_store_ps(&soa[j][i], v[j]);
+            }
+        }
+        if (!center)
+            continue;
+
+        d = _mm256_sub_ps(v[0], _mm256_set1_ps(center[0]));
+        r = _mm256_mul_ps(d, d);
+        d = _mm256_sub_ps(v[1], _mm256_set1_ps(center[1]));
+        r = _mm256_add_ps(r, _mm256_mul_ps(d, d));
+        d = _mm256_sub_ps(v[2], _mm256_set1_ps(center[2]));
+        r = _mm256_add_ps(r, _mm256_mul_ps(d, d));
+        r2 = _mm256_max_ps(r, r2);
+    }
+
+    if (center) {
+        _mm256_storeu_ps(lanes, r2);
+        for (k = 0; k < 8; k++)
+            if (*radius2 < lanes[k])
+                *radius2 = lanes[k];
+    }
+    glmTransformSoAScalar(soa, i, end, translate, scale, center, radius2);
+}
+#endif
+
+/* glmTransformSoA: glmTransformRange() for separate x, y and z
+ * arrays.
+ *
+ * soa       - x, y and z arrays (aligned to GLM_ARENA_ALIGN, from index 0)
+ * begin     - first vertex (a multiple of 8)
+ * end       - one past the last vertex
+ * translate - translation (NULL to leave the vertices alone)
+ * scale     - scalefactor
+ * center    - center to measure from (NULL not to measure)
+ * radius2   - largest squared distance so far (updated)
+ */
+GLvoid
+glmTransformSoA(GLfloat* const* soa, GLuint begin, GLuint end,
+                const GLfloat* translate, GLfloat scale,
+                const GLfloat* center, GLfloat* radius2)
+{
+    int level = glmSimd();
+
+#if GLM_SIMD_AVX2
+    if (level >= GLM_SIMD_AVX) {
+        glmTransformSoAAVX2(soa, begin, end, translate, scale, center,
+            radius2);
+        return;
+    }
+#endif
+#if GLM_SIMD_X86
+    if (level >= GLM_SIMD_SSE) {
+        glmTransformSoASSE(soa, begin, end, translate, scale, center,
+            radius2);
+        return;
+    }
+#endif
+    glmTransformSoAScalar(soa, begin, end, translate, scale, center,
+        radius2);
+}
@@ -0,0 +1,403 @@
+/*
+      glmstate.cpp
+
+      Fixed function state cache for the GLM library.
+
+      Most of the state a frame sets is the state the last frame left:
+      the same texture bound, the same material on group after group,
+      the same color on limb after limb.  The glm* versions of
+      glEnable(), glBindTexture(), glMaterial*(), glColor*() and
+      glTexGeni() here remember what they last set and drop a call that
+      wouldn't change anything.  State starts out unknown, so the first
+      call always goes through, and glmForgetState() makes it unknown
+      again after OpenGL calls made behind the cache's back (a display
+      list, glPopAttrib()).  There is one cache, for the current
+      context.
+
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "glm.h"
+#include "glmint.h"
+
+
+/* the capabilities whose enable bits are shadowed */
+static const GLenum glm_state_caps[] = {
+    GL_LIGHTING, GL_LIGHT0, GL_LIGHT1, GL_LIGHT2, GL_LIGHT3, GL_LIGHT4,
+    GL_LIGHT5, GL_LIGHT6, GL_LIGHT7, GL_DEPTH_TEST, GL_NORMALIZE,
+    GL_CULL_FACE, GL_BLEND, GL_COLOR_MATERIAL, GL_TEXTURE_2D,
+    GL_TEXTURE_GEN_S, GL_TEXTURE_GEN_T, GL_TEXTURE_GEN_R, GL_TEXTURE_GEN_Q,
+};
+
+#define GLM_STATE_CAPS (sizeof(glm_state_caps) / sizeof(glm_state_caps[0]))
+
+/* the material parameters shadowed, per face */
+static const GLenum glm_state_materials[] = {
+    GL_AMBIENT, GL_DIFFUSE, GL_SPECULAR, GL_EMISSION, GL_SHININESS,
+};
+
+#define GLM_STATE_MATERIALS 5
+
+
+/* GLMstate: Structure that holds what the cache knows of the OpenGL
+ * state, and the calls it let through and dropped.
+ */
+typedef struct _GLMstate {
+  GLubyte   enabled[GLM_STATE_CAPS];    /* 0 unknown, 1 off, 2 on */
+  GLboolean textureknown;               /* texture is the bound 2D one */
+  GLuint    texture;
+  GLboolean materialknown[2][GLM_STATE_MATERIALS]; /* front, back */
+  GLfloat   material[2][GLM_STATE_MATERIALS][4];
+  GLboolean colormaterialknown;         /* glColorMaterial() face, mode */
+  GLenum    colormaterial[2];
+  GLboolean colorknown;                 /* current color */
+  GLfloat   color[4];
+  GLboolean texgenknown[4];             /* GL_TEXTURE_GEN_MODE of s, t, r, q */
+  GLint     texgen[4];
+
+  GLuint    issued;                     /* calls passed on to OpenGL */
+  GLuint    avoided;                    /* calls dropped */
+} GLMstate;
+
+static GLMstate glm_state;       /* all unknown to start with */
+
+
+/* glmStateCap: index of a shadowed capability, or -1 */
+static int
+glmStateCap(GLenum cap)
+{
+    GLuint i;
+
+    for (i = 0; i < GLM_STATE_CAPS; i++)
+        if (glm_state_caps[i] == cap)
+            return i;
+    return -1;
+}
+
+/* glmMaterialSlots: the faces and shadowed parameters a material
+ * parameter sets */
+static GLvoid
+glmMaterialSlots(GLenum face, GLenum pname, GLuint* faces, GLuint* numfaces,
+    GLuint* slots, GLuint* numslots)
+{
+    GLuint j;
+
+    *numfaces = 0;
+    if (face != GL_BACK)
+        faces[(*numfaces)++] = 0;
+    if (face != GL_FRONT)
+        faces[(*numfaces)++] = 1;
+    *numslots = 0;
+    for (j = 0; j < GLM_STATE_MATERIALS; j++)
+        if (glm_state_materials[j] == pname ||
+            (pname == GL_AMBIENT_AND_DIFFUSE &&
+             (glm_state_materials[j] == GL_AMBIENT ||
+              glm_state_materials[j] == GL_DIFFUSE)))
+            slots[(*numslots)++] = j;
+}
+
+/* glmMaterialKnown: whether the shadowed material already is params */
+static GLboolean
+glmMaterialKnown(GLenum face, GLenum pname, const GLfloat* params)
+{
+    GLuint faces[2], numfaces, slots[2], numslots, i, j;
+
+    glmMaterialSlots(face, pname, faces, &numfaces, slots, &numslots);
+    if (!numslots)
+        return GL_FALSE;
+    for (i = 0; i < numfaces; i++)
+        for (j = 0; j < numslots; j++)
+            if (!glm_state.materialknown[faces[i]][slots[j]] ||
+                memcmp(glm_state.material[faces[i]][slots[j]], params,
+                    sizeof(GLfloat) * (pname == GL_SHININESS ? 1 : 4)))
+                return GL_FALSE;
+    return GL_TRUE;
+}
+
+/* glmMaterialSet: shadow a material parameter that was set */
+static GLvoid
+glmMaterialSet(GLenum face, GLenum pname, const GLfloat* params)
+{
+    GLuint faces[2], numfaces, slots[2], numslots, i, j;
+
+    glmMaterialSlots(face, pname, faces, &numfaces, slots, &numslots);
+    for (i = 0; i < numfaces; i++) {
+        for (j = 0; j < numslots; j++) {
+            glm_state.materialknown[faces[i]][slots[j]] = GL_TRUE;
+            memcpy(glm_state.material[faces[i]][slots[j]], params,
+                sizeof(GLfloat) * (pname == GL_SHININESS ? 1 : 4));
+        }
+    }
+}
+
+/* glmColorTracked: with color material on, every glColor*() (and the
+ * glEnable()) copies the color into the material parameters
+ * glColorMaterial() picked; shadow that, or forget the material if it
+ * isn't known what was copied where */
+static GLvoid
+glmColorTracked(GLvoid)
+{
+    if (glm_state.enabled[glmStateCap(GL_COLOR_MATERIAL)] == 1)
+        return;
+    if (glm_state.enabled[glmStateCap(GL_COLOR_MATERIAL)] == 2 &&
+        glm_state.colormaterialknown && glm_state.colorknown)
+        glmMaterialSet(glm_state.colormaterial[0], glm_state.colormaterial[1],
+            glm_state.color);
+    else
+        memset(glm_state.materialknown, 0, sizeof(glm_state.materialknown));
+}
+
+/* glmSetEnabled: glEnable() or glDisable() unless cap already is */
+static GLvoid
+glmSetEnabled(GLenum cap, GLboolean enable)
+{
+    int i;
+
+    i = glmStateCap(cap);
+    if (i >= 0 && glm_state.enabled[i] == enable + 1) {
+        glm_state.avoided++;
+        return;
+    }
+
+    glm_state.issued++;
+    if (enable)
+        glEnable(cap);
+    else
+        glDisable(cap);
+    if (i < 0)
+        return;
+    glm_state.enabled[i] = enable + 1;
+    if (cap == GL_COLOR_MATERIAL && enable)
+        glmColorTracked();
+}
+
+/* glmEnable: glEnable() through the state cache.
+ *
+ * cap - capability to enable
+ */
+GLvoid
+glmEnable(GLenum cap)
+{
+    glmSetEnabled(cap, GL_TRUE);
+}
+
+/* glmDisable: glDisable() through the state cache.
+ *
+ * cap - capability to disable
+ */
+GLvoid
+glmDisable(GLenum cap)
+{
+    glmSetEnabled(cap, GL_FALSE);
+}
+
+/* glmBindTexture: glBindTexture() through the state cache.
+ *
+ * target  - texture target (only GL_TEXTURE_2D is shadowed)
+ * texture - texture object to bind
+ */
+GLvoid
+glmBindTexture(GLenum target, GLuint texture)
+{
+    if (target == GL_TEXTURE_2D && glm_state.textureknown &&
+        glm_state.texture == texture) {
+        glm_state.avoided++;
+        return;
+    }
+
+    glm_state.issued++;
+    glBindTexture(target, texture);
+    if (target == GL_TEXTURE_2D) {
+        glm_state.textureknown = GL_TRUE;
+        glm_state.texture = texture;
+    }
+}
+
+/* glmMaterialfv: glMaterialfv() through the state cache.
+ *
+ * face   - GL_FRONT, GL_BACK or GL_FRONT_AND_BACK
+ * pname  - material parameter (GL_AMBIENT_AND_DIFFUSE sets two)
+ * params - its value
+ */
+GLvoid
+glmMaterialfv(GLenum face, GLenum pname, const GLfloat* params)
+{
+    if (glmMaterialKnown(face, pname, params)) {
+        glm_state.avoided++;
+        return;
+    }
+
+    glm_state.issued++;
+    glMaterialfv(face, pname, params);
+    glmMaterialSet(face, pname, params);
+
+    /* the parameters that follow the color keep it */
+    glmColorTracked();
+}
+
+/* glmMaterialf: glMaterialf() through the state cache.
+ *
+ * face  - GL_FRONT, GL_BACK or GL_FRONT_AND_BACK
+ * pname - GL_SHININESS
+ * param - its value
+ */
+GLvoid
+glmMaterialf(GLenum face, GLenum pname, GLfloat param)
+{
+    glmMaterialfv(face, pname, &param);
+}
+
+/* glmColorMaterial: glColorMaterial() through the state cache.
+ *
+ * face - GL_FRONT, GL_BACK or GL_FRONT_AND_BACK
+ * mode - material parameter that follows the current color
+ */
+GLvoid
+glmColorMaterial(GLenum face, GLenum mode)
+{
+    if (glm_state.colormaterialknown && glm_state.colormaterial[0] == face &&
+        glm_state.colormaterial[1] == mode) {
+        glm_state.avoided++;
+        return;
+    }
+
+    glm_state.issued++;
+    glColorMaterial(face, mode);
+    glm_state.colormaterialknown = GL_TRUE;
+    glm_state.colormaterial[0] = face;
+    glm_state.colormaterial[1] = mode;
+    glmColorTracked();
+}
+
+/* glmColor4fv: glColor4fv() through the state cache.
+ *
+ * v - red, green, blue and alpha
+ */
+GLvoid
+glmColor4fv(const GLfloat* v)
+{
+    GLubyte colormaterial;
+
+    /* with color material on, the same color is only redundant if the
+       material still holds it too */
+    colormaterial = glm_state.enabled[glmStateCap(GL_COLOR_MATERIAL)];
+    if (glm_state.colorknown &&
+        !memcmp(glm_state.color, v, sizeof(GLfloat) * 4) &&
+        (colormaterial == 1 || (colormaterial == 2 &&
+         glm_state.colormaterialknown &&
+         glmMaterialKnown(glm_state.colormaterial[0],
+             glm_state.colormaterial[1], v)))) {
+        glm_state.avoided++;
+        return;
+    }
+
+    glm_state.issued++;
+    glColor4fv(v);
+    glm_state.colorknown = GL_TRUE;
+    memcpy(glm_state.color, v, sizeof(GLfloat) * 4);
+    glmColorTracked();
+}
+
+/* glmColor3fv: glColor3fv() through the state cache.
+ *
+ * v - red, green and blue (alpha is 1)
+ */
+GLvoid
+glmColor3fv(const GLfloat* v)
+{
+    GLfloat color[4];
+
+    color[0] = v[0];
+    color[1] = v[1];
+    color[2] = v[2];
+    color[3] = 1.0;
+    glmColor4fv(color);
+}
+
+/* glmColor3ub: glColor3ub() through the state cache.
+ *
+ * red, green, blue - color components (alpha is 1)
+ */
+GLvoid
+glmColor3ub(GLubyte red, GLubyte green, GLubyte blue)
+{
+    GLfloat color[4];
+
+    color[0] = red / 255.0f;
+    color[1] = green / 255.0f;
+    color[2] = blue / 255.0f;
+    color[3] = 1.0;
+    glmColor4fv(color);
+}
+
+/* glmTexGeni: glTexGeni() through the state cache.
+ *
+ * coord - GL_S, GL_T, GL_R or GL_Q
+ * pname - GL_TEXTURE_GEN_MODE (others are passed on)
+ * param - its value
+ */
+GLvoid
+glmTexGeni(GLenum coord, GLenum pname, GLint param)
+{
+    GLuint i;
+
+    i = coord - GL_S;
+    if (pname == GL_TEXTURE_GEN_MODE && i < 4 && glm_state.texgenknown[i] &&
+        glm_state.texgen[i] == param) {
+        glm_state.avoided++;
+        return;
+    }
+
+    glm_state.issued++;
+    glTexGeni(coord, pname, param);
+    if (pname == GL_TEXTURE_GEN_MODE && i < 4) {
+        glm_state.texgenknown[i] = GL_TRUE;
+        glm_state.texgen[i] = param;
+    }
+}
+
+/* glmForgetState: Makes state the cache shadows unknown again, so the
+ * next call that sets it goes through.
+ *
+ * mask - glPushAttrib() style bits of the state to forget
+ *            GL_ENABLE_BIT   -  enable bits
+ *            GL_TEXTURE_BIT  -  bound texture and texture generation
+ *            GL_LIGHTING_BIT -  materials and color material
+ *            GL_CURRENT_BIT  -  current color
+ *            GL_ALL_ATTRIB_BITS for all of it
+ */
+GLvoid
+glmForgetState(GLbitfield mask)
+{
+    if (mask & GL_ENABLE_BIT)
+        memset(glm_state.enabled, 0, sizeof(glm_state.enabled));
+    if (mask & GL_TEXTURE_BIT) {
+        glm_state.textureknown = GL_FALSE;
+        memset(glm_state.texgenknown, 0, sizeof(glm_state.texgenknown));
+    }
+    if (mask & GL_LIGHTING_BIT) {
+        memset(glm_state.materialknown, 0, sizeof(glm_state.materialknown));
+        glm_state.colormaterialknown = GL_FALSE;
+    }
+    if (mask & GL_CURRENT_BIT)
+        glm_state.colorknown = GL_FALSE;
+}
+
+/* glmStateCounts: Returns how many calls the state cache passed on to
+ * OpenGL and how many it dropped since the last time it was asked.
+ *
+ * issued  - calls passed on
+ * avoided - calls dropped as redundant
+ */
+GLvoid
+glmStateCounts(GLuint* issued, GLuint* avoided)
+{
+    *issued = glm_state.issued;
+    *avoided = glm_state.avoided;
+    glm_state.issued = 0;
+    glm_state.avoided = 0;
+}
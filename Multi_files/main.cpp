@@ -42,8 +42,11 @@
  * Interaction:  pressing the s and e keys (shoulder and elbow)
  * alters the rotation of the robot arm.
  */
+// for glBeginQuery() and friends (OpenGL 1.5)
+#define GL_GLEXT_PROTOTYPES
 #include <GL/glut.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 // for testing purpose
 #include <stdio.h>
@@ -66,11 +69,74 @@ int moving, startx, starty;
 
 // this is to compile to C++ ISO as it forbids converting char* to constant string
 char path[] = "res/obj/flowers.obj";
-GLMmodel* flower = glmReadOBJ(path);
+GLMmodel* flower;
 char path2[] = "res/obj/bed.obj";
-GLMmodel* bed = glmReadOBJ(path2);
+GLMmodel* bed;
 char path3[] = "res/obj/wardrobe.obj";
-GLMmodel* ward = glmReadOBJ(path3);
+GLMmodel* ward;
+// the models in buffer objects, once they are loaded and prepared
+GLMmesh* flowermesh;
+GLMmesh* bedmesh;
+GLMmesh* wardmesh;
+// how the prepared models are drawn: from their buffer objects, from
+// cached display lists, or with glmDraw() ('i' key, -lists, -immediate)
+enum { DRAW_MESHES, DRAW_LISTS, DRAW_IMMEDIATE };
+static int drawpath = DRAW_MESHES;
+GLMlistcache* lists;
+// the furniture meshes, the floor and the robot are queued each frame and
+// drawn sorted by texture, material and distance (glmQueueFlush())
+GLMqueue* queue;
+// the cubes the robot is made of, drawn together with one draw call
+GLMbatch* robot;
+
+// milliseconds of OBJ parsing per frame while the models stream in
+#define LOAD_BUDGET 2.0
+
+// levels of detail made for each model (fractions of its triangles); the
+// one drawn is picked by how far away the model is on screen
+static GLfloat lod_ratios[] = { 0.5f, 0.25f, 0.1f };
+
+// overdraw measurement ('o' key or -fragments): count the fragments that
+// pass the depth test (and so get shaded) and print the average per frame
+#define FRAGMENT_FRAMES 60
+static bool count_fragments = false;
+static GLuint fragment_query = 0;
+static unsigned long long fragment_total = 0;
+static int fragment_frames = 0;
+
+// state cache measurement ('c' key or -state): print the average number of
+// state calls per frame that went to OpenGL and that were dropped
+#define STATE_FRAMES 60
+static bool count_state = false;
+static unsigned long long state_issued = 0;
+static unsigned long long state_avoided = 0;
+static int state_frames = 0;
+
+// frames are drawn on demand: whatever changes the picture calls redraw(),
+// and however many times it is called before the frame is drawn, it gets
+// drawn once. With a frame rate cap (-fps N) the frame waits until
+// 1/N seconds after the last one started
+static int max_fps = 0;
+static bool frame_posted = false;
+static int frame_start = 0;
+
+static void postframe(int)
+{
+  if (frame_posted)
+    glutPostRedisplay();
+}
+
+void redraw(void)
+{
+  if (frame_posted)
+    return;
+  frame_posted = true;
+  int wait = max_fps ? frame_start + 1000 / max_fps - glutGet(GLUT_ELAPSED_TIME) : 0;
+  if (wait > 0)
+    glutTimerFunc(wait, postframe, 0);
+  else
+    glutPostRedisplay();
+}
 
 GLfloat light_ambient[] = { 0.1, 0.1, 0.1, 1.0 };
 GLfloat light_diffuse[] = { 1.0, 1.0, 1.0,1.0 };
@@ -79,14 +145,17 @@ GLfloat light_specular[] = {0.1, 0.1, 0.1, 1.0 };
 GLfloat light_position[] = {0.0,5.0, 10.0, 1.0 };
 // material properties
 GLfloat mat_amb_diff[] = {0.643, 0.753, 0.934, 1.0 };
-//GLfloat mat_specular[] = { 0.0, 0.0, 0.0, 1.0 };
-//GLfloat shininess[] = {100.0 };
+GLfloat mat_specular[] = { 0.0, 0.0, 0.0, 1.0 };
+GLfloat shininess[] = {100.0 };
+// the material of the floor and the robot, whose diffuse color comes from
+// the color they are queued with
+GLMmaterial paint;
 
 //Makes the image into a texture, and returns the id of the texture
 GLuint loadTexture(Image* image) {
       GLuint textureId;
       glGenTextures(1, &textureId); //Make room for our texture
-      glBindTexture(GL_TEXTURE_2D, textureId); //Tell OpenGL which texture to edit
+      glmBindTexture(GL_TEXTURE_2D, textureId); //Tell OpenGL which texture to edit
       //Map the image to the texture
       glTexImage2D(GL_TEXTURE_2D,                //Always GL_TEXTURE_2D
                                0,                            //0 for now
@@ -97,6 +166,9 @@ GLuint loadTexture(Image* image) {
                                GL_UNSIGNED_BYTE, //GL_UNSIGNED_BYTE, because pixels are stored
                                                  //as unsigned numbers
                                image->pixels);               //The actual pixel data
+      //Filtering is part of the texture, so it only has to be set once
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
       return textureId; //Returns the id of the texture
 }
 
@@ -140,6 +212,7 @@ void reset(int x)
   hip_l = 0.0f, knee_l = 0.0f, ankle_l = 0.0f, abduct_l = 0.0f;
   torso_f = 0.0f, upperback_f = 0.0f, elbow = 0.0f;
   offset_x = 0.0f, offset_y = 0.0f, offset_z = 0.0f;
+  redraw();
 }
 
 void init_anim1(void)
@@ -330,7 +403,7 @@ void play_anim3(int frame)
 void Timer1(int t)
 {
   play_anim1(t);
-  glutPostRedisplay();
+  redraw();
   // play at 60 frames per second
   if(play)
     if(t < 200)
@@ -343,7 +416,7 @@ void Timer1(int t)
 void Timer2(int t)
 {
   play_anim2(t);
-  glutPostRedisplay();
+  redraw();
   // play at 60 frames per second
   if(play)
     if(t < 270)
@@ -355,7 +428,7 @@ void Timer2(int t)
 void Timer3(int t)
 {
   play_anim3(t);
-  glutPostRedisplay();
+  redraw();
   // play at 60 frames per second
   if(play)
     if(t < 289)
@@ -371,6 +444,98 @@ void setplay(int t)
     play = false;
 }
 
+// unitize a loaded model, compute its normals, scale it and make its
+// levels of detail, then cut them all into meshlets for culling and
+// put them in buffer objects
+GLMmesh* preparemodel(GLMmodel* model)
+{
+  GLfloat ratio;
+
+  glmPrepare(model, 8.0, 90.0);
+  glmBuildLODs(model, sizeof(lod_ratios) / sizeof(lod_ratios[0]), lod_ratios);
+  glmBuildMeshlets(model, GLM_MESHLET_TRIANGLES, GLM_MESHLET_ANGLE);
+  ratio = glmBuildIndexed(model, GLM_SMOOTH);
+  printf("%s: %u vertices, %u indexed (%.2fx duplicated), %s indices\n",
+         model->pathname, model->numvertices, model->numinterleaved, ratio,
+         model->indextype == GL_UNSIGNED_SHORT ? "16 bit" : "32 bit");
+  return glmNewMesh(model, GLM_SMOOTH);
+}
+
+// parse the next slice of the first model still loading, and prepare it
+// once it is complete. Stops being called when all models are loaded
+void loadmodels(void)
+{
+  GLMmodel* models[] = { flower, bed, ward };
+  GLMmesh** meshes[] = { &flowermesh, &bedmesh, &wardmesh };
+
+  for (int i = 0; i < 3; i++) {
+    if (!models[i]->stream)
+      continue;
+    if (glmStreamStep(models[i], LOAD_BUDGET))
+      *meshes[i] = preparemodel(models[i]);
+    redraw();
+    return;
+  }
+  glutIdleFunc(NULL);
+}
+
+// start counting the fragments of a frame
+void beginfragments(void)
+{
+  if (!count_fragments)
+    return;
+  if (!fragment_query)
+    glGenQueries(1, &fragment_query);
+  glBeginQuery(GL_SAMPLES_PASSED, fragment_query);
+}
+
+// stop counting, and every FRAGMENT_FRAMES frames print the average number
+// of fragments shaded per frame and per pixel of the window
+void endfragments(void)
+{
+  GLuint fragments;
+  int pixels;
+
+  if (!count_fragments)
+    return;
+  glEndQuery(GL_SAMPLES_PASSED);
+  glGetQueryObjectuiv(fragment_query, GL_QUERY_RESULT, &fragments);
+  fragment_total += fragments;
+  if (++fragment_frames < FRAGMENT_FRAMES)
+    return;
+
+  pixels = glutGet(GLUT_WINDOW_WIDTH) * glutGet(GLUT_WINDOW_HEIGHT);
+  printf("fragments: %.0f per frame, %.2f per pixel\n",
+    (double)fragment_total / fragment_frames,
+    (double)fragment_total / fragment_frames / pixels);
+  fflush(stdout);
+  fragment_total = 0;
+  fragment_frames = 0;
+}
+
+// add up the state calls of a frame, and every STATE_FRAMES frames print
+// the averages
+void endstate(void)
+{
+  GLuint issued, avoided;
+
+  glmStateCounts(&issued, &avoided);
+  if (!count_state)
+    return;
+  state_issued += issued;
+  state_avoided += avoided;
+  if (++state_frames < STATE_FRAMES)
+    return;
+
+  printf("state calls: %.1f per frame issued, %.1f avoided\n",
+    (double)state_issued / state_frames,
+    (double)state_avoided / state_frames);
+  fflush(stdout);
+  state_issued = 0;
+  state_avoided = 0;
+  state_frames = 0;
+}
+
 void init(void)
 {
   //set background color
@@ -394,90 +559,141 @@ void init(void)
     _texture = &_tex_brick1;
   }
   GLfloat zPlane[] = { 1.0f, 1.0f, 0.0f, 0.0f };
-  glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
-  glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+  glmTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+  glmTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
 
-  glEnable(GL_LIGHTING);
+  glmEnable(GL_LIGHTING);
   // Flip light switch
-  glEnable(GL_LIGHT0);
+  glmEnable(GL_LIGHT0);
 
   glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
   glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
   glLightfv(GL_LIGHT0, GL_SPECULAR, light_specular);
 
-  glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,mat_amb_diff);
+  glmMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,mat_amb_diff);
 
-  glEnable(GL_NORMALIZE);
+  glmEnable(GL_NORMALIZE);
 
   glShadeModel(GL_SMOOTH);
   // Enable Depth buffer
-  glEnable(GL_DEPTH_TEST);
+  glmEnable(GL_DEPTH_TEST);
+
+  lists = glmNewListCache(GLM_LIST_CACHE);
+  queue = glmNewQueue();
+  robot = glmNewCubeBatch();
+  memcpy(paint.ambient, mat_amb_diff, sizeof(paint.ambient));
+  memcpy(paint.diffuse, mat_amb_diff, sizeof(paint.diffuse));
+  memcpy(paint.specular, mat_specular, sizeof(paint.specular));
+  paint.shininess = shininess[0];
+
+  // start loading the models; the idle loop parses them a bit per frame
+  // so the window comes up right away. Models read from their cache are
+  // complete already, so unitize, compute normals and scale them now
+  flower = glmStreamOBJ(path);
+  bed = glmStreamOBJ(path2);
+  ward = glmStreamOBJ(path3);
+  if (!flower->stream) flowermesh = preparemodel(flower);
+  if (!bed->stream) bedmesh = preparemodel(bed);
+  if (!ward->stream) wardmesh = preparemodel(ward);
+  glutIdleFunc(loadmodels);
 }
 
 
+// the models are unitized, given normals and scaled once they are loaded,
+// so drawing them only has to refresh normals if their vertices changed,
+// pick the level of detail that looks the same at this distance, and
+// skip the meshlets that are off screen or facing away; the level is drawn
+// from its buffer objects, or from a display list (which can't cull).
+// While a model is still loading, the triangles read so far are drawn flat
+// shaded, placed where glmPrepare() will put them
+void drawmodel(GLMmodel* model, GLMmesh* mesh)
+{
+		if (model->stream) {
+			glPushMatrix();
+			glmStreamTransform(model, 8.0);
+			glmDraw(model, GLM_FLAT | GLM_MATERIAL);
+			glPopMatrix();
+			return;
+		}
+		glmUpdate(model, 90.0);
+		if (mesh && drawpath == DRAW_MESHES) {
+			glmQueueMesh(queue, glmMeshLOD(mesh, GLM_LOD_PIXELS),
+				GLM_MATERIAL | GLM_CULL);
+			return;
+		}
+		if (drawpath == DRAW_LISTS) {
+			glmCallList(lists, glmLOD(model, GLM_LOD_PIXELS),
+				GLM_SMOOTH | GLM_MATERIAL);
+			return;
+		}
+		glmDraw(glmLOD(model, GLM_LOD_PIXELS),
+			GLM_SMOOTH | GLM_MATERIAL | GLM_CULL);
+}
+
 void drawflower(void)
 {
-		glmUnitize(flower);
-		glmFacetNormals(flower);
-		glmVertexNormals(flower, 90.0);
-		glmScale(flower, 8);
-		glmDraw(flower, GLM_SMOOTH | GLM_MATERIAL);
+		drawmodel(flower, flowermesh);
 }
 
 void drawbed(void)
 {
-		glmUnitize(bed);
-		glmFacetNormals(bed);
-		glmVertexNormals(bed, 90.0);
-		glmScale(bed, 8);
-		glmDraw(bed, GLM_SMOOTH | GLM_MATERIAL);
+		drawmodel(bed, bedmesh);
 }
 
 void drawward(void)
 {
-		glmUnitize(ward);
-		glmFacetNormals(ward);
-		glmVertexNormals(ward, 90.0);
-		glmScale(ward, 8);
-		glmDraw(ward, GLM_SMOOTH | GLM_MATERIAL);
+		drawmodel(ward, wardmesh);
 }
 
+// the floor is queued with its texture; the queue binds it and draws this
+static void floorcube(GLvoid*)
+{
+  glmEnable(GL_TEXTURE_GEN_S); //enable texture coordinate generation
+  glmEnable(GL_TEXTURE_GEN_T);
+  glmDrawPrimitive(GLM_CUBE, GLM_LOD_PIXELS);
+  glmDisable(GL_TEXTURE_GEN_S);
+  glmDisable(GL_TEXTURE_GEN_T);
+}
 
 void drawfloor(void)
 {
+  static GLfloat white[] = { 1.0f, 1.0f, 1.0f, 1.0f };
   glPushMatrix();
 
-  glEnable(GL_TEXTURE_2D);
-
-  glEnable(GL_TEXTURE_GEN_S); //enable texture coordinate generation
-  glEnable(GL_TEXTURE_GEN_T);
-  glBindTexture(GL_TEXTURE_2D, *_texture);
-
-
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
   glRotatef(90.0f, 1.0f,0.0f,0.0f);
   glScalef(50.0f, 50.0f, 0.5f);
   glTranslatef(0.0f,0.0f,20.0f);
-  glutSolidCube(1.0f);
-  glDisable(GL_TEXTURE_GEN_S); //enable texture coordinate generation
-  glDisable(GL_TEXTURE_GEN_T);
-  glDisable(GL_TEXTURE_2D);
+  glmQueueCall(queue, GLM_QUEUE_OPAQUE, *_texture, &paint, white, NULL,
+               floorcube, NULL);
   glPopMatrix();
 }
 
+static void sphere(GLvoid*)
+{
+  glmDrawPrimitive(GLM_SPHERE, GLM_LOD_PIXELS);
+}
+
+static void cubes(GLvoid* data)
+{
+  glmDrawBatch((GLMbatch*)data);
+}
+
+// add a cube of the robot, in the given color, where it is now
+void part(GLubyte r, GLubyte g, GLubyte b)
+{
+  GLfloat color[4] = { r / 255.0f, g / 255.0f, b / 255.0f, 1.0f };
+  glmBatchAdd(robot, color);
+}
+
 // make lower back (torso)
 // the torso the parent of hierarchy of all bones
 void torso(void)
 {
   // any rotation and translation should be made here in this line
   glPushMatrix();
-  glColor3ub (0, 255, 0);
   glTranslatef (0.0f, 0.0f, 2.0f);
   glScalef(4.0f, 1.0f, 3.0f);
-  glutSolidCube(1.0f);
+  part(0, 255, 0);
 
   glPopMatrix();
 }
@@ -490,19 +706,18 @@ void upperback(void)
   glRotatef ((GLfloat) upperback_f, 1.0f,0.0f, 0.0f);
   glTranslatef (0.0f, 0.0f, 2.0f);
   glPushMatrix();
-  glColor3ub (0, 255, 0);
   glScalef(4.0f, 1.0f, 3.0f);
-  glutSolidCube(1.0f);
+  part(0, 255, 0);
   glPopMatrix();
 }
 
 void head(void)
 {
   glPushMatrix();
-  // skin color
-  glColor3ub (80, 73, 60);
   glTranslatef(0.0f, 0.0f, 3.5f);
-  glutSolidSphere(1.0, 20,20);
+  // skin color
+  GLfloat skin[4] = { 80 / 255.0f, 73 / 255.0f, 60 / 255.0f, 1.0f };
+  glmQueueCall(queue, GLM_QUEUE_OPAQUE, 0, &paint, skin, NULL, sphere, NULL);
   glPopMatrix();
 }
 
@@ -528,8 +743,7 @@ void shoulders(GLfloat scale = 1.0f)
   glTranslatef (scale * 1.2f, 0.0f, 0.0f);
   glPushMatrix();
   glScalef (3.0f, 0.6f, 1.0f);
-  glColor3ub (0, 255, 0);
-  glutSolidCube (1.0f);
+  part(0, 255, 0);
   glPopMatrix();
 }
 
@@ -542,8 +756,7 @@ void elbows(GLfloat scale = 1.0f)
   glTranslatef (scale * 1.5f, 0.0f, 0.0f);
   glPushMatrix();
   glScalef (3.0f, 0.6f, 1.0f);
-  glColor3ub (0, 255, 0);
-  glutSolidCube (1.0f);
+  part(0, 255, 0);
   glPopMatrix();
 }
 
@@ -560,8 +773,7 @@ void Flang(GLfloat offset, GLfloat scale = 1.0f)
   glPushMatrix();
   glScalef(0.3, 0.1, 0.1);
   // skin color
-  glColor3ub (80, 73, 60);
-  glutSolidCube(1.0f);
+  part(80, 73, 60);
   glPopMatrix();
 
 
@@ -571,7 +783,7 @@ void Flang(GLfloat offset, GLfloat scale = 1.0f)
   glTranslatef(scale * 0.15, 0.0f, 0.0f);
   glPushMatrix();
   glScalef(0.3, 0.1, 0.1);
-  glutSolidCube(1.0f);
+  part(80, 73, 60);
   // added this line
   glPopMatrix();
   glPopMatrix();
@@ -588,8 +800,7 @@ void Thumb(GLfloat scale = 1.0f)
   glPushMatrix();
   glScalef(0.3, 0.1, 0.1);
   // skin color
-  glColor3ub (80, 73, 60);
-  glutSolidCube(1.0f);
+  part(80, 73, 60);
   glPopMatrix();
 
   //Draw finger flang 1
@@ -598,7 +809,7 @@ void Thumb(GLfloat scale = 1.0f)
   glTranslatef(scale * 0.15, 0.0f, 0.0f);
   glPushMatrix();
   glScalef(0.3, 0.1, 0.1);
-  glutSolidCube(1.0f);
+  part(80, 73, 60);
   // added this line
   glPopMatrix();
   glPopMatrix();
@@ -629,8 +840,7 @@ void hips(bool right = true)
   glPushMatrix();
   glScalef (1.5f, 1.0f, 4.0f);
   // Jeans color
-  glColor3ub (0, 0, 255);
-  glutSolidCube (1.0f);
+  part(0, 0, 255);
   glPopMatrix();
 }
 
@@ -652,8 +862,7 @@ void knees(bool right = true)
   glPushMatrix();
   glScalef (1.5f, 1.0f, 4.0f);
   // Jeans color
-  glColor3ub (0, 0, 255);
-  glutSolidCube (1.0f);
+  part(0, 0, 255);
   glPopMatrix();
 }
 
@@ -675,8 +884,7 @@ void ankles(bool right = true)
   glPushMatrix();
   glScalef (1.5f, 3.0f, 1.0f);
   // Shoes color
-  glColor3ub (28, 21, 7);
-  glutSolidCube (1.0f);
+  part(28, 21, 7);
   glPopMatrix();
 }
 
@@ -735,8 +943,12 @@ void move(double speed)
 }
 void display(void)
 {
+   frame_posted = false;
+   frame_start = glutGet(GLUT_ELAPSED_TIME);
    glClear(GL_COLOR_BUFFER_BIT);
    glClear(GL_DEPTH_BUFFER_BIT);
+   beginfragments();
+   glmQueueBegin(queue);
    glPushMatrix();
    gluLookAt(eye[0],eye[1],eye[2],center[0],center[1],center[2],up[0],up[1],up[2]);
    glRotatef(angle2, 1.0f, 0.0f, 0.0f);
@@ -744,10 +956,10 @@ void display(void)
 
    glLightfv(GL_LIGHT0, GL_POSITION, light_position);
    //materials properties
-   glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,mat_amb_diff);
+   glmMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE,mat_amb_diff);
 
    //start making environment
-   glColor3ub(255,255,255);
+   glmColor3ub(255,255,255);
    // imported objects block
    glPushMatrix();
    glRotatef(90,1.0f,0.0f,0.0f);
@@ -775,14 +987,15 @@ void display(void)
 
    glPopMatrix();
 
-   glColorMaterial(GL_FRONT_AND_BACK, GL_DIFFUSE);
-   glEnable(GL_COLOR_MATERIAL);
-
-
    // start of making body
 
    // global moving
    glTranslatef(offset_x,offset_y,offset_z);
+   // the cubes are added as the body is made, and drawn when the queue
+   // gets to them
+   static GLfloat white[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+   glmBatchBegin(robot);
+   glmQueueCall(queue, GLM_QUEUE_OPAQUE, 0, &paint, white, NULL, cubes, robot);
 
    // make a new hierarchy for upper body
    // make torso
@@ -853,7 +1066,12 @@ void display(void)
 
 
    glPopMatrix();
-   glutPostRedisplay();
+   glmQueueFlush(queue);
+   endfragments();
+   endstate();
+   // the measurements average over frames, so keep drawing them
+   if (count_fragments || count_state)
+     redraw();
    glutSwapBuffers();
 }
 
@@ -867,6 +1085,7 @@ void reshape(int w, int h)
    glLoadIdentity();
    // this was from previous code
    //glTranslatef(0.0f, 0.0f, -5.0f);
+   redraw();
 }
 
 void keyboard(unsigned char key, int x, int y)
@@ -1053,13 +1272,34 @@ void keyboard(unsigned char key, int x, int y)
            b_zoom = !b_zoom;
           break;
 
+        case 'o':
+           count_fragments = !count_fragments;
+           fragment_total = 0;
+           fragment_frames = 0;
+          break;
+
+        case 'c':
+           count_state = !count_state;
+           state_issued = 0;
+           state_avoided = 0;
+           state_frames = 0;
+          break;
+
+        case 'i':
+           if (drawpath == DRAW_LISTS)
+             printf("lists: %u hits, %u misses, %u evicted, %.1f ms compiling\n",
+                    lists->hits, lists->misses, lists->evictions,
+                    lists->compiletime * 1000.0);
+           drawpath = (drawpath + 1) % 3;
+          break;
+
    case 27:
       exit(0);
       break;
    default:
-      break;
+      return;
    }
-   glutPostRedisplay();
+   redraw();
 }
 
 void keySpecial(int key, int x, int y)
@@ -1087,7 +1327,7 @@ void keySpecial(int key, int x, int y)
      break;
 
      default:
-     break;
+     return;
 
      case GLUT_KEY_UP:
      if (b_zoom)
@@ -1109,7 +1349,7 @@ void keySpecial(int key, int x, int y)
      }
      break;
    }
-   glutPostRedisplay();
+   redraw();
 }
 
 static void mouse(int button, int state, int x, int y)
@@ -1124,7 +1364,6 @@ static void mouse(int button, int state, int x, int y)
       moving = 0;
     }
   }
-  glutPostRedisplay();
 }
 
 
@@ -1135,9 +1374,8 @@ static void motion(int x, int y)
     angle2 = angle2 + (y - starty);
     startx = x;
     starty = y;
-    //glutPostRedisplay();
+    redraw();
   }
-  glutPostRedisplay();
 }
 
 void Textures_menu(int value)
@@ -1156,13 +1394,25 @@ void Textures_menu(int value)
       _texture = &_tex_wood2;
       break;
     default:
-    break;
+    return;
   }
+  redraw();
 }
 
 int main(int argc, char **argv)
 {
    glutInit(&argc, argv);
+   for (int i = 1; i < argc; i++)
+     if (strcmp(argv[i], "-fragments") == 0)
+       count_fragments = true;
+     else if (strcmp(argv[i], "-state") == 0)
+       count_state = true;
+     else if (strcmp(argv[i], "-lists") == 0)
+       drawpath = DRAW_LISTS;
+     else if (strcmp(argv[i], "-immediate") == 0)
+       drawpath = DRAW_IMMEDIATE;
+     else if (strcmp(argv[i], "-fps") == 0 && i + 1 < argc)
+       max_fps = atoi(argv[++i]);
    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
    glutInitWindowSize(500, 500);
    glutInitWindowPosition(100, 100);